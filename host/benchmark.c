@@ -0,0 +1,257 @@
+/*
+ * benchmark.c
+ *
+ *  Host timings of the waveform and shell hot paths: the firmware's
+ *  'bench' cases from bench.c, plus a whole simulated tickIsr() (DDS
+ *  step, SPI words and LDAC through the models).
+ *
+ *  benchmark [-n RUNS] [-w WARMUP] [-j] [CASE...]
+ *    -n RUNS    timed runs per case (default 1000)
+ *    -w WARMUP  runs thrown away first (default 100)
+ *    -j         one JSON object instead of text
+ *
+ *  Times are host nanoseconds per call, less the cost of timing an empty
+ *  run. They track regressions from one build to the next on the same
+ *  machine, not cycles on the board ('bench' on the board gives those).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "tm4c123gh6pm.h"
+#include "clock.h"
+#include "dds.h"
+#include "uart0.h"
+#include "fft.h"
+#include "bench.h"
+
+#define BENCH_HOST_RUNS 1000
+#define BENCH_HOST_WARMUP 100
+#define BENCH_HOST_MAX_RUNS 10000
+#define BENCH_HOST_TICK_HZ 40000
+
+// sigGen.c
+void tickIsr(void);
+void setPhaseAccum(DAC select, uint32_t value);
+
+static uint32_t samples[BENCH_HOST_MAX_RUNS];
+static char text[64];
+static uint8_t point;
+static volatile float sink; // keeps results live so the calls are not dropped
+
+// A gain sweep row and a 'voltage' reading, as the shell prints them
+static const float gainRows[4][3] = { { 10, -0.012, -0.4 }, { 1000, -3.011, -45.2 }, { 15000, -18.5, -84.75 }, { 98765.4, -40.25, -89.9 } };
+static const int32_t tenthMillivolts[4] = { 12345, -250, 33000, 7 };
+
+static void runIsr(void)
+{
+    uint16_t i;
+
+    for (i = 0; i < BENCH_CALLS; i++)
+        tickIsr();
+}
+
+// The number fields of BENCH_LINE through the sscanf("%f") getFieldFloat() used before scanNumber()
+static void runSscanfField(void)
+{
+    float freq, amp, ofs;
+
+    sscanf("1.5k", "%f", &freq);
+    sscanf("2.5", "%f", &amp);
+    sscanf("-250m", "%f", &ofs);
+    sink += freq + amp + ofs;
+}
+
+static void runFormatRow(void)
+{
+    const float* row = gainRows[point++ & 3];
+
+    putFloatUart0(row[0], 3);
+    putcUart0('\t');
+    putFloatUart0(row[1], 3);
+    putcUart0('\t');
+    putFloatUart0(row[2], 1);
+    putcUart0('\n');
+}
+
+static void runSprintfRow(void)
+{
+    const float* row = gainRows[point++ & 3];
+
+    sprintf(text, "%.3f\t%.3f\t%.1f\n", row[0], row[1], row[2]);
+    putsUart0(text);
+}
+
+static void runFormatFixed(void)
+{
+    putsUart0("IN2: ");
+    putFixedUart0(tenthMillivolts[point++ & 3], 4);
+    putsUart0(" V\n");
+}
+
+static void runSprintfFixed(void)
+{
+    int32_t value = tenthMillivolts[point++ & 3];
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+
+    sprintf(text, "IN2: %s%lu.%04lu V\n", value < 0 ? "-" : "", (unsigned long)magnitude / 10000, (unsigned long)magnitude % 10000);
+    putsUart0(text);
+}
+
+// After the shared cases, only the host can run these
+static const BENCH_CASE hostCases[] =
+{
+    { "isr", runIsr, BENCH_CALLS },
+    // against the shared 'field' case, the C library without the SI suffixes
+    { "field-sscanf", runSscanfField, 3 },
+    // one printed line each, the uart0.c formatters against the sprintf() they replaced
+    { "row", runFormatRow, 1 },
+    { "row-sprintf", runSprintfRow, 1 },
+    { "fixed", runFormatFixed, 1 },
+    { "fixed-sprintf", runSprintfFixed, 1 },
+};
+#define HOST_CASES (sizeof(hostCases) / sizeof(hostCases[0]))
+#define CASES (benchCaseCount + HOST_CASES)
+
+static const BENCH_CASE* getCase(uint8_t i)
+{
+    return i < benchCaseCount ? &benchCases[i] : &hostCases[i - benchCaseCount];
+}
+
+static uint64_t getNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Times warmup + runs calls of run, less overhead ns each
+static void timeCase(void (*run)(void), uint16_t runs, uint16_t warmup, uint32_t overhead, BENCH_STATS* stats)
+{
+    uint64_t start, ns;
+    uint32_t i;
+
+    for (i = 0; i < (uint32_t)warmup + runs; i++)
+    {
+        start = getNs();
+        run();
+        ns = getNs() - start;
+        if (i >= warmup)
+            samples[i - warmup] = ns > overhead ? ns - overhead : 0;
+    }
+    summarizeBench(samples, runs, stats);
+}
+
+// Both outputs playing a sine from a 40 kHz tick, as tickIsr() sees them on the board
+static void setupTick(void)
+{
+    TIMER4_TAILR_R = SYSTEM_CLOCK_HZ / BENCH_HOST_TICK_HZ - 1;
+    calculateWave(SINE, DAC_A, 2.5, 0, 50);
+    calculateWave(SINE, DAC_B, 2.5, 0, 50);
+    setPhaseAccum(DAC_A, float2uint(1000.0 * LUT_SIZE / BENCH_HOST_TICK_HZ));
+    setPhaseAccum(DAC_B, float2uint(1000.0 * LUT_SIZE / BENCH_HOST_TICK_HZ));
+}
+
+static void printCase(const BENCH_CASE* c, BENCH_STATS* stats, bool json)
+{
+    if (json)
+        printf("{\"name\":\"%s\",\"calls\":%u,\"median\":%.1f,\"p99\":%.1f,\"min\":%.1f,\"max\":%.1f}",
+               c->name, c->calls, (double)stats->median / c->calls, (double)stats->p99 / c->calls,
+               (double)stats->min / c->calls, (double)stats->max / c->calls);
+    else
+        printf("%s: median %.1f, p99 %.1f, min %.1f, max %.1f ns/call\n",
+               c->name, (double)stats->median / c->calls, (double)stats->p99 / c->calls,
+               (double)stats->min / c->calls, (double)stats->max / c->calls);
+}
+
+static bool isSelected(const char* name, int count, char* names[])
+{
+    int i;
+
+    if (count == 0)
+        return true;
+    for (i = 0; i < count; i++)
+        if (strcmp(names[i], name) == 0)
+            return true;
+    return false;
+}
+
+static void usage(void)
+{
+    uint8_t i;
+
+    fprintf(stderr, "usage: benchmark [-n RUNS] [-w WARMUP] [-j] [CASE...]\ncases:");
+    for (i = 0; i < CASES; i++)
+        fprintf(stderr, " %s", getCase(i)->name);
+    fprintf(stderr, "\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    BENCH_STATS stats;
+    uint32_t overhead;
+    long runs = BENCH_HOST_RUNS, warmup = BENCH_HOST_WARMUP;
+    bool json = false;
+    uint8_t i, matched = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:w:j")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            runs = strtol(optarg, 0, 10);
+            break;
+        case 'w':
+            warmup = strtol(optarg, 0, 10);
+            break;
+        case 'j':
+            json = true;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (runs < 1 || runs > BENCH_HOST_MAX_RUNS || warmup < 0 || warmup > BENCH_HOST_MAX_RUNS)
+    {
+        fprintf(stderr, "RUNS must be 1 to %u and WARMUP 0 to %u\n", BENCH_HOST_MAX_RUNS, BENCH_HOST_MAX_RUNS);
+        return 2;
+    }
+    for (i = 0; i < CASES; i++)
+        if (isSelected(getCase(i)->name, argc - optind, argv + optind))
+            matched++;
+    if (matched == 0)
+        usage();
+
+    timeCase(benchNone, runs, warmup, 0, &stats);
+    overhead = stats.median;
+    initFft(); // firmwareMain() does it on the board
+    setupBench();
+    setupTick();
+
+    if (json)
+        printf("{\"clock\":\"host\",\"runs\":%ld,\"warmup\":%ld,\"unit\":\"ns/call\",\"cases\":[", runs, warmup);
+    matched = 0;
+    for (i = 0; i < CASES; i++)
+    {
+        if (!isSelected(getCase(i)->name, argc - optind, argv + optind))
+            continue;
+        // ddsTick() plays both channels from wherever the indexes were left
+        outA_EN = outB_EN = true;
+        maxCycles_A = maxCycles_B = -1;
+        timeCase(getCase(i)->run, runs, warmup, overhead, &stats);
+        if (json && matched)
+            printf(",");
+        printCase(getCase(i), &stats, json);
+        matched++;
+    }
+    if (json)
+        printf("]}\n");
+    return 0;
+}
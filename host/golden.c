@@ -0,0 +1,774 @@
+/*
+ * golden.c
+ *
+ *  Golden waveform tests: each case types its commands into the shell,
+ *  lets the tick engine play for some seconds of virtual time and looks at
+ *  what the MCP4822 model latched, turned into board output volts with
+ *  the calibration values in dds.h.
+ *
+ *  The latches are sampled once per tick (mid period, after both channels
+ *  were written) and analysed with a 4-term Blackman-Harris window. The
+ *  fundamental and harmonics are measured by a DFT at their exact
+ *  frequencies, so DDS tones off the bin grid still read the right
+ *  amplitude and phase. The largest other spur comes from an FFT.
+ *
+ *  golden [-s SECONDS] [-o DIR] [-b FILE] [-v] [CASE...]
+ *    -s SECONDS  virtual time each case plays (default 1)
+ *    -o DIR      write DIR/CASE.csv (latches) and DIR/CASE.wav (volts, +/-5 V full scale)
+ *    -b FILE     checksums of the played codes: written if FILE does not
+ *                exist, compared bit for bit if it does (same SECONDS)
+ *    -v          show the shell's replies
+ *
+ *  Exits 1 when any case fails.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "tm4c123gh6pm.h"
+#include "clock.h"
+#include "dds.h"
+#include "sim.h"
+#include "uart.h"
+#include "mcp4822.h"
+
+#define GOLDEN_SECONDS 1.0
+#define GOLDEN_SETTLE_S 0.01        // skipped before the analysis window
+#define GOLDEN_HARMONICS 10         // THD counts harmonics 2 to this (below Nyquist)
+#define GOLDEN_LOBE_BINS 5          // half width of a Blackman-Harris tone in the FFT
+#define GOLDEN_MAX_SAMPLES 1048576
+#define GOLDEN_REPLY_SIZE 4096
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+
+typedef enum _GOLDEN_MODE
+{
+    MODE_SINGLE,
+    MODE_DIFFERENTIAL,
+    MODE_HILBERT,
+    MODE_CYCLES
+} GOLDEN_MODE;
+
+typedef struct _GOLDEN_CASE
+{
+    char* name;
+    char* commands;         // shell lines, CR separated, the last one 'run'
+    WAVE shape;
+    DAC out;                // output the shape is rendered on
+    double freq;
+    double amp;
+    double ofs;
+    GOLDEN_MODE mode;
+    uint32_t cycles;        // MODE_CYCLES, cycles set on OUT A
+} GOLDEN_CASE;
+
+// Tolerances of a shape, THD and SFDR are around the ideal shape's values
+typedef struct _GOLDEN_LIMITS
+{
+    double freq;            // relative
+    double amp;             // relative
+    double ofs;             // volts
+    double thdMin, thdMax;  // dB
+    double sfdrMin, sfdrMax;
+} GOLDEN_LIMITS;
+
+#define GOLDEN_PHASE_DEG 1.0        // differential and Hilbert phase between the outputs
+#define GOLDEN_MATCH 0.02           // amplitude of OUT B against OUT A
+#define GOLDEN_CYCLE_TICKS 2        // end of the last cycle, in ticks
+
+static const GOLDEN_CASE cases[] =
+{
+    { "sine", "sine 1 1k 1\rrun\r", SINE, DAC_A, 1000, 1, 0, MODE_SINGLE, 0 },
+    { "sine-ofs", "sine 1 250 2 0.5\rrun\r", SINE, DAC_A, 250, 2, 0.5, MODE_SINGLE, 0 },
+    { "sine-b", "sine 2 2.5k 1.5 -0.25\rrun\r", SINE, DAC_B, 2500, 1.5, -0.25, MODE_SINGLE, 0 },
+    { "square", "square 1 500 1\rrun\r", SQUARE, DAC_A, 500, 1, 0, MODE_SINGLE, 0 },
+    { "sawtooth", "sawtooth 1 1k 1\rrun\r", SAW, DAC_A, 1000, 1, 0, MODE_SINGLE, 0 },
+    { "triangle", "triangle 1 1k 1\rrun\r", TRI, DAC_A, 1000, 1, 0, MODE_SINGLE, 0 },
+    { "differential", "differential ON\rsine 1 1k 1\rrun\r", SINE, DAC_A, 1000, 1, 0, MODE_DIFFERENTIAL, 0 },
+    { "hilbert", "hilbert ON\rsine 1 1k 1\rrun\r", SINE, DAC_A, 1000, 1, 0, MODE_HILBERT, 0 },
+    { "cycles", "cycles 1 5\rsine 1 1k 1\rrun\r", SINE, DAC_A, 1000, 1, 0, MODE_CYCLES, 5 },
+};
+#define CASES (sizeof(cases) / sizeof(cases[0]))
+
+// Back to single outputs, continuous, nothing playing
+#define GOLDEN_RESET "stop\rdifferential OFF\rhilbert OFF\rcycles continuous\r"
+
+typedef enum _GOLDEN_STEP
+{
+    STEP_RESET,
+    STEP_START,
+    STEP_MEASURE
+} GOLDEN_STEP;
+
+typedef struct _TONE
+{
+    double freq;
+    double amp;
+    double phase;           // degrees
+} TONE;
+
+// What one output played
+typedef struct _RESULT
+{
+    TONE fundamental;
+    double ofs;
+    double thd;
+    double sfdr;
+} RESULT;
+
+static double seconds = GOLDEN_SECONDS;
+static char* outDir = 0;
+static char* baseline = 0;
+static FILE* baselineFile = 0;
+static bool baselineWrite = false;
+static bool verbose = false;
+static bool selected[CASES];
+
+static uint8_t current = 0;
+static GOLDEN_STEP step = STEP_RESET;
+static uint8_t passed = 0, total = 0;
+static char reply[GOLDEN_REPLY_SIZE];
+static char failures[1024];
+
+static double* output[2];
+static double* window;
+static double* re;
+static double* im;
+
+ /* ======================================= *
+  *                ANALYSIS                 *
+  * ======================================= */
+
+static double toDb(double ratio)
+{
+    return 20 * log10(ratio + 1e-20);
+}
+
+// Amplitude of harmonic h relative to the fundamental for each ideal shape
+static double harmonicRatio(WAVE shape, uint8_t h)
+{
+    switch (shape)
+    {
+    case SQUARE:
+        return (h & 1) ? 1.0 / h : 0;
+    case SAW:
+        return 1.0 / h;
+    case TRI:
+        return (h & 1) ? 1.0 / ((double)h * h) : 0;
+    default:
+        return 0;
+    }
+}
+
+// Fundamental amplitude of each ideal shape with peak 1
+static double fundamentalGain(WAVE shape)
+{
+    switch (shape)
+    {
+    case SQUARE:
+        return 4 / M_PI;
+    case SAW:
+        return 2 / M_PI;
+    case TRI:
+        return 8 / (M_PI * M_PI);
+    default:
+        return 1;
+    }
+}
+
+static uint8_t getHarmonics(double freq, double rate)
+{
+    uint8_t h = GOLDEN_HARMONICS;
+
+    while (h > 1 && h * freq >= rate / 2)
+        h--;
+    return h;
+}
+
+static void getLimits(WAVE shape, uint8_t harmonics, GOLDEN_LIMITS* limits)
+{
+    double sum = 0, spur = 0;
+    uint8_t h;
+
+    limits->freq = 0.0005;
+    limits->amp = 0.02;
+    limits->ofs = 0.025;
+    if (shape == SINE)
+    {
+        limits->thdMin = -200;
+        limits->thdMax = -50;
+        limits->sfdrMin = 55;
+        limits->sfdrMax = 200;
+        return;
+    }
+    for (h = 2; h <= harmonics; h++)
+    {
+        sum += harmonicRatio(shape, h) * harmonicRatio(shape, h);
+        if (harmonicRatio(shape, h) > spur)
+            spur = harmonicRatio(shape, h);
+    }
+    limits->thdMin = toDb(sqrt(sum)) - 0.5;
+    limits->thdMax = toDb(sqrt(sum)) + 0.5;
+    limits->sfdrMin = -toDb(spur) - 0.5;
+    limits->sfdrMax = -toDb(spur) + 0.5;
+}
+
+static void fillWindow(uint32_t n)
+{
+    const double a[4] = { 0.35875, 0.48829, 0.14128, 0.01168 };
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        double x = 2 * M_PI * i / n;
+        window[i] = a[0] - a[1] * cos(x) + a[2] * cos(2 * x) - a[3] * cos(3 * x);
+    }
+}
+
+// Windowed DFT at freq (cycles per sample), amplitude and phase of a tone there
+static void measureTone(const double* x, uint32_t n, double freq, TONE* tone)
+{
+    double sumRe = 0, sumIm = 0, sumW = 0;
+    double stepRe = cos(2 * M_PI * freq), stepIm = -sin(2 * M_PI * freq);
+    double rotRe = 1, rotIm = 0, t;
+    uint32_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        sumRe += window[i] * x[i] * rotRe;
+        sumIm += window[i] * x[i] * rotIm;
+        sumW += window[i];
+        t = rotRe * stepRe - rotIm * stepIm;
+        rotIm = rotRe * stepIm + rotIm * stepRe;
+        rotRe = t;
+        if ((i & 1023) == 1023) // keep the rotation on the unit circle
+        {
+            t = hypot(rotRe, rotIm);
+            rotRe /= t;
+            rotIm /= t;
+        }
+    }
+    tone->freq = freq;
+    tone->amp = 2 * hypot(sumRe, sumIm) / sumW;
+    tone->phase = atan2(sumIm, sumRe) * 180 / M_PI + 90; // phase of a sine
+}
+
+// In place radix 2 FFT of re/im, n a power of 2
+static void fft(uint32_t n)
+{
+    uint32_t i, j, k, len;
+    double t;
+
+    for (i = 1, j = 0; i < n; i++)
+    {
+        k = n >> 1;
+        for (; j & k; k >>= 1)
+            j ^= k;
+        j |= k;
+        if (i < j)
+        {
+            t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (len = 2; len <= n; len <<= 1)
+    {
+        double wRe = cos(2 * M_PI / len), wIm = -sin(2 * M_PI / len);
+        for (i = 0; i < n; i += len)
+        {
+            double uRe = 1, uIm = 0;
+            for (j = 0; j < len / 2; j++)
+            {
+                uint32_t a = i + j, b = i + j + len / 2;
+                double xRe = re[b] * uRe - im[b] * uIm;
+                double xIm = re[b] * uIm + im[b] * uRe;
+                re[b] = re[a] - xRe;
+                im[b] = im[a] - xIm;
+                re[a] += xRe;
+                im[a] += xIm;
+                t = uRe * wRe - uIm * wIm;
+                uIm = uRe * wIm + uIm * wRe;
+                uRe = t;
+            }
+        }
+    }
+}
+
+// Frequency, amplitude, offset, THD and SFDR of x, a tone near freq (cycles per sample)
+static void analyze(const double* x, uint32_t n, double freq, uint8_t harmonics, RESULT* result)
+{
+    double sumW = 0, sumX = 0, peak = 0, spur = 0, thd = 0, a, b, c, delta, bins;
+    uint32_t i, k, center = 0;
+    TONE tone;
+    uint8_t h;
+
+    for (i = 0; i < n; i++)
+    {
+        sumW += window[i];
+        sumX += window[i] * x[i];
+        re[i] = window[i] * x[i];
+        im[i] = 0;
+    }
+    result->ofs = sumX / sumW;
+    fft(n);
+    for (i = 0; i < n / 2; i++)
+        re[i] = hypot(re[i], im[i]);
+
+    // the peak away from DC, near the requested tone
+    for (k = GOLDEN_LOBE_BINS; k < n / 2 - 1; k++)
+        if (re[k] > peak && fabs(k - freq * n) < n / 2 * 0.05)
+        {
+            peak = re[k];
+            center = k;
+        }
+    if (center == 0)
+        center = (uint32_t)(freq * n + 0.5);
+    a = log(re[center - 1] + 1e-30);
+    b = log(re[center] + 1e-30);
+    c = log(re[center + 1] + 1e-30);
+    delta = (a - 2 * b + c) != 0 ? 0.5 * (a - c) / (a - 2 * b + c) : 0;
+    measureTone(x, n, (center + delta) / n, &result->fundamental);
+
+    // harmonics at their exact (folded) frequencies
+    for (h = 2; h <= harmonics; h++)
+    {
+        double f = fmod(h * result->fundamental.freq, 1.0);
+        measureTone(x, n, f > 0.5 ? 1 - f : f, &tone);
+        thd += tone.amp * tone.amp;
+        if (tone.amp > spur)
+            spur = tone.amp;
+    }
+    result->thd = toDb(sqrt(thd) / result->fundamental.amp);
+
+    // anything else, outside DC and the fundamental
+    for (k = GOLDEN_LOBE_BINS; k < n / 2; k++)
+    {
+        bins = fabs((double)k - result->fundamental.freq * n);
+        if (bins > GOLDEN_LOBE_BINS && 2 * re[k] / sumW > spur)
+            spur = 2 * re[k] / sumW;
+    }
+    result->sfdr = toDb(result->fundamental.amp / spur);
+}
+
+ /* ======================================= *
+  *                 RECORD                  *
+  * ======================================= */
+
+// Output volts of a code on the board the calibration values in dds.h describe,
+// so the checks see the firmware's intent rather than the ideal DAC model's error
+static double toVolts(uint16_t code, DAC out)
+{
+    return out == DAC_A ? OUT_OFFSET_A + OUT_SLOPE_A * (DAC_OFFSET_A + DAC_SLOPE_A * code)
+                        : OUT_OFFSET_B + OUT_SLOPE_B * (DAC_OFFSET_B + DAC_SLOPE_B * code);
+}
+
+// One sample per tick from start, what the outputs held mid tick; returns how many
+static uint32_t resample(MCP4822_SAMPLE* latches, uint32_t count, uint64_t start, uint64_t period,
+                         uint64_t end, uint16_t (*codes)[2], uint32_t size)
+{
+    uint32_t i = 0, n = 0;
+    uint64_t t;
+
+    for (t = start + period / 2; t < end && n < size; t += period)
+    {
+        while (i + 1 < count && latches[i + 1].time <= t)
+            i++;
+        codes[n][0] = latches[i].code[0];
+        codes[n][1] = latches[i].code[1];
+        n++;
+    }
+    return n;
+}
+
+static uint32_t checksum(uint16_t (*codes)[2], uint32_t n)
+{
+    uint32_t hash = FNV_OFFSET, i;
+
+    for (i = 0; i < n; i++)
+    {
+        hash = (hash ^ codes[i][0]) * FNV_PRIME;
+        hash = (hash ^ codes[i][1]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static void put16(FILE* file, uint16_t value)
+{
+    fputc(value & 0xFF, file);
+    fputc(value >> 8, file);
+}
+
+static void put32(FILE* file, uint32_t value)
+{
+    put16(file, value & 0xFFFF);
+    put16(file, value >> 16);
+}
+
+static FILE* openOutput(const char* name, const char* extension)
+{
+    char path[1024];
+    FILE* file;
+
+    snprintf(path, sizeof(path), "%s/%s.%s", outDir, name, extension);
+    file = fopen(path, "wb");
+    if (file == 0)
+        perror(path);
+    return file;
+}
+
+static void writeCsv(const char* name, MCP4822_SAMPLE* latches, uint32_t count)
+{
+    FILE* file = openOutput(name, "csv");
+    uint32_t i;
+
+    if (file == 0)
+        return;
+    fprintf(file, "clocks,code_a,code_b\n");
+    for (i = 0; i < count; i++)
+        fprintf(file, "%llu,%u,%u\n", (unsigned long long)latches[i].time, latches[i].code[0], latches[i].code[1]);
+    fclose(file);
+}
+
+// 16 bit stereo PCM at the tick rate, +/-5 V full scale
+static void writeWav(const char* name, uint16_t (*codes)[2], uint32_t n, uint32_t rate)
+{
+    FILE* file = openOutput(name, "wav");
+    uint32_t i;
+    uint8_t c;
+
+    if (file == 0)
+        return;
+    fwrite("RIFF", 1, 4, file);
+    put32(file, 36 + n * 4);
+    fwrite("WAVEfmt ", 1, 8, file);
+    put32(file, 16);
+    put16(file, 1);         // PCM
+    put16(file, 2);
+    put32(file, rate);
+    put32(file, rate * 4);
+    put16(file, 4);
+    put16(file, 16);
+    fwrite("data", 1, 4, file);
+    put32(file, n * 4);
+    for (i = 0; i < n; i++)
+        for (c = 0; c < 2; c++)
+        {
+            double v = toVolts(codes[i][c], c == 0 ? DAC_A : DAC_B) / 5 * 32767;
+            put16(file, (uint16_t)(int16_t)(v > 32767 ? 32767 : v < -32767 ? -32767 : v));
+        }
+    fclose(file);
+}
+
+// Compares against or adds to the baseline, false on a mismatch
+static bool checkBaseline(const char* name, uint32_t hash)
+{
+    char line[256], entry[128];
+    unsigned int expected;
+    double played;
+
+    if (baselineFile == 0)
+        return true;
+    if (baselineWrite)
+    {
+        fprintf(baselineFile, "%s %.3f %08x\n", name, seconds, hash);
+        return true;
+    }
+    rewind(baselineFile);
+    while (fgets(line, sizeof(line), baselineFile))
+        if (sscanf(line, "%127s %lf %x", entry, &played, &expected) == 3
+            && strcmp(entry, name) == 0 && fabs(played - seconds) < 0.0005)
+            return expected == hash;
+    return true; // not in the baseline for this length
+}
+
+ /* ======================================= *
+  *                  CASES                  *
+  * ======================================= */
+
+// Notes a value outside low to high under the case's result line
+static bool checkRange(const char* what, double value, double low, double high)
+{
+    size_t used = strlen(failures);
+
+    if (value >= low && value <= high)
+        return true;
+    snprintf(failures + used, sizeof(failures) - used, "  %s %.4f out of %.4f to %.4f\n", what, value, low, high);
+    return false;
+}
+
+static double wrapDegrees(double degrees)
+{
+    degrees = fmod(degrees, 360);
+    if (degrees > 180)
+        degrees -= 360;
+    if (degrees <= -180)
+        degrees += 360;
+    return degrees;
+}
+
+// Samples of OUT A until the last code change, in cycles of freq
+static double getPlayedCycles(uint16_t (*codes)[2], uint32_t n, double freq)
+{
+    uint32_t i, last = 0;
+
+    for (i = 1; i < n; i++)
+        if (codes[i][0] != codes[i - 1][0])
+            last = i;
+    return (last + 1) * freq;
+}
+
+static bool measureCase(const GOLDEN_CASE* c)
+{
+    MCP4822_SAMPLE* latches;
+    uint32_t count = getMcp4822Record(&latches);
+    uint64_t period = TIMER4_TAILR_R + 1, end = getSimTime();
+    double rate = (double)SYSTEM_CLOCK_HZ / period;
+    uint32_t size = (uint32_t)(seconds * rate) + 1, n, fftSize, skip, hash, i;
+    uint16_t (*codes)[2];
+    uint8_t harmonics = getHarmonics(c->freq, rate);
+    GOLDEN_LIMITS limits;
+    RESULT result, other;
+    char line[256];
+    bool ok = true;
+
+    failures[0] = '\0';
+    if (count == 0)
+    {
+        printf("%s: FAIL, nothing was latched\n", c->name);
+        return false;
+    }
+    codes = malloc(size * sizeof(*codes));
+    if (codes == 0)
+        return false;
+    n = resample(latches, count, latches[0].time, period, end, codes, size);
+    hash = checksum(codes, n);
+    if (outDir)
+    {
+        writeCsv(c->name, latches, count);
+        writeWav(c->name, codes, n, (uint32_t)(rate + 0.5));
+    }
+
+    getLimits(c->shape, harmonics, &limits);
+    if (c->mode == MODE_CYCLES)
+    {
+        double played = getPlayedCycles(codes, n, c->freq / rate);
+        double tolerance = GOLDEN_CYCLE_TICKS * c->freq / rate;
+
+        snprintf(line, sizeof(line), "%.3f cycles", played);
+        ok &= checkRange("cycles", played, c->cycles - tolerance, c->cycles + tolerance);
+    }
+    else
+    {
+        skip = (uint32_t)(GOLDEN_SETTLE_S * rate);
+        for (fftSize = 1; fftSize * 2 <= n - skip && fftSize * 2 <= GOLDEN_MAX_SAMPLES; fftSize *= 2)
+            ;
+        fillWindow(fftSize);
+        for (i = 0; i < fftSize; i++)
+        {
+            output[0][i] = toVolts(codes[skip + i][0], DAC_A);
+            output[1][i] = toVolts(codes[skip + i][1], DAC_B);
+        }
+        analyze(output[c->out == DAC_A ? 0 : 1], fftSize, c->freq / rate, harmonics, &result);
+        snprintf(line, sizeof(line), "%.3f Hz, amplitude %.4f V, offset %.4f V, THD %.1f dB, SFDR %.1f dB",
+                 result.fundamental.freq * rate, result.fundamental.amp, result.ofs, result.thd, result.sfdr);
+        ok &= checkRange("frequency", result.fundamental.freq * rate,
+                         c->freq * (1 - limits.freq), c->freq * (1 + limits.freq));
+        ok &= checkRange("amplitude", result.fundamental.amp,
+                         c->amp * fundamentalGain(c->shape) * (1 - limits.amp),
+                         c->amp * fundamentalGain(c->shape) * (1 + limits.amp));
+        ok &= checkRange("offset", result.ofs, c->ofs - limits.ofs, c->ofs + limits.ofs);
+        ok &= checkRange("THD", result.thd, limits.thdMin, limits.thdMax);
+        ok &= checkRange("SFDR", result.sfdr, limits.sfdrMin, limits.sfdrMax);
+
+        if (c->mode == MODE_DIFFERENTIAL || c->mode == MODE_HILBERT)
+        {
+            double expected = c->mode == MODE_DIFFERENTIAL ? 180 : -90;
+            double phase;
+
+            measureTone(output[1], fftSize, result.fundamental.freq, &other.fundamental);
+            phase = wrapDegrees(other.fundamental.phase - result.fundamental.phase);
+            snprintf(line + strlen(line), sizeof(line) - strlen(line), ", OUT B %.4f V at %.1f deg",
+                     other.fundamental.amp, phase);
+            ok &= checkRange("OUT B amplitude", other.fundamental.amp,
+                             result.fundamental.amp * (1 - GOLDEN_MATCH), result.fundamental.amp * (1 + GOLDEN_MATCH));
+            // -180 and 180 are the same phase
+            ok &= checkRange("OUT B phase", wrapDegrees(phase - expected), -GOLDEN_PHASE_DEG, GOLDEN_PHASE_DEG);
+        }
+    }
+    if (!checkBaseline(c->name, hash))
+    {
+        snprintf(failures + strlen(failures), sizeof(failures) - strlen(failures),
+                 "  checksum differs from %s\n", baseline);
+        ok = false;
+    }
+    printf("%s: %s, %s, checksum %08x\n%s", c->name, ok ? "PASS" : "FAIL", line, hash, failures);
+    free(codes);
+    return ok;
+}
+
+static void putReply(void)
+{
+    while (readSimUart(reply, sizeof(reply)) > 0)
+        if (verbose)
+            fputs(reply, stdout);
+}
+
+// Shell replies to the case's commands, false if any was an ERROR
+static bool checkReplies(const GOLDEN_CASE* c)
+{
+    bool ok = true;
+
+    while (readSimUart(reply, sizeof(reply)) > 0)
+    {
+        if (verbose)
+            fputs(reply, stdout);
+        if (strstr(reply, "ERROR"))
+        {
+            printf("%s: FAIL, shell replied %s\n", c->name, strstr(reply, "ERROR"));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static void finish(void)
+{
+    printf("%u of %u passed\n", passed, total);
+    if (baselineFile)
+        fclose(baselineFile);
+    exit(passed == total ? 0 : 1);
+}
+
+// The shell waits for input: next step of the current case
+static void onIdle(void)
+{
+    const GOLDEN_CASE* c;
+
+    while (current < CASES && !selected[current])
+        current++;
+    if (current == CASES)
+        finish();
+    c = &cases[current];
+
+    switch (step)
+    {
+    case STEP_RESET:
+        putReply();
+        queueSimUart(GOLDEN_RESET);
+        step = STEP_START;
+        break;
+    case STEP_START:
+        putReply();
+        // the first latch from here on is the first tick
+        if (!startMcp4822Record((uint32_t)(seconds * SYSTEM_CLOCK_HZ / (TIMER4_TAILR_R + 1) * 2) + 1024))
+        {
+            fprintf(stderr, "golden: out of memory\n");
+            exit(1);
+        }
+        queueSimUart(c->commands);
+        step = STEP_MEASURE;
+        break;
+    case STEP_MEASURE:
+        total++;
+        if (checkReplies(c))
+        {
+            runSim((uint64_t)(seconds * SYSTEM_CLOCK_HZ));
+            if (measureCase(c))
+                passed++;
+        }
+        stopMcp4822Record();
+        current++;
+        step = STEP_RESET;
+        onIdle();
+        break;
+    }
+}
+
+static void usage(void)
+{
+    uint8_t i;
+
+    fprintf(stderr, "usage: golden [-s SECONDS] [-o DIR] [-b FILE] [-v] [CASE...]\ncases:");
+    for (i = 0; i < CASES; i++)
+        fprintf(stderr, " %s", cases[i].name);
+    fprintf(stderr, "\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t samples;
+    uint8_t i, matched = 0;
+    int option, j;
+
+    while ((option = getopt(argc, argv, "s:o:b:v")) != -1)
+    {
+        switch (option)
+        {
+        case 's':
+            seconds = strtod(optarg, 0);
+            break;
+        case 'o':
+            outDir = optarg;
+            break;
+        case 'b':
+            baseline = optarg;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (!(seconds >= 0.1 && seconds <= 10))
+    {
+        fprintf(stderr, "SECONDS must be 0.1 to 10\n");
+        return 2;
+    }
+    for (i = 0; i < CASES; i++)
+    {
+        selected[i] = optind == argc;
+        for (j = optind; j < argc; j++)
+            if (strcmp(argv[j], cases[i].name) == 0)
+                selected[i] = true;
+        matched += selected[i];
+    }
+    if (matched == 0)
+        usage();
+    if (baseline)
+    {
+        baselineFile = fopen(baseline, "r");
+        baselineWrite = baselineFile == 0;
+        if (baselineWrite)
+            baselineFile = fopen(baseline, "w");
+        if (baselineFile == 0)
+        {
+            perror(baseline);
+            return 2;
+        }
+    }
+
+    samples = GOLDEN_MAX_SAMPLES;
+    output[0] = malloc(samples * sizeof(double));
+    output[1] = malloc(samples * sizeof(double));
+    window = malloc(samples * sizeof(double));
+    re = malloc(samples * sizeof(double));
+    im = malloc(samples * sizeof(double));
+    if (!output[0] || !output[1] || !window || !re || !im)
+    {
+        fprintf(stderr, "golden: out of memory\n");
+        return 1;
+    }
+
+    initSimUart(-1, -1);
+    initSim(SIM_VIRTUAL);
+    setSimIdle(onIdle);
+    return firmwareMain();
+}
@@ -0,0 +1,239 @@
+/*
+ * gpio.c
+ *
+ *  GPIO library for the host build, same interface as sigGen/gpio.c. The
+ *  PORT values are bit-band alias addresses, which the host does not have,
+ *  so each alias word is turned back into its register and bit in the
+ *  simulated register file. PD2 is the DAC's LDAC pin and drives the
+ *  MCP4822 model.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "gpio.h"
+#include "sim.h"
+#include "mcp4822.h"
+
+#define BITBAND_ALIAS 0x42000000UL
+#define BITBAND_BASE  0x40000000UL
+
+// Word offset of the registers relative to bit 0 of DATA_R at 3FCh, as in sigGen/gpio.c
+#define OFS_DATA_TO_DIR    1*4*8
+#define OFS_DATA_TO_IS     2*4*8
+#define OFS_DATA_TO_IBE    3*4*8
+#define OFS_DATA_TO_IEV    4*4*8
+#define OFS_DATA_TO_IM     5*4*8
+#define OFS_DATA_TO_IC     8*4*8
+#define OFS_DATA_TO_AFSEL  9*4*8
+#define OFS_DATA_TO_ODR   68*4*8
+#define OFS_DATA_TO_PUR   69*4*8
+#define OFS_DATA_TO_PDR   70*4*8
+#define OFS_DATA_TO_DEN   72*4*8
+#define OFS_DATA_TO_CR    74*4*8
+#define OFS_DATA_TO_AMSEL 75*4*8
+
+#define LDAC_PORT PORTD
+#define LDAC_PIN 2
+
+static volatile uint32_t* getRegister(PORT port, uint8_t pin, uint32_t offset, uint32_t* bit)
+{
+    uintptr_t alias = (uintptr_t)(uint32_t)port + (pin + offset) * 4 - BITBAND_ALIAS;
+
+    *bit = 1UL << ((alias >> 2) & 31);
+    return (volatile uint32_t*)(BITBAND_BASE + ((alias >> 5) & ~(uintptr_t)3));
+}
+
+static void setBit(PORT port, uint8_t pin, uint32_t offset, bool value)
+{
+    uint32_t bit;
+    volatile uint32_t* reg = getRegister(port, pin, offset, &bit);
+
+    if (value)
+        *reg |= bit;
+    else
+        *reg &= ~bit;
+}
+
+static bool getBit(PORT port, uint8_t pin, uint32_t offset)
+{
+    uint32_t bit;
+
+    return (*getRegister(port, pin, offset, &bit) & bit) != 0;
+}
+
+static volatile uint32_t* getDataRegister(PORT port)
+{
+    uint32_t bit;
+
+    return getRegister(port, 0, 0, &bit);
+}
+
+// Clock gating bit of the port
+static uint32_t getPortBit(PORT port)
+{
+    switch(port)
+    {
+        case PORTA: return SYSCTL_RCGCGPIO_R0;
+        case PORTB: return SYSCTL_RCGCGPIO_R1;
+        case PORTC: return SYSCTL_RCGCGPIO_R2;
+        case PORTD: return SYSCTL_RCGCGPIO_R3;
+        case PORTE: return SYSCTL_RCGCGPIO_R4;
+        default:    return SYSCTL_RCGCGPIO_R5;
+    }
+}
+
+void enablePort(PORT port)
+{
+    SYSCTL_RCGCGPIO_R |= getPortBit(port);
+    SYSCTL_GPIOHBCTL_R &= ~getPortBit(port);
+}
+
+void disablePort(PORT port)
+{
+    SYSCTL_RCGCGPIO_R &= ~getPortBit(port);
+}
+
+void selectPinPushPullOutput(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_ODR, 0);
+    setBit(port, pin, OFS_DATA_TO_DIR, 1);
+    setBit(port, pin, OFS_DATA_TO_DEN, 1);
+}
+
+void selectPinOpenDrainOutput(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_ODR, 1);
+    setBit(port, pin, OFS_DATA_TO_DIR, 1);
+    setBit(port, pin, OFS_DATA_TO_DEN, 1);
+}
+
+void selectPinDigitalInput(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_DIR, 0);
+    setBit(port, pin, OFS_DATA_TO_DEN, 1);
+    setBit(port, pin, OFS_DATA_TO_AMSEL, 0);
+}
+
+void selectPinAnalogInput(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_DEN, 0);
+    setBit(port, pin, OFS_DATA_TO_AMSEL, 1);
+    setBit(port, pin, OFS_DATA_TO_AFSEL, 1);
+}
+
+// The host has no lock, the commit bit is just set
+void setPinCommitControl(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_CR, 1);
+}
+
+void enablePinPullup(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_PUR, 1);
+}
+
+void disablePinPullup(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_PUR, 0);
+}
+
+void enablePinPulldown(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_PDR, 1);
+}
+
+void disablePinPulldown(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_PDR, 0);
+}
+
+void setPinAuxFunction(PORT port, uint8_t pin, uint32_t fn)
+{
+    // PCTL is at 52Ch, DATA_R at 3FCh
+    volatile uint32_t* pctl = getDataRegister(port) + (0x52C - 0x3FC) / 4;
+
+    // call with header file shifted values or 4-bit number
+    if (fn <= 15)
+        fn = fn << (pin*4);
+    else
+        fn = fn & (0x0000000F << (pin*4));
+    *pctl = (*pctl & ~(0x0000000F << (pin*4))) | fn;
+    // set AFSEL bit only if using aux function, otherwise clear bit
+    setBit(port, pin, OFS_DATA_TO_AFSEL, fn > 0);
+}
+
+void selectPinInterruptRisingEdge(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_IS, 0);
+    setBit(port, pin, OFS_DATA_TO_IBE, 0);
+    setBit(port, pin, OFS_DATA_TO_IEV, 1);
+}
+
+void selectPinInterruptFallingEdge(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_IS, 0);
+    setBit(port, pin, OFS_DATA_TO_IBE, 0);
+    setBit(port, pin, OFS_DATA_TO_IEV, 0);
+}
+
+void selectPinInterruptBothEdges(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_IS, 0);
+    setBit(port, pin, OFS_DATA_TO_IBE, 1);
+}
+
+void selectPinInterruptHighLevel(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_IS, 1);
+    setBit(port, pin, OFS_DATA_TO_IEV, 1);
+}
+
+void selectPinInterruptLowLevel(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_IS, 1);
+    setBit(port, pin, OFS_DATA_TO_IEV, 0);
+}
+
+void enablePinInterrupt(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_IM, 1);
+}
+
+void disablePinInterrupt(PORT port, uint8_t pin)
+{
+    setBit(port, pin, OFS_DATA_TO_IM, 0);
+}
+
+// No pin interrupts are modelled, IC only clears
+void clearPinInterrupt(PORT port, uint8_t pin)
+{
+    (void)port;
+    (void)pin;
+}
+
+void setPinValue(PORT port, uint8_t pin, bool value)
+{
+    setBit(port, pin, 0, value);
+    if (port == LDAC_PORT && pin == LDAC_PIN)
+    {
+        // the SPI words written before the edge reach the DAC first
+        settleSim();
+        setMcp4822Ldac(value, getSimTime());
+    }
+}
+
+bool getPinValue(PORT port, uint8_t pin)
+{
+    return getBit(port, pin, 0);
+}
+
+void setPortValue(PORT port, uint8_t value)
+{
+    *getDataRegister(port) = value;
+}
+
+uint8_t getPortValue(PORT port)
+{
+    return *getDataRegister(port);
+}
@@ -0,0 +1,97 @@
+/*
+ * instrument.c
+ *
+ *  The signal generator on the host: the unmodified firmware shell on
+ *  stdin/stdout, or on a pseudo-terminal that scripts open like the
+ *  board's COM port (e.g. tools/sigshell.py --port /dev/pts/N).
+ *
+ *  instrument [-p] [-v] [-e FILE]
+ *    -p       shell on a new PTY, its path is printed on stderr
+ *    -v       virtual time, see sim.h (default real time)
+ *    -e FILE  keep the EEPROM (macros, saved state) in FILE
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "sim.h"
+#include "uart.h"
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: instrument [-p] [-v] [-e FILE]\n");
+    exit(2);
+}
+
+// Master side of a new raw PTY, -1 on failure
+static int openPty(void)
+{
+    struct termios raw;
+    int master, slave;
+    char* path;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0 || (path = ptsname(master)) == 0)
+        return -1;
+    // held open so the master does not hang up between clients, and made raw
+    // so a client that leaves the line settings alone still sees the bytes as sent
+    slave = open(path, O_RDWR | O_NOCTTY);
+    if (slave < 0 || tcgetattr(slave, &raw) < 0)
+        return -1;
+    cfmakeraw(&raw);
+    if (tcsetattr(slave, TCSANOW, &raw) < 0)
+        return -1;
+    // output nobody reads is dropped instead of stalling the firmware
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    fprintf(stderr, "%s\n", path);
+    return master;
+}
+
+int main(int argc, char* argv[])
+{
+    SIM_CLOCK timing = SIM_REAL_TIME;
+    bool pty = false;
+    int option, fd;
+
+    while ((option = getopt(argc, argv, "pve:")) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            pty = true;
+            break;
+        case 'v':
+            timing = SIM_VIRTUAL;
+            break;
+        case 'e':
+            if (!setSimEepromFile(optarg))
+            {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind != argc)
+        usage();
+
+    if (pty)
+    {
+        fd = openPty();
+        if (fd < 0)
+        {
+            perror("pty");
+            return 1;
+        }
+        initSimUart(fd, fd);
+    }
+    else
+        initSimUart(STDIN_FILENO, STDOUT_FILENO);
+    initSim(timing);
+    return firmwareMain();
+}
@@ -0,0 +1,109 @@
+/*
+ * mcp4822.c
+ *
+ *  MCP4822 dual 12-bit DAC model for the host build. SPI words load the
+ *  input register of their channel, the LDAC falling edge moves both input
+ *  registers to the outputs (with LDAC held low a word goes straight to
+ *  its output, as on the part).
+ *
+ *  Word: bit 15 channel (0 A, 1 B), bit 13 gain (1 1x, 0 2x), bit 12 on
+ *  (0 shuts the channel down), bits 11-0 code. The output is
+ *  code / 4096 * 2.048 V times the gain, 0 V when shut down.
+ *
+ *  Every latch can be recorded with its virtual time, which is what the
+ *  board really put out and what the golden tests look at.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "mcp4822.h"
+
+#define MCP4822_CHANNEL_B 0x8000
+#define MCP4822_GAIN_1X 0x2000
+#define MCP4822_ACTIVE 0x1000
+#define MCP4822_CODE_M 0x0FFF
+
+static uint16_t inputWord[2] = { 0, 0 };  // shut down at power up
+static uint16_t outputWord[2] = { 0, 0 };
+static bool ldac = true;
+static uint32_t latches = 0;
+
+static MCP4822_SAMPLE* record = 0;
+static uint32_t recordSize = 0;
+static uint32_t recordCount = 0;
+
+static void latch(uint64_t time)
+{
+    outputWord[0] = inputWord[0];
+    outputWord[1] = inputWord[1];
+    latches++;
+    if (recordCount < recordSize)
+    {
+        record[recordCount].time = time;
+        record[recordCount].code[0] = getMcp4822Code(0);
+        record[recordCount].code[1] = getMcp4822Code(1);
+        recordCount++;
+    }
+}
+
+// One SPI word clocked in at time
+void writeMcp4822(uint16_t word, uint64_t time)
+{
+    inputWord[(word & MCP4822_CHANNEL_B) ? 1 : 0] = word;
+    if (!ldac)
+        latch(time);
+}
+
+// LDAC pin level at time, latched on the falling edge
+void setMcp4822Ldac(bool level, uint64_t time)
+{
+    if (ldac && !level)
+        latch(time);
+    ldac = level;
+}
+
+// Output code of channel 0 (A) or 1 (B)
+uint16_t getMcp4822Code(uint8_t channel)
+{
+    return outputWord[channel] & MCP4822_CODE_M;
+}
+
+float getMcp4822Voltage(uint8_t channel)
+{
+    uint16_t word = outputWord[channel];
+
+    if (!(word & MCP4822_ACTIVE))
+        return 0;
+    return (word & MCP4822_CODE_M) * MCP4822_VREF / 4096 * ((word & MCP4822_GAIN_1X) ? 1 : 2);
+}
+
+uint32_t getMcp4822Latches(void)
+{
+    return latches;
+}
+
+// Starts keeping up to samples latches, dropping any earlier record
+bool startMcp4822Record(uint32_t samples)
+{
+    stopMcp4822Record();
+    record = malloc((size_t)samples * sizeof(MCP4822_SAMPLE));
+    if (record == 0)
+        return false;
+    recordSize = samples;
+    return true;
+}
+
+uint32_t getMcp4822Record(MCP4822_SAMPLE** samples)
+{
+    *samples = record;
+    return recordCount;
+}
+
+void stopMcp4822Record(void)
+{
+    free(record);
+    record = 0;
+    recordSize = 0;
+    recordCount = 0;
+}
@@ -0,0 +1,31 @@
+/*
+ * mcp4822.h
+ *
+ *  MCP4822 dual 12-bit DAC model for the host build
+ */
+
+#ifndef MCP4822_H_
+#define MCP4822_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MCP4822_VREF 2.048f
+
+// Output codes after an LDAC latch, at virtual time (system clocks)
+typedef struct _MCP4822_SAMPLE
+{
+    uint64_t time;
+    uint16_t code[2]; // A, B
+} MCP4822_SAMPLE;
+
+void writeMcp4822(uint16_t word, uint64_t time);
+void setMcp4822Ldac(bool level, uint64_t time);
+uint16_t getMcp4822Code(uint8_t channel);
+float getMcp4822Voltage(uint8_t channel);
+uint32_t getMcp4822Latches(void);
+bool startMcp4822Record(uint32_t samples);
+uint32_t getMcp4822Record(MCP4822_SAMPLE** samples);
+void stopMcp4822Record(void);
+
+#endif /* MCP4822_H_ */
@@ -0,0 +1,705 @@
+/*
+ * numeric.c
+ *
+ *  Numeric checks of the register-free firmware modules against double
+ *  precision references from the C library: the shell's number scanner
+ *  against strtod(), the Goertzel analyzer against a direct DFT of the
+ *  same samples, the Q15 FFT against a double precision DFT, and the
+ *  effective bits of the CIC decimator on a dithered ADC model.
+ *
+ *  The random inputs come from a fixed seed, so a failure reproduces.
+ *
+ *  numeric [-n COUNT] [-v] [CHECK...]
+ *    -n COUNT  random inputs per check (default 100000)
+ *    -v        list every mismatch, not just the first few
+ *
+ *  Exits 1 when any check fails.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <unistd.h>
+#include "cmd.h"
+#include "goertzel.h"
+#include "fft.h"
+#include "decimate.h"
+
+#define NUMERIC_COUNT 100000
+#define NUMERIC_SHOWN 5             // mismatches listed per check without -v
+#define NUMERIC_SEED 0x2545F491u
+
+#define SCAN_ULPS 4                 // float result against the correctly rounded value
+#define SCAN_FIXED_SCALE SCALE_MILLI
+
+#define GOERTZEL_AMP_ERROR 1e-4         // relative, against the DFT of the same samples,
+#define GOERTZEL_AMP_FLOOR 1e-3         // plus codes lost to the rounded Q29 products
+#define GOERTZEL_PHASE_ERROR 0.01       // degrees, IN2 against IN1
+#define GOERTZEL_BLOCK 256              // pairs per updateGoertzel() call, a capture block
+// Q15 error of an FFT bin, real or imaginary part. Each stage rounds twice and halves
+// what came before, so the rounding noise settles near 0.75 LSB rms at any size; the
+// largest bin stays within 4 times that, plus the Q15 twiddles, 2^-15 of the bin per stage
+#define FFT_ERROR_LSB 3.0
+#define FFT_TWIDDLE_ERROR (1.0 / 32768)
+#define FFT_RMS_LSB 0.85                // over all bins
+#define ENOB_NOISE 1.0                  // ADC dither, codes rms
+#define ENOB_INPUT 1234.3               // DC input, codes, off the code grid
+#define ENOB_OUTPUTS 256                // outputs per ratio, as the table was measured
+#define ENOB_BLOCK 256                  // input pairs per decimateBlock() call
+#define ENOB_BITS 0.2                   // against the table, 256 outputs scatter about 0.1 bits
+#define ENOB_MEAN_CODES 0.1             // mean of the dithered outputs against the input
+#define ADC_MIDSCALE 2048
+
+typedef struct _NUMERIC_CHECK
+{
+    char* name;
+    bool (*run)(void);
+} NUMERIC_CHECK;
+
+typedef struct _SCAN_CASE
+{
+    char* text;
+    NUM_ERROR error;        // from scanNumber()
+    NUM_ERROR fixedError;   // from getFieldFixed() in SCAN_FIXED_SCALE
+    int32_t fixed;
+} SCAN_CASE;
+
+// Tones on both inputs, IN2 at half amplitude and a phase offset from IN1
+typedef struct _GOERTZEL_CASE
+{
+    char* name;
+    uint32_t rate;          // sample pairs per second
+    uint32_t samples;       // a whole number of cycles of every bin
+    float freqs[GOERTZEL_MAX_BINS];
+    uint8_t bins;
+    double amp;             // 12-bit codes, peak
+    double phase;           // degrees of IN2 against IN1
+    uint8_t shift;          // fraction bits below the 12-bit code
+} GOERTZEL_CASE;
+
+typedef struct _ENOB_POINT
+{
+    uint8_t log2Ratio;      // 0 is decimation off
+    double enob;
+} ENOB_POINT;
+
+static uint32_t count = NUMERIC_COUNT;
+static bool verbose = false;
+static uint32_t seed = NUMERIC_SEED;
+static uint32_t mismatches;
+static uint32_t tried;
+
+static uint32_t getRandom(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+// Lists a mismatch under the check's result line, the first few only without -v
+static void noteMismatch(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static void noteMismatch(const char* format, ...)
+{
+    va_list args;
+
+    if (mismatches++ >= NUMERIC_SHOWN && !verbose)
+        return;
+    va_start(args, format);
+    printf("  ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+ /* ======================================= *
+  *                 SCANNER                 *
+  * ======================================= */
+
+// Edges of scanNumber(): significant digits, exponent range, suffixes and the
+// fixed-point limits of getFieldFixed() in mHz
+static const SCAN_CASE scanCases[] =
+{
+    { "0", NUM_OK, NUM_OK, 0 },
+    { "1.5k", NUM_OK, NUM_OK, 1500000 },
+    { "-250m", NUM_OK, NUM_OK, -250 },
+    { "2e3", NUM_OK, NUM_OK, 2000000 },
+    { "+.5", NUM_OK, NUM_OK, 500 },
+    { "5.", NUM_OK, NUM_OK, 5000 },
+    { "1.2345", NUM_OK, NUM_INEXACT, 1234 },
+    { "-1.2345", NUM_OK, NUM_INEXACT, -1234 },
+    { "2147483.64", NUM_OK, NUM_OK, 2147483640 },
+    { "-2147483.64", NUM_OK, NUM_OK, -2147483640 },
+    { "2147483.65", NUM_OK, NUM_OUT_OF_RANGE, 0 },
+    { "2147484", NUM_OK, NUM_OUT_OF_RANGE, 0 },
+    { "123456789", NUM_OK, NUM_OUT_OF_RANGE, 0 },
+    { "1234.56789", NUM_OK, NUM_INEXACT, 1234567 },
+    { "1000000000", NUM_OK, NUM_OUT_OF_RANGE, 0 },
+    { "0.000000000123456789", NUM_OK, NUM_INEXACT, 0 },
+    { "1234567891", NUM_TOO_MANY_DIGITS, NUM_TOO_MANY_DIGITS, 0 },
+    { "1.234567891", NUM_TOO_MANY_DIGITS, NUM_TOO_MANY_DIGITS, 0 },
+    { "123456789.1", NUM_TOO_MANY_DIGITS, NUM_TOO_MANY_DIGITS, 0 },
+    { "123456789.0", NUM_OK, NUM_OUT_OF_RANGE, 0 },
+    { "3.40282e38", NUM_OK, NUM_OUT_OF_RANGE, 0 },
+    { "3.5e38", NUM_OUT_OF_RANGE, NUM_OUT_OF_RANGE, 0 },
+    { "9e38", NUM_OUT_OF_RANGE, NUM_OUT_OF_RANGE, 0 },
+    { "1e39", NUM_OUT_OF_RANGE, NUM_OUT_OF_RANGE, 0 },
+    { "123456789e30", NUM_OK, NUM_OUT_OF_RANGE, 0 },
+    { "123456789e31", NUM_OUT_OF_RANGE, NUM_OUT_OF_RANGE, 0 },
+    { "1.2e-38", NUM_OK, NUM_INEXACT, 0 },
+    { "1e-39", NUM_OUT_OF_RANGE, NUM_OUT_OF_RANGE, 0 },
+    { "0e99", NUM_OK, NUM_OK, 0 },
+    { "1e999", NUM_OUT_OF_RANGE, NUM_OUT_OF_RANGE, 0 },
+    { "1M", NUM_OK, NUM_OK, 1000000000 },
+    { "1p", NUM_OK, NUM_INEXACT, 0 },
+    { "1e", NUM_BAD_EXPONENT, NUM_BAD_EXPONENT, 0 },
+    { "1e+", NUM_BAD_EXPONENT, NUM_BAD_EXPONENT, 0 },
+    { "-", NUM_NO_DIGITS, NUM_NO_DIGITS, 0 },
+    { ".", NUM_NO_DIGITS, NUM_NO_DIGITS, 0 },
+    { "1.2.3", NUM_BAD_SUFFIX, NUM_BAD_SUFFIX, 0 },
+    { "1kk", NUM_BAD_SUFFIX, NUM_BAD_SUFFIX, 0 },
+    { "1K", NUM_BAD_SUFFIX, NUM_BAD_SUFFIX, 0 },
+};
+#define SCAN_CASES (sizeof(scanCases) / sizeof(scanCases[0]))
+
+// getFieldFixed() on text as the second field of a shell line
+static NUM_ERROR getFixed(const char* text, int32_t* result)
+{
+    USER_DATA data;
+
+    snprintf(data.buffer, sizeof(data.buffer), "x %s", text);
+    parseFields(&data);
+    return getFieldFixed(&data, 1, SCAN_FIXED_SCALE, result);
+}
+
+// Distance of value from the float nearest reference, in units of its last place
+static double getUlps(float value, double reference)
+{
+    float nearest = (float)reference;
+    double ulp = nextafterf(fabsf(nearest), INFINITY) - fabsf(nearest);
+
+    return fabs((double)value - (double)nearest) / ulp;
+}
+
+// Writes a random number the shell could be sent into text, returns its significant digits
+static uint8_t makeNumber(char* text, size_t size, char* reference, size_t referenceSize)
+{
+    static const char suffixes[] = "pnumkM";
+    static const int8_t suffixExponents[] = { -12, -9, -6, -3, 3, 6 };
+    char digits[16];
+    uint8_t length = 1 + getRandom() % 12, point = getRandom() % (length + 1);
+    uint8_t i, first = length, significant = 0;
+    int16_t exponent = 0;
+    bool hasExponent = getRandom() % 3 == 0;
+    int8_t suffix = getRandom() % 4 == 0 ? (int8_t)(getRandom() % 6) : -1;
+    char sign = "  -+"[getRandom() % 4];
+    size_t used;
+
+    // leading and trailing zeros are common in the shell (0.001, 1000), favour them
+    for (i = 0; i < length; i++)
+    {
+        uint32_t r = getRandom() % 16;
+
+        digits[i] = r < 5 ? '0' : '0' + r % 10;
+        if (digits[i] != '0' && first == length)
+            first = i;
+    }
+    digits[length] = '\0';
+    for (i = first; i < length; i++)
+        if (digits[i] != '0')
+            significant = i - first + 1;
+
+    if (hasExponent)
+        exponent = (int16_t)(getRandom() % 97) - 48;
+
+    used = 0;
+    if (sign != ' ')
+        text[used++] = sign;
+    for (i = 0; i < length; i++)
+    {
+        if (i == point && point < length)
+            text[used++] = '.';
+        text[used++] = digits[i];
+    }
+    if (point == length && getRandom() % 2)
+        text[used++] = '.';
+    text[used] = '\0';
+    strncpy(reference, text, referenceSize);
+    if (hasExponent)
+        used += snprintf(text + used, size - used, "e%d", exponent);
+    if (suffix >= 0)
+    {
+        text[used++] = suffixes[suffix];
+        text[used] = '\0';
+    }
+    snprintf(reference + strlen(reference), referenceSize - strlen(reference), "e%d",
+             exponent + (suffix >= 0 ? suffixExponents[suffix] : 0));
+    return significant;
+}
+
+// Expected getFieldFixed() of value in SCAN_FIXED_SCALE, digits below it truncated
+static NUM_ERROR getExpectedFixed(double value, int32_t* result)
+{
+    double scaled = value * 1000, whole = nearbyint(scaled);
+    NUM_ERROR error = NUM_OK;
+
+    // at most 9 significant digits, so a digit below the scale is far above double rounding
+    if (fabs(scaled - whole) > fabs(scaled) * 1e-12)
+    {
+        whole = trunc(scaled);
+        error = NUM_INEXACT;
+    }
+    *result = 0;
+    if (fabs(whole) > INT32_MAX)
+        return NUM_OUT_OF_RANGE;
+    *result = (int32_t)whole;
+    return error;
+}
+
+static void checkScanned(const char* text, const char* reference, uint8_t significant)
+{
+    NUMBER num;
+    NUM_ERROR error = scanNumber(text, &num), expected, fixedError, expectedFixedError;
+    double value = strtod(reference, 0);
+    int32_t fixed, expectedFixed;
+
+    tried++;
+    if (significant > 9)
+        expected = NUM_TOO_MANY_DIGITS;
+    else if (value != 0 && (fabs(value) > FLT_MAX || fabs(value) < FLT_MIN))
+        expected = NUM_OUT_OF_RANGE;
+    else
+        expected = NUM_OK;
+    if (error != expected)
+    {
+        noteMismatch("\"%s\" scanned as %s, strtod() reads %.9g (%s expected)",
+                     text, numErrorString(error), value, numErrorString(expected));
+        return;
+    }
+    if (error != NUM_OK)
+        return;
+    if (getUlps(num.value, value) > SCAN_ULPS)
+        noteMismatch("\"%s\" scanned as %.9g, strtod() reads %.9g (%.1f ulps)",
+                     text, num.value, value, getUlps(num.value, value));
+
+    fixedError = getFixed(text, &fixed);
+    expectedFixedError = getExpectedFixed(value, &expectedFixed);
+    if (fixedError != expectedFixedError || (fixedError != NUM_OUT_OF_RANGE && fixed != expectedFixed))
+        noteMismatch("\"%s\" fixed as %ld (%s), expected %ld (%s)", text, (long)fixed, numErrorString(fixedError),
+                     (long)expectedFixed, numErrorString(expectedFixedError));
+}
+
+// Table of edges, then random numbers against strtod() and exact decimal arithmetic
+static bool checkScan(void)
+{
+    char text[48], reference[48];
+    NUMBER num;
+    NUM_ERROR error;
+    int32_t fixed;
+    uint32_t i;
+
+    for (i = 0; i < SCAN_CASES; i++)
+    {
+        const SCAN_CASE* c = &scanCases[i];
+
+        tried++;
+        error = scanNumber(c->text, &num);
+        if (error != c->error)
+            noteMismatch("\"%s\" scanned as %s, expected %s", c->text, numErrorString(error), numErrorString(c->error));
+        else if (error == NUM_OK && getUlps(num.value, strtod(c->text, 0)) > SCAN_ULPS && strpbrk(c->text, "pnumkM") == 0)
+            noteMismatch("\"%s\" scanned as %.9g, strtod() reads %.9g", c->text, num.value, strtod(c->text, 0));
+        error = getFixed(c->text, &fixed);
+        if (error != c->fixedError || (error != NUM_OUT_OF_RANGE && fixed != c->fixed))
+            noteMismatch("\"%s\" fixed as %ld (%s), expected %ld (%s)", c->text, (long)fixed, numErrorString(error),
+                         (long)c->fixed, numErrorString(c->fixedError));
+    }
+    for (i = 0; i < count; i++)
+    {
+        uint8_t significant = makeNumber(text, sizeof(text), reference, sizeof(reference));
+
+        checkScanned(text, reference, significant);
+    }
+    return mismatches == 0;
+}
+
+ /* ======================================= *
+  *                GOERTZEL                 *
+  * ======================================= */
+
+// The 'goertzel' command's uses: a mid-band tone, a low bin at a high rate whose
+// states need the 64 bits, the 4 bin limit, and decimated input with fraction bits
+static const GOERTZEL_CASE goertzelCases[] =
+{
+    { "1k", 100000, 10000, { 1000 }, 1, 1800, 30, 0 },
+    { "100/10k", 10000, 65500, { 100 }, 1, 2000, -90, 0 },
+    { "4 bins", 50000, 50000, { 50, 1000, 1001, 12345 }, 4, 900, 135, 0 },
+    { "decimated", 1562, 1562, { 60 }, 1, 1500, 10, 4 },
+    { "small", 100000, 65000, { 2500 }, 1, 3, 45, 2 },
+};
+#define GOERTZEL_CASES (sizeof(goertzelCases) / sizeof(goertzelCases[0]))
+
+static uint16_t goertzelPairs[2 * GOERTZEL_MAX_SAMPLES];
+static uint16_t fftPairs[2 * FFT_MAX_POINTS];
+static double fftInput[2 * FFT_MAX_POINTS];
+
+// Codes (12 bits << shift) of the case's tones plus 1 LSB of uniform dither
+static void makeGoertzelPairs(const GOERTZEL_CASE* c)
+{
+    double scale = 1 << c->shift, w, x[2];
+    uint32_t i;
+    uint8_t b, n;
+
+    for (i = 0; i < c->samples; i++)
+    {
+        x[0] = x[1] = ADC_MIDSCALE;
+        for (b = 0; b < c->bins; b++)
+        {
+            w = 2 * M_PI * c->freqs[b] / c->rate;
+            x[0] += c->amp / c->bins * cos(w * i);
+            x[1] += c->amp / c->bins / 2 * cos(w * i + c->phase * M_PI / 180);
+        }
+        for (n = 0; n < 2; n++)
+            goertzelPairs[2 * i + n] = (uint16_t)lround(x[n] * scale + (getRandom() / 4294967296.0 - 0.5) * scale);
+    }
+}
+
+// Amplitude (codes) and phase (degrees) of one bin of one input by a direct DFT of
+// the samples the analyzer sees, the dropped fraction bits included
+static void getDftBin(const GOERTZEL_CASE* c, uint8_t input, float freq, uint8_t fraction, double* amp, double* phase)
+{
+    double w = 2 * M_PI * freq / c->rate, re = 0, im = 0, x;
+    uint8_t dropped = c->shift - fraction;
+    uint32_t i;
+
+    for (i = 0; i < c->samples; i++)
+    {
+        x = (double)(goertzelPairs[2 * i + input] >> dropped) / (1 << fraction) - ADC_MIDSCALE;
+        re += x * cos(w * i);
+        im -= x * sin(w * i);
+    }
+    *amp = 2 * sqrt(re * re + im * im) / c->samples;
+    *phase = atan2(im, re) * 180 / M_PI;
+}
+
+static double wrapDegrees(double degrees)
+{
+    degrees = fmod(degrees, 360);
+    if (degrees > 180)
+        degrees -= 360;
+    if (degrees <= -180)
+        degrees += 360;
+    return degrees;
+}
+
+// Every bin of every case against the DFT, amplitude of both inputs and the phase between them
+static bool checkGoertzel(void)
+{
+    static GOERTZEL g;
+    float amp[2], phase[2];
+    double dftAmp[2], dftPhase[2], error, worstAmp = 0, worstPhase = 0;
+    uint32_t i, pairs;
+    uint8_t j, b, n;
+
+    for (j = 0; j < GOERTZEL_CASES; j++)
+    {
+        const GOERTZEL_CASE* c = &goertzelCases[j];
+
+        makeGoertzelPairs(c);
+        startGoertzel(&g, (float*)c->freqs, c->bins, c->rate, c->samples, c->shift);
+        for (i = 0; i < c->samples; i += pairs)
+        {
+            pairs = c->samples - i < GOERTZEL_BLOCK ? c->samples - i : GOERTZEL_BLOCK;
+            updateGoertzel(&g, &goertzelPairs[2 * i], pairs);
+        }
+        for (b = 0; b < c->bins; b++)
+        {
+            tried++;
+            for (n = 0; n < 2; n++)
+            {
+                getGoertzelResult(&g, n, b, &amp[n], &phase[n]);
+                getDftBin(c, n, c->freqs[b], g.fraction, &dftAmp[n], &dftPhase[n]);
+                error = fabs(amp[n] - dftAmp[n]);
+                if (error / dftAmp[n] > worstAmp)
+                    worstAmp = error / dftAmp[n];
+                if (error > GOERTZEL_AMP_ERROR * dftAmp[n] + GOERTZEL_AMP_FLOOR)
+                    noteMismatch("%s, %g Hz, IN%u: amplitude %.6f, DFT %.6f codes", c->name, c->freqs[b],
+                                 n + 1, amp[n], dftAmp[n]);
+            }
+            error = fabs(wrapDegrees((phase[1] - phase[0]) - (dftPhase[1] - dftPhase[0])));
+            if (error > worstPhase)
+                worstPhase = error;
+            if (error > GOERTZEL_PHASE_ERROR)
+                noteMismatch("%s, %g Hz: phase %.4f, DFT %.4f degrees", c->name, c->freqs[b],
+                             wrapDegrees(phase[1] - phase[0]), wrapDegrees(dftPhase[1] - dftPhase[0]));
+        }
+    }
+    printf("  worst amplitude %.2g of the DFT (limit %.0e + %g codes), phase %.2g degrees (limit %g)\n",
+           worstAmp, GOERTZEL_AMP_ERROR, GOERTZEL_AMP_FLOOR, worstPhase, GOERTZEL_PHASE_ERROR);
+    return mismatches == 0;
+}
+
+ /* ======================================= *
+  *                   FFT                   *
+  * ======================================= */
+
+// Capture pairs for the FFT: mode 0 tones off the bin grid, 1 uniform noise over the codes
+static void makeFftPairs(uint16_t n, uint8_t mode)
+{
+    uint16_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (mode == 0)
+        {
+            fftPairs[2 * i] = lround(ADC_MIDSCALE + 2040 * sin(2 * M_PI * 10.3 * i / n));
+            fftPairs[2 * i + 1] = lround(ADC_MIDSCALE + 1000 * cos(2 * M_PI * 37.7 * i / n));
+        }
+        else
+        {
+            fftPairs[2 * i] = getRandom() % 4096;
+            fftPairs[2 * i + 1] = getRandom() % 4096;
+        }
+    }
+}
+
+// Every bin of fftQ15() against X[k] / n of its own Q15 input in double, for both
+// test signals with and without the window, at 256, 512 and 1024 points
+static bool checkFft(void)
+{
+    static const uint16_t sizes[] = { 256, 512, 1024 };
+    int16_t* data = (int16_t*)fftPairs;
+    double re, im, c, sn, error, limit, sum, rms, worst = 0, worstRms = 0;
+    uint16_t i, k, n;
+    uint8_t s, mode, window, stages;
+
+    initFft();
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+        for (mode = 0; mode < 2; mode++)
+            for (window = 0; window < 2; window++)
+            {
+                n = sizes[s];
+                stages = log2(n);
+                makeFftPairs(n, mode);
+                prepareFft(fftPairs, n, window, 0);
+                for (i = 0; i < 2 * n; i++)
+                    fftInput[i] = data[i];
+                fftQ15(data, n);
+
+                tried++;
+                sum = 0;
+                for (k = 0; k < n; k++)
+                {
+                    re = im = 0;
+                    for (i = 0; i < n; i++)
+                    {
+                        c = cos(2 * M_PI * ((uint32_t)i * k % n) / n);
+                        sn = sin(2 * M_PI * ((uint32_t)i * k % n) / n);
+                        re += fftInput[2 * i] * c + fftInput[2 * i + 1] * sn;
+                        im += fftInput[2 * i + 1] * c - fftInput[2 * i] * sn;
+                    }
+                    limit = FFT_ERROR_LSB + stages * FFT_TWIDDLE_ERROR * hypot(re, im) / n;
+                    re = data[2 * k] - re / n;
+                    im = data[2 * k + 1] - im / n;
+                    sum += re * re + im * im;
+                    error = fmax(fabs(re), fabs(im));
+                    if (error / limit > worst)
+                        worst = error / limit;
+                    if (error > limit)
+                        noteMismatch("%u points, %s%s, bin %u off by %.2f LSB (limit %.2f)", n, mode ? "noise" : "tones",
+                                     window ? " (Hann)" : "", k, error, limit);
+                }
+                rms = sqrt(sum / (2 * n));
+                if (rms > worstRms)
+                    worstRms = rms;
+                if (rms > FFT_RMS_LSB)
+                    noteMismatch("%u points, %s%s, rms error %.2f LSB", n, mode ? "noise" : "tones",
+                                 window ? " (Hann)" : "", rms);
+            }
+    printf("  worst bin %.2f of its limit (%g LSB + %d ppm per stage), rms %.2f LSB (limit %g)\n",
+           worst, FFT_ERROR_LSB, (int)lround(FFT_TWIDDLE_ERROR * 1e6), worstRms, FFT_RMS_LSB);
+    return mismatches == 0;
+}
+
+ /* ======================================= *
+  *               DECIMATION                *
+  * ======================================= */
+
+// Effective bits the decimate.c comment documents for R = 1, 4, 16, 64, 256
+static const ENOB_POINT enobPoints[] =
+{
+    { 0, 10.2 },
+    { 2, 11.4 },
+    { 4, 12.5 },
+    { 6, 13.4 },
+    { 8, 14.4 },
+};
+#define ENOB_POINTS (sizeof(enobPoints) / sizeof(enobPoints[0]))
+
+static uint16_t enobIn[2 * ENOB_BLOCK];
+static uint16_t enobOut[2 * ENOB_BLOCK];
+
+// Standard normal from two uniforms (Box-Muller)
+static double getGaussian(void)
+{
+    double u = (getRandom() + 1.0) / 4294967297.0, v = getRandom() / 4294967296.0;
+
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// ADC model: the DC input plus noise (codes rms) on both inputs, quantized to 12 bits
+static void makeEnobBlock(double noise)
+{
+    double x;
+    uint16_t i;
+
+    for (i = 0; i < 2 * ENOB_BLOCK; i++)
+    {
+        x = nearbyint(ENOB_INPUT + noise * getGaussian());
+        enobIn[i] = x < 0 ? 0 : x > 4095 ? 4095 : x;
+    }
+}
+
+// Mean and rms noise in codes of ENOB_OUTPUTS outputs of IN1 at ratio 2^log2Ratio (0 is raw codes)
+static void measureEnob(uint8_t log2Ratio, double noise, double* mean, double* rms)
+{
+    static DECIMATOR d;
+    double sum = 0, squares = 0, x;
+    uint32_t outputs = 0;
+    uint16_t i, written;
+
+    initDecimator(&d, log2Ratio);
+    while (outputs < ENOB_OUTPUTS)
+    {
+        makeEnobBlock(noise);
+        if (log2Ratio == 0)
+        {
+            for (i = 0; i < ENOB_BLOCK; i++)
+                enobOut[2 * i] = enobIn[2 * i] << DECIMATE_FRACTION_BITS;
+            written = ENOB_BLOCK;
+        }
+        else
+            written = decimateBlock(&d, enobIn, ENOB_BLOCK, enobOut);
+        for (i = 0; i < written && outputs < ENOB_OUTPUTS; i++, outputs++)
+        {
+            x = (double)enobOut[2 * i] / (1 << DECIMATE_FRACTION_BITS);
+            sum += x;
+            squares += x * x;
+        }
+    }
+    *mean = sum / outputs;
+    *rms = sqrt(fmax(squares / outputs - *mean * *mean, 0));
+}
+
+// The dither model behind the decimate.c table: with 1 LSB rms of noise every ratio
+// matches its documented effective bits, and the mean finds the input between codes;
+// with no noise the outputs are the nearest code whatever the ratio
+static bool checkEnob(void)
+{
+    double mean, rms, enob, worst = 0;
+    uint8_t i;
+
+    printf("  R     ");
+    for (i = 0; i < ENOB_POINTS; i++)
+        printf(" %6u", 1u << enobPoints[i].log2Ratio);
+    printf("\n  ENOB  ");
+    for (i = 0; i < ENOB_POINTS; i++)
+    {
+        tried++;
+        measureEnob(enobPoints[i].log2Ratio, ENOB_NOISE, &mean, &rms);
+        enob = log2(4096 / (rms * sqrt(12)));
+        printf(" %6.2f", enob);
+        if (fabs(enob - enobPoints[i].enob) > worst)
+            worst = fabs(enob - enobPoints[i].enob);
+        if (fabs(enob - enobPoints[i].enob) > ENOB_BITS)
+            noteMismatch("R = %u: %.2f effective bits, documented %.1f", 1u << enobPoints[i].log2Ratio,
+                         enob, enobPoints[i].enob);
+        if (enobPoints[i].log2Ratio > 0 && fabs(mean - ENOB_INPUT) > ENOB_MEAN_CODES)
+            noteMismatch("R = %u: mean %.4f codes with dither, input %.4f", 1u << enobPoints[i].log2Ratio,
+                         mean, ENOB_INPUT);
+    }
+    printf("\n");
+
+    tried++;
+    measureEnob(DECIMATE_MAX_LOG2, 0, &mean, &rms);
+    if (rms != 0 || mean != nearbyint(ENOB_INPUT))
+        noteMismatch("R = %u without dither: mean %.4f, rms %.4f codes, expected the code %.0f",
+                     1u << DECIMATE_MAX_LOG2, mean, rms, nearbyint(ENOB_INPUT));
+    printf("  worst %.2f bits from the table (limit %g)\n", worst, ENOB_BITS);
+    return mismatches == 0;
+}
+
+ /* ======================================= *
+  *                  MAIN                   *
+  * ======================================= */
+
+static const NUMERIC_CHECK checks[] =
+{
+    { "scan", checkScan },
+    { "goertzel", checkGoertzel },
+    { "fft", checkFft },
+    { "enob", checkEnob },
+};
+#define CHECKS (sizeof(checks) / sizeof(checks[0]))
+
+static void usage(void)
+{
+    uint8_t i;
+
+    fprintf(stderr, "usage: numeric [-n COUNT] [-v] [CHECK...]\nchecks:");
+    for (i = 0; i < CHECKS; i++)
+        fprintf(stderr, " %s", checks[i].name);
+    fprintf(stderr, "\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    bool selected[CHECKS], ok;
+    uint8_t i, matched = 0, passed = 0;
+    int option, j;
+
+    while ((option = getopt(argc, argv, "n:v")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            count = strtoul(optarg, 0, 10);
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            usage();
+        }
+    }
+    for (i = 0; i < CHECKS; i++)
+    {
+        selected[i] = optind == argc;
+        for (j = optind; j < argc; j++)
+            if (strcmp(argv[j], checks[i].name) == 0)
+                selected[i] = true;
+        matched += selected[i];
+    }
+    if (matched == 0)
+        usage();
+
+    for (i = 0; i < CHECKS; i++)
+    {
+        if (!selected[i])
+            continue;
+        mismatches = tried = 0;
+        seed = NUMERIC_SEED;
+        // the mismatches are listed as they are found, the result line follows them
+        ok = checks[i].run();
+        printf("%s: %s, %lu inputs, %lu mismatches\n", checks[i].name, ok ? "PASS" : "FAIL",
+               (unsigned long)tried, (unsigned long)mismatches);
+        passed += ok;
+    }
+    printf("%u of %u passed\n", passed, matched);
+    return passed == matched ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/*
+ * regs.h
+ *
+ *  Forced ahead of every firmware file in the host build (-include), after
+ *  the real device header. Plain registers are memory in the simulated
+ *  register file (sim.c maps it at the device addresses), the few with side
+ *  effects are routed through sim.c so the models see every access:
+ *
+ *    UART0 DR/FR          uart.c, the shell on stdin/stdout or a PTY
+ *    SSI1 DR/SR           mcp4822.c, words clocked into the DAC
+ *    ADC0 SSFIFOn/SSFSTATn  loopback of the DAC outputs
+ *    EEPROM EERDWR/EEDONE   word store, optionally backed by a file
+ *    DWT CYCCNT           virtual time
+ *
+ *  Each hook returns a cell holding what a read sees. Whether the firmware
+ *  then read or wrote it is settled at the next hook of the same kind
+ *  (sim.c), so the firmware sources compile unchanged.
+ */
+
+#ifndef REGS_H_
+#define REGS_H_
+
+#include <stdint.h>
+#include "tm4c123gh6pm.h"
+#include "cycles.h"
+
+volatile uint32_t* simUart0Data(void);
+volatile uint32_t* simUart0Flags(void);
+volatile uint32_t* simSsi1Data(void);
+volatile uint32_t* simSsi1Status(void);
+volatile uint32_t* simAdc0Fifo(uint8_t sequencer);
+volatile uint32_t* simAdc0FifoStatus(uint8_t sequencer);
+volatile uint32_t* simEepromData(void);
+volatile uint32_t* simEepromDone(void);
+volatile uint32_t* simCycleCount(void);
+
+#undef UART0_DR_R
+#define UART0_DR_R (*simUart0Data())
+#undef UART0_FR_R
+#define UART0_FR_R (*simUart0Flags())
+#undef SSI1_DR_R
+#define SSI1_DR_R (*simSsi1Data())
+#undef SSI1_SR_R
+#define SSI1_SR_R (*simSsi1Status())
+#undef ADC0_SSFIFO1_R
+#define ADC0_SSFIFO1_R (*simAdc0Fifo(1))
+#undef ADC0_SSFIFO2_R
+#define ADC0_SSFIFO2_R (*simAdc0Fifo(2))
+#undef ADC0_SSFIFO3_R
+#define ADC0_SSFIFO3_R (*simAdc0Fifo(3))
+#undef ADC0_SSFSTAT1_R
+#define ADC0_SSFSTAT1_R (*simAdc0FifoStatus(1))
+#undef ADC0_SSFSTAT2_R
+#define ADC0_SSFSTAT2_R (*simAdc0FifoStatus(2))
+#undef ADC0_SSFSTAT3_R
+#define ADC0_SSFSTAT3_R (*simAdc0FifoStatus(3))
+#undef EEPROM_EERDWR_R
+#define EEPROM_EERDWR_R (*simEepromData())
+#undef EEPROM_EEDONE_R
+#define EEPROM_EEDONE_R (*simEepromDone())
+#undef DWT_CYCCNT_R
+#define DWT_CYCCNT_R (*simCycleCount())
+
+// TI compiler intrinsic, the host has no cycle exact delays
+#define _delay_cycles(cycles) ((void)(cycles))
+
+#endif /* REGS_H_ */
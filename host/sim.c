@@ -0,0 +1,624 @@
+/*
+ * sim.c
+ *
+ *  Host stand-in for the TM4C123 (see sim.h). The peripheral and core
+ *  register blocks are mapped at their device addresses, so every register
+ *  the firmware touches is plain memory unless regs.h routes it here.
+ *
+ *  Routed registers hand the firmware a cell per context (main or ISR).
+ *  A data register cell is loaded with what a read would return; at the
+ *  next hook of that context the cell is checked: changed means the
+ *  firmware wrote it, unchanged means it read it (the UART pops a
+ *  character). Read values carry a tag in the high bits no write of a
+ *  character or SPI word can produce.
+ *
+ *  ISRs run from dispatch(): from the 1 ms signal (in virtual time, a
+ *  signal per 1 ms of CPU that finds the main context spinning without
+ *  touching a routed register), from hooks of the main context, or from
+ *  runSim()/waitSim(). The main context is marked busy
+ *  while inside a hook and a signal arriving then is deferred to the end
+ *  of the hook, so the models are never entered twice.
+ *
+ *  The ADC converts on a PSSI trigger, noticed lazily at the next status
+ *  or FIFO read. Its inputs see the board outputs: AIN8 (IN2) OUT A and
+ *  AIN9 (IN1) OUT B, through the nominal +/-5 V front end.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include "tm4c123gh6pm.h"
+#include "clock.h"
+#include "dds.h"
+#include "eeprom.h"
+#include "sim.h"
+#include "uart.h"
+#include "mcp4822.h"
+
+#define SIM_PERIPHERAL_BASE 0x40000000UL
+#define SIM_CORE_BASE 0xE0000000UL
+#define SIM_REGION_SIZE 0x00100000UL
+
+#define SIM_SIGNAL_US 1000          // ISR dispatch period in real time
+#define SIM_STALL_US 1000           // CPU time between checks for a main context stuck in a loop
+#define SIM_STALL_MAX_EVENTS 64     // ISRs run per check while it stays stuck
+#define SIM_MAX_LAG_MS 50           // real time ISRs further behind than this are skipped
+
+#define SIM_READ_TAG 0xA5000000     // marks a loaded cell, no write sets these bits
+
+#define ADC_IN_LOW -5.0f            // nominal front end, IN_OFFSET / IN_SLOPE in sigGen.c
+#define ADC_IN_HIGH 5.0f
+
+// ISRs, placed on their vectors by the startup file on the board
+void tickIsr(void);
+void levelIsr(void);
+void timer2tick(void);
+void loadIsr(void);
+
+typedef struct _SIM_IRQ
+{
+    void (*isr)(void);
+    volatile uint32_t* control;
+    uint32_t enable;
+    volatile uint32_t* mask;
+    uint32_t maskBit;
+    volatile uint32_t* reload;
+    bool running;
+    uint64_t next;
+} SIM_IRQ;
+
+// Highest priority first, it goes first when two are due together
+static SIM_IRQ irqs[] =
+{
+    { tickIsr, &TIMER4_CTL_R, TIMER_CTL_TAEN, &TIMER4_IMR_R, TIMER_IMR_TATOIM, &TIMER4_TAILR_R, false, 0 },
+    { levelIsr, &TIMER3_CTL_R, TIMER_CTL_TAEN, &TIMER3_IMR_R, TIMER_IMR_TATOIM, &TIMER3_TAILR_R, false, 0 },
+    { timer2tick, &TIMER2_CTL_R, TIMER_CTL_TAEN, &TIMER2_IMR_R, TIMER_IMR_TATOIM, &TIMER2_TAILR_R, false, 0 },
+    { loadIsr, &NVIC_ST_CTRL_R, NVIC_ST_CTRL_ENABLE, &NVIC_ST_CTRL_R, NVIC_ST_CTRL_INTEN, &NVIC_ST_RELOAD_R, false, 0 },
+};
+#define SIM_IRQS (sizeof(irqs) / sizeof(irqs[0]))
+
+// Data registers checked for a read or a write at the next hook
+typedef enum _SIM_PORT
+{
+    SIM_UART_DATA,
+    SIM_SSI_DATA,
+    SIM_EEPROM_DATA,
+    SIM_PORTS
+} SIM_PORT;
+
+typedef enum _SIM_CELL
+{
+    SIM_UART_FLAGS = SIM_PORTS,
+    SIM_SSI_STATUS,
+    SIM_ADC_FIFO,
+    SIM_ADC_STATUS,
+    SIM_EEPROM_DONE,
+    SIM_CYCLES,
+    SIM_CELLS
+} SIM_CELL;
+
+#define SIM_CONTEXTS 2 // main, ISR
+
+static SIM_CLOCK simClock = SIM_VIRTUAL;
+static uint64_t simTime = 0;        // system clocks since initSim()
+static uint64_t realStart = 0;
+static uint64_t isrStart = 0;       // virtual and real time the running ISR was entered at
+static uint64_t isrEntry = 0;
+static volatile sig_atomic_t context = 0;
+static volatile sig_atomic_t busy = 0;
+static volatile sig_atomic_t deferred = 0;
+static volatile uint32_t hooks = 0; // hooks entered by the main context
+static uint32_t stallHooks = 0;
+static uint32_t stallEvents = 1;
+static uint32_t flagsHook = 0;
+static void (*idleHandler)(void) = 0;
+
+static volatile uint32_t cells[SIM_CONTEXTS][SIM_CELLS];
+static uint32_t loaded[SIM_CONTEXTS][SIM_PORTS];
+static bool pending[SIM_CONTEXTS][SIM_PORTS];
+static uint16_t eepromAddress[SIM_CONTEXTS];
+
+static uint32_t eeprom[EEPROM_WORDS];
+static int eepromFd = -1;
+static uint8_t adcCount[4];
+static const uint8_t adcDepth[4] = { 8, 4, 4, 1 };
+
+ /* ======================================= *
+  *              REGISTER FILE              *
+  * ======================================= */
+
+static void mapRegion(uintptr_t base)
+{
+    void* p = mmap((void*)base, SIM_REGION_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (p != (void*)base)
+    {
+        fprintf(stderr, "sim: cannot map the register file at 0x%08lx\n", (unsigned long)base);
+        exit(1);
+    }
+}
+
+// Runs before main(), the firmware's static data may already point at registers
+__attribute__((constructor))
+static void mapRegisterFile(void)
+{
+    mapRegion(SIM_PERIPHERAL_BASE);
+    mapRegion(SIM_CORE_BASE);
+    SYSCTL_RIS_R = SYSCTL_RIS_PLLLRIS; // PLL locked
+    memset(eeprom, 0xFF, sizeof(eeprom)); // erased
+}
+
+ /* ======================================= *
+  *                  TIME                   *
+  * ======================================= */
+
+static uint64_t getRealClocks(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000 + now.tv_nsec) * SYSTEM_CLOCK_MHZ / 1000 - realStart;
+}
+
+// Time seen by a CYCLE_COUNT read, in virtual time every read costs SIM_READ_CLOCKS
+static uint64_t readTime(void)
+{
+    uint64_t now;
+
+    if (simClock == SIM_VIRTUAL)
+        return simTime += SIM_READ_CLOCKS;
+    now = context ? isrStart + getRealClocks() - isrEntry : getRealClocks();
+    if (now > simTime)
+        simTime = now;
+    return simTime;
+}
+
+uint64_t getSimTime(void)
+{
+    return simTime;
+}
+
+ /* ======================================= *
+  *               INTERRUPTS                *
+  * ======================================= */
+
+static uint64_t getPeriod(SIM_IRQ* irq)
+{
+    return (uint64_t)*irq->reload + 1;
+}
+
+// Starts or stops each source from its registers, returns the first one due by until
+static SIM_IRQ* getDue(uint64_t until)
+{
+    SIM_IRQ* due = 0;
+    uint8_t i;
+
+    for (i = 0; i < SIM_IRQS; i++)
+    {
+        SIM_IRQ* irq = &irqs[i];
+        bool enabled = (*irq->control & irq->enable) && (*irq->mask & irq->maskBit);
+
+        if (enabled && !irq->running)
+            irq->next = simTime + getPeriod(irq);
+        irq->running = enabled;
+        if (irq->running && irq->next <= until && (due == 0 || irq->next < due->next))
+            due = irq;
+    }
+    return due;
+}
+
+static void settlePorts(uint8_t c);
+
+static void runIsr(SIM_IRQ* irq)
+{
+    uint64_t now = simTime;
+
+    if (simClock == SIM_REAL_TIME)
+    {
+        isrStart = simTime = irq->next;
+        isrEntry = getRealClocks();
+    }
+    else if (irq->next > simTime)
+        simTime = irq->next;
+
+    context = 1;
+    irq->isr();
+    settlePorts(1);
+    context = 0;
+
+    irq->next += getPeriod(irq);
+    if (simTime < now)
+        simTime = now;
+}
+
+// Runs every ISR due by until in order, the main context must not be inside a model
+static void dispatch(uint64_t until)
+{
+    SIM_IRQ* irq;
+
+    while ((irq = getDue(until)) != 0)
+    {
+        // the host fell behind (e.g. it was suspended), skip rather than replay
+        if (simClock == SIM_REAL_TIME && until - irq->next > (uint64_t)SIM_MAX_LAG_MS * SYSTEM_CLOCK_MHZ * 1000)
+            irq->next = until;
+        runIsr(irq);
+    }
+    flushSimUart();
+}
+
+static void enterHook(void)
+{
+    busy++;
+    if (!context)
+        hooks++;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static void leaveHook(void)
+{
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    while (busy == 1 && deferred && !context)
+    {
+        deferred = 0;
+        dispatch(simClock == SIM_REAL_TIME ? readTime() : simTime);
+    }
+    busy--;
+}
+
+static void onSignal(int signal)
+{
+    (void)signal;
+    if (busy || context)
+    {
+        deferred = 1;
+        return;
+    }
+    busy = 1;
+    if (simClock == SIM_REAL_TIME)
+        dispatch(readTime());
+    else if (hooks == stallHooks)
+    {
+        // spinning on a flag only an ISR sets (e.g. commitStaged(), 'wait'), let the next
+        // ISRs run, more each time the loop is still spinning
+        SIM_IRQ* irq;
+        uint32_t i;
+
+        for (i = 0; i < stallEvents && (irq = getDue(UINT64_MAX)) != 0; i++)
+            dispatch(irq->next);
+        if (stallEvents < SIM_STALL_MAX_EVENTS)
+            stallEvents *= 2;
+    }
+    else
+        stallEvents = 1;
+    stallHooks = hooks;
+    busy = 0;
+}
+
+void initSim(SIM_CLOCK clock)
+{
+    struct sigaction action;
+    struct itimerval timer;
+    bool real = clock == SIM_REAL_TIME;
+
+    simClock = clock;
+    simTime = 0;
+    realStart = 0;
+    realStart = getRealClocks();
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(real ? SIGALRM : SIGVTALRM, &action, 0);
+    // virtual time counts CPU time only, a host that is busy elsewhere is no stall
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = real ? SIM_SIGNAL_US : SIM_STALL_US;
+    timer.it_value = timer.it_interval;
+    setitimer(real ? ITIMER_REAL : ITIMER_VIRTUAL, &timer, 0);
+}
+
+// Called when the shell waits for input, instead of waiting on the UART input
+void setSimIdle(void (*idle)(void))
+{
+    idleHandler = idle;
+}
+
+// Advances virtual time by clocks, running the ISRs that come due on the way
+void runSim(uint64_t clocks)
+{
+    uint64_t until = simTime + clocks;
+
+    enterHook();
+    dispatch(until);
+    if (simTime < until)
+        simTime = until;
+    leaveHook();
+}
+
+// waitMicrosecond() on the host, real time sleeps while the signal runs the ISRs
+void waitSim(uint64_t clocks)
+{
+    struct timespec pause = { 0, 0 };
+    uint64_t until, now;
+
+    if (simClock == SIM_VIRTUAL || context)
+    {
+        if (simClock == SIM_VIRTUAL && !context)
+            runSim(clocks);
+        else
+            simTime += clocks;
+        return;
+    }
+    until = readTime() + clocks;
+    flushSimUart();
+    while ((now = readTime()) < until)
+    {
+        pause.tv_nsec = (until - now) * 1000 / SYSTEM_CLOCK_MHZ;
+        if (pause.tv_nsec > SIM_SIGNAL_US * 1000)
+            pause.tv_nsec = SIM_SIGNAL_US * 1000;
+        nanosleep(&pause, 0);
+    }
+}
+
+ /* ======================================= *
+  *             ROUTED REGISTERS            *
+  * ======================================= */
+
+static void writePort(SIM_PORT port, uint8_t c, uint32_t value)
+{
+    switch (port)
+    {
+    case SIM_UART_DATA:
+        putSimUart(value & 0xFF);
+        break;
+    case SIM_SSI_DATA:
+        writeMcp4822(value & 0xFFFF, simTime);
+        break;
+    case SIM_EEPROM_DATA:
+        eeprom[eepromAddress[c]] = value;
+        if (eepromFd >= 0 && pwrite(eepromFd, &value, 4, eepromAddress[c] * 4) != 4)
+            perror("sim: eeprom");
+        break;
+    default:
+        break;
+    }
+}
+
+// Settles the last access to port by context c
+static void settle(SIM_PORT port, uint8_t c)
+{
+    if (!pending[c][port])
+        return;
+    pending[c][port] = false;
+    if (cells[c][port] != loaded[c][port])
+        writePort(port, c, cells[c][port]);
+    else if (port == SIM_UART_DATA)
+        popSimUart();
+}
+
+static void settlePorts(uint8_t c)
+{
+    uint8_t port;
+
+    for (port = 0; port < SIM_PORTS; port++)
+        settle(port, c);
+}
+
+// Settles what the current context left in the data registers, e.g. before the LDAC edge
+void settleSim(void)
+{
+    enterHook();
+    settlePorts(context);
+    leaveHook();
+}
+
+static volatile uint32_t* load(SIM_PORT port, uint32_t value)
+{
+    loaded[context][port] = value;
+    cells[context][port] = value;
+    pending[context][port] = true;
+    return &cells[context][port];
+}
+
+static volatile uint32_t* set(SIM_CELL cell, uint32_t value)
+{
+    cells[context][cell] = value;
+    return &cells[context][cell];
+}
+
+// The shell is waiting for a character
+static void idle(void)
+{
+    flushSimUart();
+    if (idleHandler)
+    {
+        idleHandler();
+        return;
+    }
+    if (simClock == SIM_VIRTUAL)
+    {
+        // no time passes between commands, the signal must not step the ISRs meanwhile
+        if (!pollSimUart(-1))
+            exit(0);
+        return;
+    }
+    // let the signal run the ISRs while blocked on the input
+    busy--;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    if (!pollSimUart(SIM_SIGNAL_US / 1000))
+        exit(0);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    busy++;
+}
+
+volatile uint32_t* simUart0Data(void)
+{
+    volatile uint32_t* cell;
+
+    enterHook();
+    // a character the main context already wrote goes out before this ISR's
+    if (context && pending[0][SIM_UART_DATA] && cells[0][SIM_UART_DATA] != loaded[0][SIM_UART_DATA])
+        settle(SIM_UART_DATA, 0);
+    settle(SIM_UART_DATA, context);
+    cell = load(SIM_UART_DATA, SIM_READ_TAG | peekSimUart());
+    leaveHook();
+    return cell;
+}
+
+volatile uint32_t* simUart0Flags(void)
+{
+    volatile uint32_t* cell;
+
+    enterHook();
+    settle(SIM_UART_DATA, context);
+    // polled again with nothing in between, the shell is waiting for input
+    if (!context && isSimUartEmpty() && hooks == flagsHook + 1)
+        idle();
+    flagsHook = hooks;
+    cell = set(SIM_UART_FLAGS, UART_FR_TXFE | (isSimUartEmpty() ? UART_FR_RXFE : 0));
+    leaveHook();
+    return cell;
+}
+
+volatile uint32_t* simSsi1Data(void)
+{
+    volatile uint32_t* cell;
+
+    enterHook();
+    settle(SIM_SSI_DATA, context);
+    cell = load(SIM_SSI_DATA, SIM_READ_TAG);
+    leaveHook();
+    return cell;
+}
+
+volatile uint32_t* simSsi1Status(void)
+{
+    volatile uint32_t* cell;
+
+    enterHook();
+    settle(SIM_SSI_DATA, context);
+    cell = set(SIM_SSI_STATUS, SSI_SR_TNF | SSI_SR_TFE);
+    leaveHook();
+    return cell;
+}
+
+// Takes the PSSI triggers written since the last look as conversions
+static void triggerAdc(void)
+{
+    uint32_t pssi = ADC0_PSSI_R;
+    uint8_t i;
+
+    for (i = 0; i < 4; i++)
+        if ((pssi & (1 << i)) && (ADC0_ACTSS_R & (1 << i)) && adcCount[i] < adcDepth[i])
+            adcCount[i]++;
+    ADC0_PSSI_R = 0;
+}
+
+// Board output voltage of channel 0 (A) or 1 (B), the output stage inverts and scales the DAC
+static float getOutputVoltage(uint8_t channel)
+{
+    return channel == 0 ? OUT_OFFSET_A + OUT_SLOPE_A * getMcp4822Voltage(0)
+                        : OUT_OFFSET_B + OUT_SLOPE_B * getMcp4822Voltage(1);
+}
+
+static uint16_t convert(uint8_t input)
+{
+    float volts, code;
+
+    if (input == 8)
+        volts = getOutputVoltage(0);
+    else if (input == 9)
+        volts = getOutputVoltage(1);
+    else
+        return 0;
+    code = (volts - ADC_IN_LOW) / (ADC_IN_HIGH - ADC_IN_LOW) * 4096;
+    return code < 0 ? 0 : code > 4095 ? 4095 : (uint16_t)code;
+}
+
+volatile uint32_t* simAdc0Fifo(uint8_t sequencer)
+{
+    volatile uint32_t* cell;
+    uint32_t mux = sequencer == 3 ? ADC0_SSMUX3_R : sequencer == 2 ? ADC0_SSMUX2_R : ADC0_SSMUX1_R;
+
+    enterHook();
+    triggerAdc();
+    if (adcCount[sequencer] > 0)
+        adcCount[sequencer]--;
+    cell = set(SIM_ADC_FIFO, convert(mux & 0xF));
+    leaveHook();
+    return cell;
+}
+
+volatile uint32_t* simAdc0FifoStatus(uint8_t sequencer)
+{
+    volatile uint32_t* cell;
+
+    enterHook();
+    triggerAdc();
+    cell = set(SIM_ADC_STATUS, (adcCount[sequencer] == 0 ? ADC_SSFSTAT0_EMPTY : 0)
+                              | (adcCount[sequencer] == adcDepth[sequencer] ? ADC_SSFSTAT0_FULL : 0));
+    leaveHook();
+    return cell;
+}
+
+// Keeps the EEPROM in path (created erased), so macros and saved state survive a restart
+bool setSimEepromFile(const char* path)
+{
+    eepromFd = open(path, O_RDWR | O_CREAT, 0644);
+    if (eepromFd < 0)
+        return false;
+    if (pread(eepromFd, eeprom, sizeof(eeprom), 0) != sizeof(eeprom))
+    {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+        if (pwrite(eepromFd, eeprom, sizeof(eeprom), 0) != sizeof(eeprom))
+            return false;
+    }
+    return true;
+}
+
+volatile uint32_t* simEepromData(void)
+{
+    volatile uint32_t* cell;
+
+    enterHook();
+    settle(SIM_EEPROM_DATA, context);
+    eepromAddress[context] = ((EEPROM_EEBLOCK_R << 4) | (EEPROM_EEOFFSET_R & 0xF)) % EEPROM_WORDS;
+    cell = load(SIM_EEPROM_DATA, eeprom[eepromAddress[context]]);
+    leaveHook();
+    return cell;
+}
+
+volatile uint32_t* simEepromDone(void)
+{
+    volatile uint32_t* cell;
+
+    enterHook();
+    settle(SIM_EEPROM_DATA, context);
+    cell = set(SIM_EEPROM_DONE, 0);
+    leaveHook();
+    return cell;
+}
+
+// CYCLE_COUNT, the main context also lets due ISRs run here
+volatile uint32_t* simCycleCount(void)
+{
+    volatile uint32_t* cell;
+    uint32_t now;
+
+    enterHook();
+    now = readTime();
+    if (!context)
+        dispatch(simTime);
+    cell = set(SIM_CYCLES, now);
+    leaveHook();
+    return cell;
+}
@@ -0,0 +1,45 @@
+/*
+ * sim.h
+ *
+ *  Host stand-in for the TM4C123 the firmware runs on: the register file,
+ *  virtual time and the interrupts the firmware uses
+ *
+ *  Timer 4A (tickIsr), Timer 3A (levelIsr), Timer 2A (timer2tick) and
+ *  SysTick (loadIsr) fire from their register state, one at a time with no
+ *  nesting. Timer 1, the ADC0 SS1 capture and uDMA are not modelled, so
+ *  capture based commands time out with an ERROR.
+ *
+ *  Real time: virtual time follows the host clock and a 1 ms signal runs
+ *  the ISRs that came due, like the board on a desk.
+ *  Virtual: time only moves when the firmware waits or reads CYCLE_COUNT,
+ *  or when the host program calls runSim(), so runs repeat exactly. A
+ *  loop waiting on a flag an ISR sets (e.g. 'wait' while playing) gets the
+ *  next ISRs run for it.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum _SIM_CLOCK
+{
+    SIM_REAL_TIME,
+    SIM_VIRTUAL
+} SIM_CLOCK;
+
+#define SIM_READ_CLOCKS 4 // virtual clocks per CYCLE_COUNT read
+
+// The firmware's main(), renamed in the host build
+int firmwareMain(void);
+
+void initSim(SIM_CLOCK clock);
+void setSimIdle(void (*idle)(void));
+bool setSimEepromFile(const char* path);
+uint64_t getSimTime(void);
+void runSim(uint64_t clocks);
+void waitSim(uint64_t clocks);
+void settleSim(void);
+
+#endif /* SIM_H_ */
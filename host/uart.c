@@ -0,0 +1,148 @@
+/*
+ * uart.c
+ *
+ *  UART0 model for the host build. Received characters queue up from a
+ *  file descriptor (stdin or a PTY) or from the host program, transmitted
+ *  ones are buffered and written out, or kept for the host program to read
+ *  when there is no output descriptor.
+ *
+ *  The shell ends a line on CR, so a LF is taken as CR and the LF of a
+ *  CR LF pair is dropped; a line typed on a terminal or piped in works
+ *  like one sent from a serial terminal.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include "uart.h"
+
+static uint8_t rxQueue[SIM_UART_RX_SIZE];
+static uint16_t rxHead = 0, rxTail = 0;   // read at head, written at tail
+static bool rxLastCr = false;
+static int rxFd = -1;
+
+static char txBuffer[SIM_UART_TX_SIZE];
+static uint32_t txCount = 0;
+static int txFd = -1;
+
+// inFd < 0 takes input from queueSimUart() only, outFd < 0 keeps output for readSimUart()
+void initSimUart(int inFd, int outFd)
+{
+    rxFd = inFd;
+    txFd = outFd;
+    rxHead = rxTail = 0;
+    txCount = 0;
+}
+
+static void receive(uint8_t c)
+{
+    uint16_t next = (rxTail + 1) % SIM_UART_RX_SIZE;
+
+    if (c == '\n' && rxLastCr)
+    {
+        rxLastCr = false;
+        return;
+    }
+    rxLastCr = c == '\r';
+    if (c == '\n')
+        c = '\r';
+    if (next == rxHead)
+        return; // overrun, like a full FIFO the character is lost
+    rxQueue[rxTail] = c;
+    rxTail = next;
+}
+
+void queueSimUart(const char* text)
+{
+    while (*text)
+        receive(*text++);
+}
+
+bool isSimUartEmpty(void)
+{
+    return rxHead == rxTail;
+}
+
+uint8_t peekSimUart(void)
+{
+    return isSimUartEmpty() ? 0 : rxQueue[rxHead];
+}
+
+void popSimUart(void)
+{
+    if (!isSimUartEmpty())
+        rxHead = (rxHead + 1) % SIM_UART_RX_SIZE;
+}
+
+void putSimUart(uint8_t c)
+{
+    if (txCount == SIM_UART_TX_SIZE)
+        flushSimUart();
+    if (txCount < SIM_UART_TX_SIZE)
+        txBuffer[txCount++] = c;
+}
+
+// Writes out what was transmitted, nothing when the output is kept
+// A descriptor that stays full (e.g. a PTY nobody reads) drops it, like a line with no listener
+void flushSimUart(void)
+{
+    struct pollfd fd = { txFd, POLLOUT, 0 };
+    uint32_t sent = 0;
+    ssize_t n;
+
+    if (txFd < 0)
+        return;
+    while (sent < txCount)
+    {
+        n = write(txFd, txBuffer + sent, txCount - sent);
+        if (n > 0)
+            sent += n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && errno == EAGAIN && poll(&fd, 1, SIM_UART_STALL_MS) > 0)
+            continue;
+        else
+            break;
+    }
+    txCount = 0;
+}
+
+// Waits up to timeoutMs (-1 forever) for input, false once the input has ended
+bool pollSimUart(int timeoutMs)
+{
+    struct pollfd fd = { rxFd, POLLIN, 0 };
+    uint8_t data[256];
+    ssize_t i, n;
+
+    if (rxFd < 0)
+        return true;
+    if (poll(&fd, 1, timeoutMs) <= 0)
+        return true;
+    n = read(rxFd, data, sizeof(data));
+    // a PTY with no terminal on the other side hangs up (EIO) until one opens it
+    if (n < 0 && errno == EIO && timeoutMs > 0)
+        usleep(timeoutMs * 1000);
+    if (n < 0)
+        return errno == EINTR || errno == EAGAIN || errno == EIO;
+    if (n == 0)
+        return false;
+    for (i = 0; i < n; i++)
+        receive(data[i]);
+    return true;
+}
+
+// Takes up to size - 1 kept output characters as a string, returns how many
+uint32_t readSimUart(char* text, uint32_t size)
+{
+    uint32_t i, n = txCount < size - 1 ? txCount : size - 1;
+
+    for (i = 0; i < n; i++)
+        text[i] = txBuffer[i];
+    text[n] = '\0';
+    for (i = n; i < txCount; i++)
+        txBuffer[i - n] = txBuffer[i];
+    txCount -= n;
+    return n;
+}
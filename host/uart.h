@@ -0,0 +1,27 @@
+/*
+ * uart.h
+ *
+ *  UART0 model for the host build, the shell's serial port
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_UART_RX_SIZE 4096
+#define SIM_UART_TX_SIZE 65536
+#define SIM_UART_STALL_MS 200   // output waits this long for a reader before it is dropped
+
+void initSimUart(int inFd, int outFd);
+void queueSimUart(const char* text);
+bool isSimUartEmpty(void);
+uint8_t peekSimUart(void);
+void popSimUart(void);
+void putSimUart(uint8_t c);
+void flushSimUart(void);
+bool pollSimUart(int timeoutMs);
+uint32_t readSimUart(char* text, uint32_t size);
+
+#endif /* UART_H_ */
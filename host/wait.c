@@ -0,0 +1,16 @@
+/*
+ * wait.c
+ *
+ *  waitMicrosecond() for the host build, sigGen/wait.c is a Cortex-M4
+ *  loop. The wait passes in virtual time, or sleeps in real time (sim.c).
+ */
+
+#include <stdint.h>
+#include "clock.h"
+#include "wait.h"
+#include "sim.h"
+
+void waitMicrosecond(uint32_t us)
+{
+    waitSim((uint64_t)us * SYSTEM_CLOCK_MHZ);
+}
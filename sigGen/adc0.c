@@ -22,6 +22,7 @@
 #include "adc0.h"
 
 #define ADC_CTL_DITHER          0x00000040
+#define ADC_ACTSS_ADEN1         0x00000200
 
 //-----------------------------------------------------------------------------
 // Global variables
@@ -59,6 +60,16 @@ void setAdc0Ss2_3Log2AverageCount(uint8_t log2AverageCount)
     ADC0_ACTSS_R |= (ADC_ACTSS_ASEN3 | ADC_ACTSS_ASEN2); // enable SS3 for operation
 }
 
+// Dither spreads a steady input over neighbouring codes so averaging and
+// decimation can resolve below one LSB
+void setAdc0Dither(bool on)
+{
+    if (on)
+        ADC0_CTL_R |= ADC_CTL_DITHER;
+    else
+        ADC0_CTL_R &= ~ADC_CTL_DITHER;
+}
+
 // Set SS3 analog input
 void setAdc0Ss3Mux(uint8_t input)
 {
@@ -91,3 +102,29 @@ int16_t readAdc0Ss2()
     while (ADC0_SSFSTAT2_R & ADC_SSFSTAT2_EMPTY);
     return ADC0_SSFIFO2_R;                           // get single result from the FIFO
 }
+
+// Configure SS1 to sample input0 then input1 on every timer trigger
+// Results are moved by uDMA, the SS1 interrupt signals a finished transfer
+void initAdc0Ss1Capture(uint8_t input0, uint8_t input1)
+{
+    ADC0_ACTSS_R &= ~ADC_ACTSS_ASEN1;                // disable sample sequencer 1 (SS1) for programming
+    ADC0_EMUX_R = (ADC0_EMUX_R & ~ADC_EMUX_EM1_M) | ADC_EMUX_EM1_TIMER;
+                                                     // select timer as the SS1 trigger
+    ADC0_SSMUX1_R = (input1 << ADC_SSMUX1_MUX1_S) | (input0 << ADC_SSMUX1_MUX0_S);
+    ADC0_SSCTL1_R = ADC_SSCTL1_END1 | ADC_SSCTL1_IE1;  // two samples, request uDMA after the second
+    ADC0_ISC_R = ADC_ISC_IN1;
+    ADC0_IM_R |= ADC_IM_MASK1;
+}
+
+void enableAdc0Ss1(void)
+{
+    ADC0_ISC_R = ADC_ISC_IN1;
+    ADC0_ACTSS_R |= ADC_ACTSS_ASEN1 | ADC_ACTSS_ADEN1;
+}
+
+void disableAdc0Ss1(void)
+{
+    ADC0_ACTSS_R &= ~(ADC_ACTSS_ASEN1 | ADC_ACTSS_ADEN1);
+    while (!(ADC0_SSFSTAT1_R & ADC_SSFSTAT1_EMPTY))
+        (void)ADC0_SSFIFO1_R;                        // drop anything left in the FIFO
+}
@@ -25,9 +25,13 @@
 
 void initAdc0Ss2_3();
 void setAdc0Ss2_3Log2AverageCount(uint8_t log2AverageCount);
+void setAdc0Dither(bool on);
 void setAdc0Ss3Mux(uint8_t input);
 void setAdc0Ss2Mux(uint8_t input);
 int16_t readAdc0Ss3(void);
 int16_t readAdc0Ss2(void);
+void initAdc0Ss1Capture(uint8_t input0, uint8_t input1);
+void enableAdc0Ss1(void);
+void disableAdc0Ss1(void);
 
 #endif
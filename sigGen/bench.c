@@ -0,0 +1,150 @@
+/*
+ * bench.c
+ *
+ *  The cases are plain C over the register-free modules, so the host
+ *  benchmark times the same code with the same inputs as 'bench' does
+ *  on the board.
+ *
+ *  Timings are taken with interrupts still running, so a run that gets
+ *  preempted reads long. The median ignores those, the p99 and max show
+ *  how bad the preempted runs were.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "dds.h"
+#include "cmd.h"
+#include "goertzel.h"
+#include "fft.h"
+#include "bench.h"
+
+#define BENCH_PAIRS 256         // one capture block of sample pairs, FFT_MIN_POINTS
+#define BENCH_TONE_HZ 1000.0f
+#define BENCH_TONE_RATE 32000   // 8 cycles per block
+
+static USER_DATA benchLine;
+static uint16_t benchPairs[2 * BENCH_PAIRS]; // the tone on both inputs, 12-bit codes
+static uint16_t benchSpectrum[2 * BENCH_PAIRS]; // transformed in place
+static GOERTZEL benchGoertzelStart, benchGoertzel;
+static volatile uint32_t benchSink; // keeps results live so the calls are not dropped
+
+void benchNone(void) {}
+static void benchSine(void) { calculateWave(SINE, DAC_A, 2.5, 0, 50); }
+static void benchSquare(void) { calculateWave(SQUARE, DAC_A, 2.5, 0, 50); }
+static void benchSawtooth(void) { calculateWave(SAW, DAC_A, 2.5, 0, 50); }
+static void benchTriangle(void) { calculateWave(TRI, DAC_A, 2.5, 0, 50); }
+
+static void benchOutput2RValue(void)
+{
+    uint16_t i;
+
+    for(i = 0; i < BENCH_CALLS; i++)
+        benchSink += output2RValue(DAC_A, -4.0 + i * 0.125);
+}
+
+static void benchFloat2uint(void)
+{
+    uint16_t i;
+
+    for(i = 0; i < BENCH_CALLS; i++)
+        benchSink += float2uint(26.7 + i * 53.25); // 1 kHz and up as LUT steps
+}
+
+// copy included, parseFields() writes terminators into the buffer
+static void benchParse(void)
+{
+    strcpy(benchLine.buffer, BENCH_LINE);
+    parseFields(&benchLine);
+}
+
+static void benchField(void)
+{
+    benchSink += getFieldFloat(&benchLine, 2) + getFieldFloat(&benchLine, 3) + getFieldFloat(&benchLine, 4);
+}
+
+// The caller enables both outputs, ddsTick() plays them from wherever the indexes were left
+static void benchTick(void)
+{
+    uint16_t i, codeA, codeB;
+
+    for(i = 0; i < BENCH_CALLS; i++)
+        benchSink += ddsTick(&codeA, &codeB);
+}
+
+// One bin over a block, from fresh states: startGoertzel() would time cosf() as well
+static void benchGoertzelBlock(void)
+{
+    benchGoertzel = benchGoertzelStart;
+    updateGoertzel(&benchGoertzel, benchPairs, BENCH_PAIRS);
+}
+
+// A windowed spectrum of the block as 'spectrum' takes it, the copy included
+static void benchFft(void)
+{
+    memcpy(benchSpectrum, benchPairs, sizeof(benchSpectrum));
+    prepareFft(benchSpectrum, BENCH_PAIRS, true, 0);
+    fftQ15((int16_t*)benchSpectrum, BENCH_PAIRS);
+}
+
+const BENCH_CASE benchCases[] =
+{
+    { "sine", benchSine, 1 },
+    { "square", benchSquare, 1 },
+    { "sawtooth", benchSawtooth, 1 },
+    { "triangle", benchTriangle, 1 },
+    { "output2r", benchOutput2RValue, BENCH_CALLS },
+    { "float2uint", benchFloat2uint, BENCH_CALLS },
+    { "parse", benchParse, 1 },
+    { "field", benchField, 3 },
+    { "tick", benchTick, BENCH_CALLS },
+    { "goertzel", benchGoertzelBlock, BENCH_PAIRS },
+    { "fft", benchFft, 1 },
+};
+const uint8_t benchCaseCount = sizeof(benchCases) / sizeof(benchCases[0]);
+
+// Leaves the parsed BENCH_LINE that 'field' reads and the block 'goertzel' and 'fft' analyze
+void setupBench(void)
+{
+    float freq = BENCH_TONE_HZ;
+    uint16_t i;
+
+    strcpy(benchLine.buffer, BENCH_LINE);
+    parseFields(&benchLine);
+
+    for(i = 0; i < BENCH_PAIRS; i++)
+    {
+        benchPairs[2 * i] = 2048 + (int16_t)(1500.0f * sinf(2.0f * M_PI * BENCH_TONE_HZ * i / BENCH_TONE_RATE));
+        benchPairs[2 * i + 1] = 2048 + (int16_t)(750.0f * cosf(2.0f * M_PI * BENCH_TONE_HZ * i / BENCH_TONE_RATE));
+    }
+    startGoertzel(&benchGoertzelStart, &freq, 1, BENCH_TONE_RATE, GOERTZEL_MAX_SAMPLES, 0);
+}
+
+// Sorts samples in place, count is at most BENCH_MAX_SAMPLES
+void summarizeBench(uint32_t* samples, uint16_t count, BENCH_STATS* stats)
+{
+    uint16_t i, j;
+    uint32_t x;
+
+    stats->samples = count;
+    if(count == 0)
+    {
+        stats->min = stats->median = stats->p99 = stats->max = 0;
+        return;
+    }
+
+    for(i = 1; i < count; i++)
+    {
+        x = samples[i];
+        for(j = i; j > 0 && samples[j - 1] > x; j--)
+            samples[j] = samples[j - 1];
+        samples[j] = x;
+    }
+
+    stats->min = samples[0];
+    stats->median = (count & 1) ? samples[count / 2]
+                                : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    // nearest rank, ceil(0.99 * count)
+    stats->p99 = samples[(count * 99 + 99) / 100 - 1];
+    stats->max = samples[count - 1];
+}
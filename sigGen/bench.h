@@ -0,0 +1,43 @@
+/*
+ * bench.h
+ *
+ *  Hot path cases and summary statistics for repeated timings of them,
+ *  shared by the firmware's 'bench' command and the host benchmark
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+
+#define BENCH_MAX_SAMPLES 128
+#define BENCH_WARMUP 2      // runs timed and thrown away before the samples
+#define BENCH_CALLS 64      // calls per run for the cases too short to time alone
+#define BENCH_LINE "sine 1 1.5k 2.5 -250m"
+
+typedef void (*_benchRun)(void);
+
+typedef struct _BENCH_CASE
+{
+    char* name;
+    _benchRun run;
+    uint16_t calls;         // calls per run, times are reported per call
+} BENCH_CASE;
+
+typedef struct _BENCH_STATS
+{
+    uint16_t samples;
+    uint32_t min;           // cycles per run
+    uint32_t median;
+    uint32_t p99;
+    uint32_t max;
+} BENCH_STATS;
+
+extern const BENCH_CASE benchCases[];
+extern const uint8_t benchCaseCount;
+
+void benchNone(void);
+void setupBench(void);
+void summarizeBench(uint32_t* samples, uint16_t count, BENCH_STATS* stats);
+
+#endif /* BENCH_H_ */
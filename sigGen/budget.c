@@ -0,0 +1,38 @@
+/*
+ * budget.c
+ *
+ *  The tick is dominated by the blocking SPI writes, each output waits a
+ *  whole 16 bit frame plus the inter-frame gap before it is latched. The
+ *  rest is a fixed cost for entry, exit and bookkeeping, and a few clocks
+ *  for every output that is played or trimmed.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "budget.h"
+
+void predictTick(const TICK_CONFIG* config, TICK_BUDGET* budget)
+{
+    uint8_t n = config->channels;
+
+    budget->entryExit = BUDGET_ENTRY_EXIT;
+    budget->fixed = BUDGET_FIXED;
+    budget->dds = n * BUDGET_CHANNEL;
+    budget->spi = n * ((BUDGET_SPI_BITS + BUDGET_SPI_GAP) * config->spiClocks + BUDGET_SPI_OVERHEAD);
+    budget->latch = n * BUDGET_LATCH;
+    budget->level = config->level ? n * BUDGET_LEVEL : 0;
+    budget->lock = config->lock ? BUDGET_LOCK : 0;
+
+    budget->body = budget->fixed + budget->dds + budget->spi + budget->latch + budget->level + budget->lock;
+    budget->total = budget->entryExit + budget->body;
+
+    // period * (100 - margin) / 100 >= total
+    budget->minPeriod = (budget->total * 100 + (100 - BUDGET_MARGIN_PERCENT) - 1) / (100 - BUDGET_MARGIN_PERCENT);
+    budget->maxRate = config->fcyc / budget->minPeriod;
+}
+
+// Percent of the period left after the tick, negative when it overruns
+int32_t getTickHeadroom(const TICK_BUDGET* budget, uint32_t period)
+{
+    return ((int32_t)period - (int32_t)budget->total) * 100 / (int32_t)period;
+}
@@ -0,0 +1,54 @@
+/*
+ * budget.h
+ *
+ *  Cycle budget of one DDS tick, from the SPI clock and what the tick has to do
+ */
+
+#ifndef BUDGET_H_
+#define BUDGET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Core clocks, Cortex-M4 from flash at 40 MHz, checked against DWT timings.
+// Above 40 MHz flash wait states add to them, the measured body in 'headroom' shows by how much
+#define BUDGET_ENTRY_EXIT 30    // stacking, unstacking, tail of the ISR and the ICR write
+#define BUDGET_FIXED 40         // tickCount, staging check, ddsTick() wrap tests
+#define BUDGET_CHANNEL 14       // ddsTick() fetch and index step per playing output
+#define BUDGET_SPI_OVERHEAD 12  // SSI1_DR_R write and the BSY poll loop per frame
+#define BUDGET_SPI_GAP 2        // SPI bit times between frames (FSS high)
+#define BUDGET_LATCH 28         // latchDAC() call, two bit-band writes, 100 ns pulse
+#define BUDGET_LEVEL 12         // trimLevel() per playing output
+#define BUDGET_LOCK 10          // phase locked capture start, once per 'bode' point
+
+#define BUDGET_SPI_BITS 16      // MCP4822 frame
+#define BUDGET_MARGIN_PERCENT 25 // of the tick period kept for the capture and level ISRs and the shell
+
+typedef struct _TICK_CONFIG
+{
+    uint32_t fcyc;          // core clock
+    uint16_t spiClocks;     // core clocks per SPI bit, CPSDVSR * (1 + SCR)
+    uint8_t channels;       // outputs written each tick, differential and Hilbert play both
+    bool level;             // closed-loop trims applied
+    bool lock;              // a phase locked capture start pending
+} TICK_CONFIG;
+
+typedef struct _TICK_BUDGET
+{
+    uint32_t entryExit;     // core clocks spent in each part of the tick
+    uint32_t fixed;
+    uint32_t dds;
+    uint32_t spi;
+    uint32_t latch;
+    uint32_t level;
+    uint32_t lock;
+    uint32_t body;          // everything between ISR entry and exit
+    uint32_t total;         // body plus entry and exit
+    uint32_t minPeriod;     // shortest Timer4 period keeping the margin
+    uint32_t maxRate;       // Hz
+} TICK_BUDGET;
+
+void predictTick(const TICK_CONFIG* config, TICK_BUDGET* budget);
+int32_t getTickHeadroom(const TICK_BUDGET* budget, uint32_t period);
+
+#endif /* BUDGET_H_ */
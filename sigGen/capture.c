@@ -0,0 +1,291 @@
+/*
+ * capture.c
+ *
+ *  Timer 1 triggers ADC0 SS1, which samples IN1 (AIN9) then IN2 (AIN8).
+ *  uDMA moves each pair into one of two blocks in ping-pong mode, so the
+ *  CPU only runs captureIsr() once per CAPTURE_PAIRS pairs to re-arm the
+ *  finished half and publish it.
+ *
+ *  With decimation set, getCaptureBlock() runs the raw blocks through a CIC
+ *  (see decimate.c) in the caller's context and hands out blocks of 16-bit
+ *  samples at the raw rate / R. The ISR stays short so the DDS tick is not
+ *  delayed.
+ *
+ *  captureIsr() must be placed on the ADC0 Sequence 1 vector in the startup file.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "capture.h"
+#include "adc0.h"
+#include "udma.h"
+#include "timer.h"
+#include "nvic.h"
+#include "decimate.h"
+#include "cycles.h"
+#include "clock.h"
+
+#define AIN_IN1 9
+#define AIN_IN2 8
+
+#define CAPTURE_CONTROL (UDMA_CHCTL_DSTINC_16 | UDMA_CHCTL_DSTSIZE_16 | UDMA_CHCTL_SRCINC_NONE | \
+                         UDMA_CHCTL_SRCSIZE_16 | UDMA_CHCTL_ARBSIZE_2 | \
+                         ((CAPTURE_SAMPLES - 1) << UDMA_CHCTL_XFERSIZE_S) | UDMA_CHCTL_XFERMODE_PINGPONG)
+
+uint16_t captureBuffer[2][CAPTURE_SAMPLES];
+volatile int8_t readyBlock = -1;   // newest finished block not yet read, -1 if none
+volatile uint32_t blockCount = 0;
+volatile uint32_t overruns = 0;    // blocks finished before the previous one was read
+uint32_t captureRate = 0;
+uint32_t captureRawRate = 0;
+bool capturing = false;
+_blockHandler blockHandler = 0;
+volatile uint32_t* cycleCounter = 0; // captureIsr() clocks are added here when set
+
+// Decimated output, log2 ratio 0 when off
+uint8_t decimationLog2 = 0;
+DECIMATOR decimator;
+uint16_t decimatedBuffer[2][CAPTURE_SAMPLES];
+uint16_t decimatedFill = 0;
+uint8_t decimatedBlock = 0;
+
+static void armBlock(bool alternate)
+{
+    setUdmaEntry(UDMA_CH_ADC0SS1, alternate, &ADC0_SSFIFO1_R,
+                 &captureBuffer[alternate ? 1 : 0][CAPTURE_SAMPLES - 1], CAPTURE_CONTROL);
+}
+
+void initCapture(void)
+{
+    initUdma();
+    initTimer1();
+    initAdc0Ss1Capture(AIN_IN1, AIN_IN2);
+    setNvicInterruptPriority(INT_ADC0SS1, CAPTURE_PRIORITY);
+    enableNvicInterrupt(INT_ADC0SS1);
+}
+
+static void armCapture(void)
+{
+    stopCapture();
+    blockHandler = 0;
+    readyBlock = -1;
+    blockCount = 0;
+    overruns = 0;
+
+    // drop whole raw blocks while the filter fills, so output blocks stay aligned
+    initDecimator(&decimator, decimationLog2);
+    decimator.settle = ((DECIMATE_SETTLE << decimationLog2) + CAPTURE_PAIRS - 1) / CAPTURE_PAIRS
+                       * (CAPTURE_PAIRS >> decimationLog2);
+    decimatedFill = 0;
+
+    armBlock(false);
+    armBlock(true);
+    enableUdmaChannel(UDMA_CH_ADC0SS1);
+    enableAdc0Ss1();
+}
+
+// Starts continuous capture at rate pairs per second, drops any block handler
+bool startCapture(uint32_t rate)
+{
+    if(rate == 0 || rate > getCaptureMaxRate())
+        return false;
+
+    armCapture();
+    captureRawRate = setTimer1Rate(rate << decimationLog2, SYSTEM_CLOCK_HZ);
+    captureRate = captureRawRate >> decimationLog2;
+    TIMER1_CTL_R |= TIMER_CTL_TAEN;
+    capturing = true;
+    return true;
+}
+
+// Same as startCapture() with a raw sample every period system clocks, but
+// Timer 1 is left stopped so the caller can start it in step with another
+// timer (e.g. from the DDS tick, for phase locked samples)
+bool armLockedCapture(uint32_t period)
+{
+    // raw samples, so the decimated limit is scaled back up
+    if(period == 0 || SYSTEM_CLOCK_HZ / period > (getCaptureMaxRate() << decimationLog2))
+        return false;
+
+    armCapture();
+    TIMER1_TAILR_R = period - 1;
+    captureRawRate = SYSTEM_CLOCK_HZ / period;
+    captureRate = captureRawRate >> decimationLog2;
+    capturing = true;
+    return true;
+}
+
+void stopCapture(void)
+{
+    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;
+    disableUdmaChannel(UDMA_CH_ADC0SS1);
+    disableAdc0Ss1();
+    capturing = false;
+}
+
+bool isCapturing(void)
+{
+    return capturing;
+}
+
+// Hardware averaging and decimation divide the conversion rate
+uint32_t getCaptureMaxRate(void)
+{
+    return ((uint32_t)CAPTURE_MAX_RATE >> (ADC0_SAC_R & ADC_SAC_AVG_M)) >> decimationLog2;
+}
+
+// Ratio 1 (off) or a power of two from 4 to 256, stops any running capture
+bool setCaptureDecimation(uint16_t ratio)
+{
+    uint8_t log2Ratio = 0;
+
+    while((1 << log2Ratio) < ratio)
+        log2Ratio++;
+    if((1 << log2Ratio) != ratio || (log2Ratio != 0 &&
+       (log2Ratio < DECIMATE_MIN_LOG2 || log2Ratio > DECIMATE_MAX_LOG2)))
+        return false;
+
+    stopCapture();
+    decimationLog2 = log2Ratio;
+    return true;
+}
+
+uint16_t getCaptureDecimation(void)
+{
+    return 1 << decimationLog2;
+}
+
+// Fraction bits below the 12-bit code carried by block samples
+uint8_t getCaptureShift(void)
+{
+    return decimationLog2 == 0 ? 0 : DECIMATE_FRACTION_BITS;
+}
+
+uint32_t getCaptureRate(void)
+{
+    return captureRate;
+}
+
+// Rate of the raw blocks seen by the block handler
+uint32_t getCaptureRawRate(void)
+{
+    return captureRawRate;
+}
+
+static uint16_t* getRawBlock(void)
+{
+    int8_t block = readyBlock;
+
+    if(block < 0)
+        return 0;
+    readyBlock = -1;
+    return captureBuffer[block];
+}
+
+// Returns the newest finished block and marks it read, or 0 if nothing new
+// The block stays valid for one block time, until the next one is finished
+// Decimated blocks must be polled at least once per raw block to stay gap free
+uint16_t* getCaptureBlock(void)
+{
+    uint16_t* raw = getRawBlock();
+    uint16_t* block;
+
+    if(raw == 0 || decimationLog2 == 0)
+        return raw;
+
+    // CAPTURE_PAIRS is a multiple of the ratio, so blocks fill exactly
+    block = decimatedBuffer[decimatedBlock];
+    decimatedFill += decimateBlock(&decimator, raw, CAPTURE_PAIRS, &block[2 * decimatedFill]);
+    if(decimatedFill < CAPTURE_PAIRS)
+        return 0;
+
+    decimatedFill = 0;
+    decimatedBlock ^= 1;
+    return block;
+}
+
+// Blocks until the next block, 0 if capture is off or no block arrives in time
+// (e.g. captureIsr() missing from the vector table, or uDMA stalled)
+uint16_t* waitCaptureBlock(void)
+{
+    uint64_t timeout, waited = 0;
+    uint32_t last = CYCLE_COUNT, now;
+    uint16_t* block;
+
+    if(!capturing || captureRate == 0)
+        return 0;
+
+    // two blocks plus the decimator settling, counted in 64 bits since a slow
+    // locked capture can take longer than CYCLE_COUNT takes to wrap
+    timeout = (uint64_t)(2 * CAPTURE_PAIRS + decimator.settle) * SYSTEM_CLOCK_HZ / captureRate
+              + (uint64_t)CAPTURE_TIMEOUT_MS * (SYSTEM_CLOCK_HZ / 1000);
+    while((block = getCaptureBlock()) == 0)
+    {
+        now = CYCLE_COUNT;
+        waited += now - last;
+        last = now;
+        if(waited > timeout)
+            return 0;
+    }
+    return block;
+}
+
+uint32_t getCaptureBlockCount(void)
+{
+    return blockCount;
+}
+
+uint32_t getCaptureOverruns(void)
+{
+    return overruns;
+}
+
+// Runs handler on every raw block in interrupt context, 0 to remove
+// It must finish within one block time
+void setCaptureBlockHandler(_blockHandler handler)
+{
+    blockHandler = handler;
+}
+
+_blockHandler getCaptureBlockHandler(void)
+{
+    return blockHandler;
+}
+
+// Adds the clocks of every captureIsr() to *counter, 0 to stop
+void setCaptureCycleCounter(volatile uint32_t* counter)
+{
+    cycleCounter = counter;
+}
+
+// uDMA done lands on the ADC0 SS1 vector, re-arm whichever half has stopped
+void captureIsr(void)
+{
+    uint32_t start = CYCLE_COUNT;
+
+    ADC0_ISC_R = ADC_ISC_IN1;
+
+    if(getUdmaMode(UDMA_CH_ADC0SS1, false) == UDMA_CHCTL_XFERMODE_STOP)
+    {
+        armBlock(false);
+        if(readyBlock >= 0)
+            overruns++;
+        readyBlock = 0;
+        blockCount++;
+        if(blockHandler)
+            blockHandler(captureBuffer[0]);
+    }
+    if(getUdmaMode(UDMA_CH_ADC0SS1, true) == UDMA_CHCTL_XFERMODE_STOP)
+    {
+        armBlock(true);
+        if(readyBlock >= 0)
+            overruns++;
+        readyBlock = 1;
+        blockCount++;
+        if(blockHandler)
+            blockHandler(captureBuffer[1]);
+    }
+    if(cycleCounter)
+        *cycleCounter += CYCLE_COUNT - start;
+}
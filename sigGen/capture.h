@@ -0,0 +1,53 @@
+/*
+ * capture.h
+ *
+ *  Timer triggered ADC0 capture of both inputs into uDMA ping-pong blocks
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Each block holds CAPTURE_PAIRS interleaved pairs: [IN1, IN2, IN1, IN2, ...]
+// 12-bit codes, or code << getCaptureShift() when decimating
+#define CAPTURE_PAIRS 256
+#define CAPTURE_SAMPLES (CAPTURE_PAIRS * 2)
+
+// ADC0 converts at 1 Msps, shared by the two inputs of a pair and
+// divided by the hardware average count
+#define CAPTURE_MAX_RATE 500000
+
+// Below the DDS tick, so a block handler cannot delay DAC updates
+#define CAPTURE_PRIORITY 1
+
+// waitCaptureBlock() gives up this long after two blocks should have arrived
+#define CAPTURE_TIMEOUT_MS 100
+
+// Called from captureIsr() with every raw block
+typedef void (*_blockHandler)(uint16_t* block);
+
+void initCapture(void);
+bool startCapture(uint32_t rate);
+bool armLockedCapture(uint32_t period);
+void stopCapture(void);
+bool isCapturing(void);
+uint32_t getCaptureRate(void);
+uint32_t getCaptureRawRate(void);
+uint32_t getCaptureMaxRate(void);
+bool setCaptureDecimation(uint16_t ratio);
+uint16_t getCaptureDecimation(void);
+uint8_t getCaptureShift(void);
+
+uint16_t* getCaptureBlock(void);
+uint16_t* waitCaptureBlock(void);
+uint32_t getCaptureBlockCount(void);
+uint32_t getCaptureOverruns(void);
+void setCaptureBlockHandler(_blockHandler handler);
+_blockHandler getCaptureBlockHandler(void);
+void setCaptureCycleCounter(volatile uint32_t* counter);
+
+void captureIsr(void);
+
+#endif /* CAPTURE_H_ */
@@ -28,9 +28,15 @@
 // Subroutines
 //-----------------------------------------------------------------------------
 
-// Initialize system clock to 40 MHz using PLL and 16 MHz crystal oscillator
-void initSystemClockTo40Mhz(void)
+// Initialize system clock to SYSTEM_CLOCK_MHZ using PLL and 16 MHz crystal oscillator
+void initSystemClock(void)
 {
-    // Configure HW to work with 16 MHz XTAL, PLL enabled, sysdivider of 5, creating system clock of 40 MHz
+    // 16 MHz XTAL on the main oscillator, PLL enabled (40 MHz until RCC2 takes over)
     SYSCTL_RCC_R = SYSCTL_RCC_XTAL_16MHZ | SYSCTL_RCC_OSCSRC_MAIN | SYSCTL_RCC_USESYSDIV | (4 << SYSCTL_RCC_SYSDIV_S);
+
+    // RCC2 takes over with the 400 MHz PLL output, bypassed until the PLL locks at the new divider
+    SYSCTL_RCC2_R = SYSCTL_RCC2_USERCC2 | SYSCTL_RCC2_BYPASS2 | SYSCTL_RCC2_OSCSRC2_MO;
+    SYSCTL_RCC2_R |= SYSCTL_RCC2_DIV400 | ((400 / SYSTEM_CLOCK_MHZ - 1) << SYSCLK_DIV400_S);
+    while (!(SYSCTL_RIS_R & SYSCTL_RIS_PLLLRIS));
+    SYSCTL_RCC2_R &= ~SYSCTL_RCC2_BYPASS2;
 }
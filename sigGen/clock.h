@@ -19,10 +19,24 @@
 #ifndef CLOCK_H_
 #define CLOCK_H_
 
+// System clock, set for the whole build (e.g. -DSYSTEM_CLOCK_MHZ=80), every
+// baud rate, timer load and wait loop is derived from it
+#ifndef SYSTEM_CLOCK_MHZ
+#define SYSTEM_CLOCK_MHZ 40
+#endif
+#define SYSTEM_CLOCK_HZ (SYSTEM_CLOCK_MHZ * 1000000UL)
+
+#if SYSTEM_CLOCK_MHZ > 80 || 400 % SYSTEM_CLOCK_MHZ != 0
+#error "SYSTEM_CLOCK_MHZ must divide the 400 MHz PLL and be at most 80"
+#endif
+
+// SYSDIV2 with its LSB, the 400 MHz PLL is divided by this field + 1
+#define SYSCLK_DIV400_S 22
+
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
-void initSystemClockTo40Mhz(void);
+void initSystemClock(void);
 
 #endif
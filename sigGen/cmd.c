@@ -6,6 +6,7 @@
  */
 
 
+#include <float.h>
 #include "cmd.h"
 #include "uart0.h"
 
@@ -20,7 +21,7 @@ void getsUart0(USER_DATA* data)
         c = getcUart0();
 
         // If char c is a backspace (8 or 127), allows overriding of buffer
-        if( c == 8 || c == 127 && count > 0)
+        if( (c == 8 || c == 127) && count > 0)
             count--;
         // If the char c is readable (space, num, alpha), read to buffer
         else if( c >= 32 )
@@ -51,6 +52,13 @@ void parseFields(USER_DATA* data)
 
         if(isPrevDelim)
         {
+            // extra fields are ignored rather than overrunning the field arrays
+            if( data->fieldCount == MAX_FIELDS && c != ' ' && c != ',' )
+            {
+                data->buffer[i] = '\0';
+                return;
+            }
+
             // if char c is alpha a-z LOWERCASE
             if( c >= 'a' && c <= 'z' )
             {
@@ -79,7 +87,7 @@ void parseFields(USER_DATA* data)
             }
 
             // if c is float
-            if( c == '.' || c == '-' )
+            if( c == '.' || c == '-' || c == '+' )
             {
                 data->fieldType[data->fieldCount] = 'f';
                 data->fieldPosition[data->fieldCount] = i;
@@ -114,41 +122,250 @@ char* getFieldString(USER_DATA* data, uint8_t fieldNumber)
         return '\0';
 }
 
-int32_t getFieldInteger(USER_DATA* data, uint8_t fieldNumber)
+// Powers of ten for scaling scanned numbers, 10^0 .. 10^9
+static const uint32_t pow10Table[10] =
 {
-    char* strValue;
-    int32_t returnVal = 0;
-    uint8_t i;
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+// Single pass scan of [+-]digits[.digits][e[+-]digits][p|n|u|m|k|M]
+// Keeps up to 9 significant digits in the mantissa, extra zeros only move the exponent
+// and any other extra digit is rejected as NUM_TOO_MANY_DIGITS rather than dropped
+NUM_ERROR scanNumber(const char* str, NUMBER* num)
+{
+    uint32_t mantissa = 0;
+    int16_t exponent = 0;
+    int16_t expValue = 0;
+    bool negative = false;
+    bool expNegative = false;
+    bool digits = false;
+    bool point = false;
+    uint8_t i = 0;
+    char c;
+    float value;
+
+    num->mantissa = 0;
+    num->exponent = 0;
+    num->value = 0;
+
+    if( str == 0 || str[0] == '\0' )
+        return NUM_EMPTY;
 
-    if(fieldNumber <= data->fieldCount && data->fieldType[fieldNumber] == 'n')
+    c = str[i];
+    if( c == '-' || c == '+' )
     {
-        strValue = &data->buffer[ data->fieldPosition[fieldNumber] ];
+        negative = (c == '-');
+        c = str[++i];
+    }
 
-        for(i = 0; strValue[i] != '\0'; ++i)
+    // mantissa digits and decimal point
+    while( 1 )
+    {
+        if( c >= '0' && c <= '9' )
         {
-            returnVal = returnVal * 10 + (strValue[i] - '0');
+            digits = true;
+            if( mantissa < 100000000 )
+            {
+                mantissa = mantissa * 10 + (c - '0');
+                if( point )
+                    exponent--;
+            }
+            else if( c != '0' )
+                return NUM_TOO_MANY_DIGITS;
+            else if( !point )
+                exponent++;
         }
+        else if( c == '.' && !point )
+            point = true;
+        else
+            break;
+        c = str[++i];
+    }
 
-        return returnVal;
+    if( !digits )
+        return NUM_NO_DIGITS;
+
+    // optional exponent
+    if( c == 'e' || c == 'E' )
+    {
+        c = str[++i];
+        if( c == '-' || c == '+' )
+        {
+            expNegative = (c == '-');
+            c = str[++i];
+        }
+        if( c < '0' || c > '9' )
+            return NUM_BAD_EXPONENT;
+        while( c >= '0' && c <= '9' )
+        {
+            if( expValue < 100 )
+                expValue = expValue * 10 + (c - '0');
+            c = str[++i];
+        }
+        exponent += expNegative ? -expValue : expValue;
+    }
+
+    // optional engineering suffix
+    switch( c )
+    {
+    case 'p': exponent -= 12; c = str[++i]; break;
+    case 'n': exponent -= 9;  c = str[++i]; break;
+    case 'u': exponent -= 6;  c = str[++i]; break;
+    case 'm': exponent -= 3;  c = str[++i]; break;
+    case 'k': exponent += 3;  c = str[++i]; break;
+    case 'M': exponent += 6;  c = str[++i]; break;
+    default: break;
+    }
+
+    if( c != '\0' )
+        return NUM_BAD_SUFFIX;
+
+    // float result without pow(), 10^9 steps are exact in single precision
+    value = (float)mantissa;
+    expValue = exponent;
+    while( expValue >= 9 )
+    {
+        value *= 1e9f;
+        expValue -= 9;
+    }
+    while( expValue <= -9 )
+    {
+        value /= 1e9f;
+        expValue += 9;
     }
+    if( expValue > 0 )
+        value *= (float)pow10Table[expValue];
+    else if( expValue < 0 )
+        value /= (float)pow10Table[-expValue];
+
+    // the exponent alone does not say, 9e38 overflows and 1234e-41 is fine;
+    // denormals are refused with the overflows, they have lost digits already
+    if( mantissa != 0 && !(value >= FLT_MIN && value <= FLT_MAX) )
+        return NUM_OUT_OF_RANGE;
+
+    num->mantissa = negative ? -(int32_t)mantissa : (int32_t)mantissa;
+    num->exponent = exponent;
+    num->value = negative ? -value : value;
+    return NUM_OK;
+}
+
+// Converts a scanned number to an integer in units of 10^scale (e.g. SCALE_MILLI for mHz)
+// Digits below the scale are truncated and reported as NUM_INEXACT
+NUM_ERROR scaleNumber(const NUMBER* num, int8_t scale, int32_t* result)
+{
+    int16_t shift = num->exponent - scale;
+    bool negative = num->mantissa < 0;
+    uint64_t magnitude = negative ? -(int64_t)num->mantissa : num->mantissa;
+    NUM_ERROR error = NUM_OK;
+
+    *result = 0;
+
+    if( magnitude == 0 )
+        return NUM_OK;
 
+    while( shift > 0 )
+    {
+        magnitude *= 10;
+        if( magnitude > 0x7FFFFFFF )
+            return NUM_OUT_OF_RANGE;
+        shift--;
+    }
+    while( shift < 0 )
+    {
+        if( magnitude % 10 )
+            error = NUM_INEXACT;
+        magnitude /= 10;
+        shift++;
+    }
+
+    *result = negative ? -(int32_t)magnitude : (int32_t)magnitude;
+    return error;
+}
+
+char* numErrorString(NUM_ERROR error)
+{
+    switch( error )
+    {
+    case NUM_OK:           return "ok";
+    case NUM_EMPTY:        return "missing value";
+    case NUM_NO_DIGITS:    return "no digits";
+    case NUM_BAD_EXPONENT: return "bad exponent";
+    case NUM_BAD_SUFFIX:   return "unknown suffix (use p n u m k M)";
+    case NUM_OUT_OF_RANGE: return "out of range";
+    case NUM_INEXACT:      return "too many decimals";
+    case NUM_NOT_NUMBER:   return "not a number";
+    case NUM_TOO_MANY_DIGITS: return "more than 9 significant digits";
+    default:               return "invalid number";
+    }
+}
+
+static NUM_ERROR getFieldNumber(USER_DATA* data, uint8_t fieldNumber, NUMBER* num)
+{
+    num->mantissa = 0;
+    num->exponent = 0;
+    num->value = 0;
+
+    if( fieldNumber >= data->fieldCount )
+        return NUM_EMPTY;
+    if( data->fieldType[fieldNumber] != 'n' && data->fieldType[fieldNumber] != 'f' )
+        return NUM_NOT_NUMBER;
+
+    return scanNumber(&data->buffer[ data->fieldPosition[fieldNumber] ], num);
+}
+
+// Returns -1 if the field is not an exact integer
+int32_t getFieldInteger(USER_DATA* data, uint8_t fieldNumber)
+{
+    NUMBER num;
+    int32_t returnVal;
+
+    if( getFieldNumber(data, fieldNumber, &num) == NUM_OK && scaleNumber(&num, SCALE_UNIT, &returnVal) == NUM_OK )
+        return returnVal;
     else
         return -1;
 }
 
 float getFieldFloat(USER_DATA *data, uint8_t fieldNumber)
 {
-    char *strValue;
-    float returnVal = 0;
+    NUMBER num;
+
+    getFieldNumber(data, fieldNumber, &num);
+    return num.value;
+}
+
+// Exact fixed-point read of a field, e.g. scale SCALE_MILLI turns "1.5k" into 1500000
+NUM_ERROR getFieldFixed(USER_DATA* data, uint8_t fieldNumber, int8_t scale, int32_t* result)
+{
+    NUMBER num;
+    NUM_ERROR error = getFieldNumber(data, fieldNumber, &num);
 
+    *result = 0;
+    if( error != NUM_OK )
+        return error;
+    return scaleNumber(&num, scale, result);
+}
 
-    if(fieldNumber <= data->fieldCount && (data->fieldType[fieldNumber] == 'f' || data->fieldType[fieldNumber] == 'n') )
-    {
-        strValue = &data->buffer[ data->fieldPosition[fieldNumber] ];
+// Scans every numeric field and reports the first bad one
+bool checkNumericFields(USER_DATA* data)
+{
+    NUMBER num;
+    NUM_ERROR error;
+    uint8_t i;
 
-        sscanf(strValue, "%f", &returnVal);
+    for(i = 1; i < data->fieldCount; i++)
+    {
+        error = getFieldNumber(data, i, &num);
+        if( error != NUM_OK && error != NUM_NOT_NUMBER )
+        {
+            putsUart0("ERROR: '");
+            putsUart0(getFieldString(data, i));
+            putsUart0("' ");
+            putsUart0(numErrorString(error));
+            putsUart0(".\n");
+            return false;
+        }
     }
-    return returnVal;
+    return true;
 }
 
 bool strcomp(char * a, char * b)
@@ -167,7 +384,7 @@ bool strcomp(char * a, char * b)
             c1 = a[i];
             c2 = b[i];
         }
-    } while(c1 != NULL || c2 != NULL);
+    } while(c1 != '\0' || c2 != '\0');
     return true;
 }
 
@@ -193,49 +410,48 @@ bool isCommand(USER_DATA* data, char strCommand[], uint8_t minArguments)
 
 void comm2str(instruction instruct, int index)
 {
-    char output[20];
-    int16_t argument = instruct.argument;
-    if(argument == 0xFFFF)
-        argument = -1;
+    putiUart0(index+1);
     switch(instruct.command)
     {
     case 0:
-        if(instruct.argument == 0xFFFF)
-            sprintf(output, "%d. forward", index+1);
-        else
-            sprintf(output, "%d. forward %d", index+1, instruct.argument );
-        putsUart0(output);
+        putsUart0(". forward");
+        if(instruct.argument != 0xFFFF)
+        {
+            putcUart0(' ');
+            putiUart0(instruct.argument);
+        }
         break;
-        //putsUart0()
     case 1:
-        if(instruct.argument == 0xFFFF)
-            sprintf(output, "%d. reverse", index+1);
-        else
-            sprintf(output, "%d. reverse %d", index+1, instruct.argument);
-        putsUart0(output);
+        putsUart0(". reverse");
+        if(instruct.argument != 0xFFFF)
+        {
+            putcUart0(' ');
+            putiUart0(instruct.argument);
+        }
         break;
     case 2:
-        sprintf(output, "%d. cw %d", index+1, instruct.argument);
-        putsUart0(output);
+        putsUart0(". cw ");
+        putiUart0(instruct.argument);
         break;
     case 3:
-        sprintf(output, "%d. ccw %d", index+1, instruct.argument);
-        putsUart0(output);
+        putsUart0(". ccw ");
+        putiUart0(instruct.argument);
         break;
     case 4:
         if(instruct.argument == 0x1111)
-            sprintf(output, "%d. wait pb", index+1);
+            putsUart0(". wait pb");
         else if(instruct.argument == 0x2222)
-            sprintf(output, "%d. wait distance %d", index+1, instruct.subcommand);
-        putsUart0(output);
+        {
+            putsUart0(". wait distance ");
+            putiUart0(instruct.subcommand);
+        }
         break;
     case 5:
-        sprintf(output, "%d. pause %d", index+1, instruct.argument);
-        putsUart0(output);
+        putsUart0(". pause ");
+        putiUart0(instruct.argument);
         break;
     case 6:
-        sprintf(output, "%d. stop", index+1);
-        putsUart0(output);
+        putsUart0(". stop");
         break;
     }
     putcUart0('\n');
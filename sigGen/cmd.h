@@ -10,7 +10,7 @@
 
 #define MAX_INSTRUCTIONS 10
 #define MAX_CHARS 80
-#define MAX_FIELDS 5
+#define MAX_FIELDS 8
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,6 +25,33 @@ uint8_t fieldPosition[MAX_FIELDS];
 char fieldType[MAX_FIELDS];
 } USER_DATA;
 
+// Result codes from the numeric field scanner
+typedef enum _NUM_ERROR
+{
+    NUM_OK = 0,
+    NUM_EMPTY = 1,          // nothing to scan
+    NUM_NO_DIGITS = 2,      // sign or point without any digits
+    NUM_BAD_EXPONENT = 3,   // 'e' not followed by digits
+    NUM_BAD_SUFFIX = 4,     // unknown engineering suffix or trailing characters
+    NUM_OUT_OF_RANGE = 5,   // does not fit the requested result
+    NUM_INEXACT = 6,        // digits lost when scaling to fixed-point
+    NUM_NOT_NUMBER = 7,     // field is not numeric
+    NUM_TOO_MANY_DIGITS = 8 // more than 9 significant digits, the rest cannot be kept
+} NUM_ERROR;
+
+// Scanned number, value == mantissa * 10^exponent
+typedef struct _NUMBER
+{
+int32_t mantissa;
+int16_t exponent;
+float value;
+} NUMBER;
+
+// Fixed-point scales for getFieldFixed()
+#define SCALE_UNIT 0
+#define SCALE_MILLI -3
+#define SCALE_MICRO -6
+
 typedef struct _instruction
 {
 uint8_t command;
@@ -38,6 +65,12 @@ void parseFields(USER_DATA* data);
 char* getFieldString(USER_DATA* data, uint8_t fieldNumber);
 int32_t getFieldInteger(USER_DATA* data, uint8_t fieldNumber);
 float getFieldFloat(USER_DATA *data, uint8_t fieldNumber);
+NUM_ERROR getFieldFixed(USER_DATA* data, uint8_t fieldNumber, int8_t scale, int32_t* result);
+
+NUM_ERROR scanNumber(const char* str, NUMBER* num);
+NUM_ERROR scaleNumber(const NUMBER* num, int8_t scale, int32_t* result);
+char* numErrorString(NUM_ERROR error);
+bool checkNumericFields(USER_DATA* data);
 
 bool strcomp(char * a, char * b);
 bool isCommand(USER_DATA* data, char strCommand[], uint8_t minArguments);
@@ -0,0 +1,17 @@
+/*
+ * cycles.c
+ *
+ *  Cortex-M4 DWT cycle counter for timing measurements
+ */
+
+#include <stdint.h>
+#include "tm4c123gh6pm.h"
+#include "cycles.h"
+
+// Enables trace and starts the free running DWT cycle counter
+void initCycleCounter(void)
+{
+    NVIC_DBG_INT_R |= NVIC_DEMCR_TRCENA;
+    DWT_CYCCNT_R = 0;
+    DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+}
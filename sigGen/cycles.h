@@ -0,0 +1,23 @@
+/*
+ * cycles.h
+ *
+ *  Cortex-M4 DWT cycle counter for timing measurements
+ */
+
+#ifndef CYCLES_H_
+#define CYCLES_H_
+
+#include <stdint.h>
+
+// Not in tm4c123gh6pm.h, from the ARMv7-M architecture manual
+#define DWT_CTRL_R              (*((volatile uint32_t *)0xE0001000))
+#define DWT_CYCCNT_R            (*((volatile uint32_t *)0xE0001004))
+#define DWT_CTRL_CYCCNTENA      0x00000001
+#define NVIC_DEMCR_TRCENA       0x01000000  // NVIC_DBG_INT_R is DEMCR
+
+// Core clocks since initCycleCounter(), wraps every 2^32 clocks
+#define CYCLE_COUNT DWT_CYCCNT_R
+
+void initCycleCounter(void);
+
+#endif
@@ -0,0 +1,345 @@
+/*
+ * dds.c
+ *
+ *  Direct digital synthesis for both outputs. Each channel steps a 16.16
+ *  index through its LUT_SIZE table by its phase accumulator on every tick.
+ *  Tables hold DAC codes already corrected by the output calibration.
+ *
+ *  Kept free of register access so the hot paths build and run anywhere.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+#include "dds.h"
+#include "uart0.h"
+#include "trace.h"
+
+uint32_t lut_i_A = 0; // current lut index
+uint32_t lut_i_B = 0;
+uint32_t currentCycles_A = 0;
+uint32_t currentCycles_B = 0;
+int32_t maxCycles_A = -1; // defaults to -1 == continuous
+int32_t maxCycles_B = -1;
+uint32_t phaseAccum_A = 0; // delta phase, how much to add to i
+uint32_t phaseAccum_B = 0;
+// Two tables per channel, one playing and one free for staged edits
+uint16_t lutA_0[LUT_SIZE] = {0};
+uint16_t lutA_1[LUT_SIZE] = {0};
+uint16_t lutB_0[LUT_SIZE] = {0};
+uint16_t lutB_1[LUT_SIZE] = {0};
+uint16_t* lutA = lutA_0; // tables read by ddsTick()
+uint16_t* lutB = lutB_0;
+uint16_t* lutA_edit = lutA_0; // tables written by calculateWave()
+uint16_t* lutB_edit = lutB_0;
+bool outA_EN = false;
+bool outB_EN = false;
+
+// Optional Flags
+bool differentialEN = false;
+bool hilbertEN = false;
+volatile bool stagedEN = false; // between 'begin' and 'commit', edits leave the outputs playing
+
+// One per table: lutA_0, lutA_1, lutB_0, lutB_1
+WAVE_PARAMS lutParams[4];
+
+
+#define X5_A -0.000149548
+#define X4_A -0.000278675
+#define X3_A 0.002751298
+#define X2_A 0
+#define X1_A -0.197731281
+#define X0_A 1.002577993
+
+#define X5_B -0.000293044
+#define X4_B -0.000891307
+#define X3_B 0.007338118
+#define X2_B 0x0
+#define X1_B -0.235113482
+#define X0_B 0.879180291
+
+uint16_t output2RValue(DAC select, float voltage)
+{
+	float dacVoltage = 0;
+	uint16_t r_value = 0;
+	
+	// caps the requested voltage based on limits
+	if(voltage > MAX_VPOS)
+		voltage = MAX_VPOS;
+	if(voltage < MAX_VNEG)
+		voltage = MAX_VNEG;
+	
+	switch(select)
+	{
+	case DAC_A:
+		//dacVoltage = pow(voltage, 5) * X5_A + pow(voltage, 4) * X4_A + pow(voltage, 3) * X3_A + pow(voltage, 2) * X2_A + voltage * X1_A + X0_A;
+		dacVoltage = (voltage - OUT_OFFSET_A) / OUT_SLOPE_A;
+		
+		if(dacVoltage >= 0 && dacVoltage <= DAC_OFFSET_A)
+            dacVoltage = DAC_OFFSET_A;
+		
+		r_value = (dacVoltage - DAC_OFFSET_A) / DAC_SLOPE_A;
+		break;
+	case DAC_B:
+		//dacVoltage = pow(voltage, 5) * X5_B + pow(voltage, 4) * X4_B + pow(voltage, 3) * X3_B + pow(voltage, 2) * X2_B + voltage * X1_B + X0_B;
+		dacVoltage = (voltage - OUT_OFFSET_B) / OUT_SLOPE_B;
+		
+		if(dacVoltage >= 0 && dacVoltage <= DAC_OFFSET_B)
+            dacVoltage = DAC_OFFSET_B;
+		r_value = (dacVoltage - DAC_OFFSET_B) / DAC_SLOPE_B;
+		break;
+	default:
+		break;
+	}
+	
+	return r_value;
+}
+
+
+void calculateWave(WAVE type, DAC select, float amp, float ofs, uint8_t dutyCycle)
+{
+	//ofs = 0;
+	//amp = 1;
+	uint16_t i;
+	float y;
+	float squarePercent = (float)dutyCycle / 100;
+	WAVE_PARAMS* params;
+	// gain should be bits/voltage * amp voltage I want
+	
+	// staged edits go to idle tables, so the outputs can keep playing
+	if(!stagedEN)
+	{
+		outA_EN = false;
+		outB_EN = false;
+	}
+	
+	if(select == DAC_B && differentialEN)
+	{
+		putsUart0("ERROR: Differential is on, cannot change DAC_B!\n");
+		return;
+	}
+	if(select == DAC_B && hilbertEN)
+	{
+		putsUart0("ERROR: Hilbert is on, cannot change DAC_B!\n");
+		return;
+	}
+	traceEvent(TRACE_LUT_START, type << 8 | select);
+	
+	switch(type)
+	{
+	case SINE:
+		for(i = 0; i < LUT_SIZE; i++)
+		{
+			y = ( 2 * M_PI )*((float)i/(float)LUT_SIZE);
+			if(select == DAC_A)
+			{
+				lutA_edit[i] = output2RValue(select, ofs + (amp * sin(y)));
+				if(differentialEN)
+					lutB_edit[i] = output2RValue( DAC_B, -1*( ofs + (amp * sin(y)) ) );
+				else if(hilbertEN)
+					lutB_edit[i] = output2RValue( DAC_B, -1*( ofs + (amp * cos(y)) ) );
+			}
+			else if(select == DAC_B)
+				lutB_edit[i] = output2RValue(select, ofs + (amp * sin(y)));
+		}
+		break;
+	case SQUARE:
+		for(i = 0; i < LUT_SIZE; i++)
+		{
+			if(select == DAC_A)
+			{
+				if( i <= (LUT_SIZE * squarePercent) )
+				{
+					lutA_edit[i] = output2RValue(select, ofs + amp);
+					if(differentialEN)
+						lutB_edit[i] = output2RValue(DAC_B, ofs - amp);
+				}
+				else if( i > (LUT_SIZE * squarePercent) )
+				{
+					lutA_edit[i] = output2RValue(select, ofs - amp);
+					if(differentialEN)
+						lutB_edit[i] = output2RValue(DAC_B, ofs + amp);
+				}
+			}
+			else if(select == DAC_B)
+			{
+				if( i <= (LUT_SIZE * squarePercent) )
+					lutB_edit[i] = output2RValue(select, ofs + amp);
+				else if( i > (LUT_SIZE * squarePercent) )
+					lutB_edit[i] = output2RValue(select, ofs - amp);
+			}
+		}
+		break;
+	case SAW:
+	// start at (ofs - amp) end at (ofs + amp)
+		for(i = 0; i < LUT_SIZE; i++)
+		{
+			// y = b + mx | m = 2*amp, x = i/LUT_SIZE-1
+			y = (ofs-amp) + (2.0*amp)*(float)i/((float)LUT_SIZE-1.0);
+			
+			if(select == DAC_A)
+			{
+				lutA_edit[i] = output2RValue(select, y);
+				if(differentialEN)
+					lutB_edit[i] = output2RValue(DAC_B, -1.0 * y);
+			}
+			
+			else if(select == DAC_B)
+				lutB_edit[i] = output2RValue(select, y);
+		}
+		break;
+	case TRI:
+		for(i = 0; i < LUT_SIZE; i++)
+		{
+			if(select == DAC_A)
+			{
+				if( i / (LUT_SIZE/2) == 0)
+				{
+					y = (ofs-amp) + (2.0*amp) * (float)i / (((float)LUT_SIZE-1.0)/2.0);
+					lutA_edit[i] = output2RValue(select, y);
+					if(differentialEN)
+						lutB_edit[i] = output2RValue(DAC_B, -1.0 * y);
+				}
+				else if( i / (LUT_SIZE/2) == 1)
+				{
+					y = (ofs+amp) - (2.0*amp) * (((float)i) - ((float)LUT_SIZE/2)) / (((float)LUT_SIZE-1.0)/2.0);
+					lutA_edit[i] = output2RValue(select, y);
+					if(differentialEN)
+						lutB_edit[i] = output2RValue(DAC_B, -1.0 * y);
+				}
+			}
+			else if(select == DAC_B)
+			{
+				if( i / (LUT_SIZE/2) == 0)
+				{
+					y = (ofs-amp) + (2.0*amp) * (float)i / (((float)LUT_SIZE-1.0)/2.0);
+					lutB_edit[i] = output2RValue(select, y);
+				}
+				else if( i / (LUT_SIZE/2) == 1)
+				{
+					y = (ofs+amp) - (2.0*amp) * (((float)i) - ((float)LUT_SIZE/2)) / (((float)LUT_SIZE-1.0)/2.0);
+					lutB_edit[i] = output2RValue(select, y);
+				}
+			}
+		}
+		break;
+	default:
+		putsUart0("ERROR: Invalid waveform type.\n");
+	}
+	
+	// kept with the table so 'save' stores what is actually playing
+	if(type >= SINE && type <= TRI && (select == DAC_A || select == DAC_B))
+	{
+		params = getWaveParams(select == DAC_A ? lutA_edit : lutB_edit);
+		params->type = type;
+		params->dutyCycle = dutyCycle;
+		params->amp = amp;
+		params->ofs = ofs;
+		if(select == DAC_A && (differentialEN || (hilbertEN && type == SINE)))
+			getWaveParams(lutB_edit)->type = 0;
+	}
+	
+	traceEvent(TRACE_LUT_END, type << 8 | select);
+	
+	/* if(select == DAC_A)
+		outA_EN = true;
+	if(select == DAC_B || differentialEN)
+		outB_EN = true; */
+	
+#ifdef DEBUG
+	char buffer[100];
+	for(i = 0; i < LUT_SIZE; i++)
+	{
+	    sprintf(buffer, "%u\t%u\n", lutA_edit[i], lutB_edit[i] );
+	    putsUart0(buffer);
+	}
+#endif
+	
+}
+
+WAVE_PARAMS* getWaveParams(uint16_t* table)
+{
+	if(table == lutA_0)
+		return &lutParams[0];
+	if(table == lutA_1)
+		return &lutParams[1];
+	if(table == lutB_0)
+		return &lutParams[2];
+	return &lutParams[3];
+}
+
+uint32_t float2uint(float input)
+{
+	uint8_t i;
+	uint32_t returnValue = 0;
+	
+	uint16_t intValue = (uint32_t)input / 1;
+	returnValue = intValue << INTEGER_BITS;
+	input -= intValue;
+	float calcValue;
+	
+	for(i = INTEGER_BITS; i > 0; i--)
+	{
+	    calcValue = input - (float)1/(2 << (INTEGER_BITS-i));
+		if( calcValue > 0 )
+		{
+		    returnValue |= (1 << (i-1));
+		    input = calcValue;
+		}
+
+	}
+	
+	return returnValue;
+}
+
+// Advances both channels one tick, returns DDS_OUT_A / DDS_OUT_B for each
+// channel playing with its code for this tick in codeA / codeB
+// Runs from SRAM (.TI.ramfunc) like the rest of the tick, the tables are in SRAM already
+#pragma CODE_SECTION(ddsTick, ".TI.ramfunc")
+uint8_t ddsTick(uint16_t* codeA, uint16_t* codeB)
+{
+	uint8_t playing = 0;
+	
+	// for looping the wave
+	if((lut_i_A >> INTEGER_BITS) >= LUT_SIZE)
+	{
+		lut_i_A = lut_i_A % (LUT_SIZE << INTEGER_BITS);
+		currentCycles_A++;
+	}
+	
+	if((lut_i_B >> INTEGER_BITS) >= LUT_SIZE)
+	{
+		lut_i_B = lut_i_B % (LUT_SIZE << INTEGER_BITS);
+		currentCycles_B++;
+	}
+	
+	// if cycles hit the set limit, stop
+	// ignore if the maxCycles value set to -1
+	if(outA_EN && maxCycles_A >= 0 && currentCycles_A == (uint32_t)maxCycles_A)
+	{
+		outA_EN = false;
+		traceEvent(TRACE_CYCLES_DONE, DDS_OUT_A);
+	}
+	if(outB_EN && maxCycles_B >= 0 && currentCycles_B == (uint32_t)maxCycles_B)
+	{
+		outB_EN = false;
+		traceEvent(TRACE_CYCLES_DONE, DDS_OUT_B);
+	}
+	
+	if(outA_EN)
+	{
+		*codeA = lutA[lut_i_A >> INTEGER_BITS];
+		lut_i_A += phaseAccum_A;
+		playing |= DDS_OUT_A;
+	}
+	
+	if(outB_EN)
+	{
+		*codeB = lutB[lut_i_B >> INTEGER_BITS];
+		lut_i_B += phaseAccum_B;
+		playing |= DDS_OUT_B;
+	}
+	
+	return playing;
+}
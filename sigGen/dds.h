@@ -0,0 +1,97 @@
+/*
+ * dds.h
+ *
+ *  DDS core: lookup tables, phase accumulators and output calibration.
+ *  No peripheral access, the caller writes the codes from ddsTick() to the DAC.
+ */
+
+#ifndef DDS_H_
+#define DDS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum _DAC
+{
+    DAC_A = 1,
+    DAC_B = 2,
+    DAC_INVALID = 3
+} DAC;
+
+typedef enum _WAVE
+{
+	  SINE = 1,
+	SQUARE = 2,
+	   SAW = 3,
+	   TRI = 4
+} WAVE;
+
+#define DDS_OUT_A 1
+#define DDS_OUT_B 2
+
+// What a table was last rendered from, type 0 when it was never rendered
+// or holds channel B derived from A (differential, hilbert)
+typedef struct _WAVE_PARAMS
+{
+    uint8_t type;
+    uint8_t dutyCycle;
+    float amp;
+    float ofs;
+} WAVE_PARAMS;
+
+// DAC Calibration Values
+#define DAC_SLOPE_A 0.000501
+#define DAC_OFFSET_A 0.002917
+
+#define DAC_SLOPE_B 0.0005
+#define DAC_OFFSET_B 0.000583
+
+#define DAC_MAX_RVALUE 4095
+#define DAC_MIN_RVALUE 0
+
+// OUTPUT Calibration Values
+#define OUT_SLOPE_A -5.32148859
+#define OUT_OFFSET_A 5.335339304
+
+#define OUT_SLOPE_B -5.246581272
+#define OUT_OFFSET_B 5.299569261
+
+#define PRECISION_VALUE 4294967296 // 2^32
+
+#define MAX_VPOS 4.4
+#define MAX_VNEG -4.8
+
+#define LUT_SIZE (uint32_t)2048
+#define INTEGER_BITS 16
+#define FRACTIONAL_BITS 32-INTEGER_BITS
+#define DDS_PHASE_BITS 27 // one LUT cycle in the 16.16 index, LUT_SIZE << INTEGER_BITS
+
+extern uint32_t lut_i_A;
+extern uint32_t lut_i_B;
+extern uint32_t currentCycles_A;
+extern uint32_t currentCycles_B;
+extern int32_t maxCycles_A;
+extern int32_t maxCycles_B;
+extern uint32_t phaseAccum_A;
+extern uint32_t phaseAccum_B;
+extern uint16_t lutA_0[LUT_SIZE];
+extern uint16_t lutA_1[LUT_SIZE];
+extern uint16_t lutB_0[LUT_SIZE];
+extern uint16_t lutB_1[LUT_SIZE];
+extern uint16_t* lutA;
+extern uint16_t* lutB;
+extern uint16_t* lutA_edit;
+extern uint16_t* lutB_edit;
+extern bool outA_EN;
+extern bool outB_EN;
+extern bool differentialEN;
+extern bool hilbertEN;
+extern volatile bool stagedEN;
+
+uint16_t output2RValue(DAC select, float voltage);
+uint32_t float2uint(float input);
+void calculateWave(WAVE type, DAC select, float amp, float ofs, uint8_t dutyCycle);
+WAVE_PARAMS* getWaveParams(uint16_t* table);
+uint8_t ddsTick(uint16_t* codeA, uint16_t* codeB);
+
+#endif /* DDS_H_ */
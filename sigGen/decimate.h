@@ -0,0 +1,32 @@
+/*
+ * decimate.h
+ *
+ *  CIC decimation of interleaved ADC pairs for more effective bits
+ */
+
+#ifndef DECIMATE_H_
+#define DECIMATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DECIMATE_MIN_LOG2 2     // ratio 4
+#define DECIMATE_MAX_LOG2 8     // ratio 256, R^2 * 4095 still fits 32 bits
+#define DECIMATE_FRACTION_BITS 4 // output is 16-bit, 12-bit code << 4
+#define DECIMATE_SETTLE 2       // outputs before the order 2 filter is full
+
+typedef struct _DECIMATOR
+{
+    uint8_t log2Ratio;
+    uint16_t phase;         // input pairs since the last output
+    uint16_t settle;        // outputs left to drop after reset
+    uint32_t integ1[2];     // wrap-around arithmetic, only differences matter
+    uint32_t integ2[2];
+    uint32_t comb1[2];      // delayed values for the two comb stages
+    uint32_t comb2[2];
+} DECIMATOR;
+
+void initDecimator(DECIMATOR* d, uint8_t log2Ratio);
+uint16_t decimateBlock(DECIMATOR* d, uint16_t* in, uint16_t pairs, uint16_t* out);
+
+#endif /* DECIMATE_H_ */
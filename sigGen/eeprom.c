@@ -0,0 +1,33 @@
+/*
+ * eeprom.c
+ *
+ *  Word access to the 2 KiB internal EEPROM, 32 blocks of 16 words
+ */
+
+#include <stdint.h>
+#include "tm4c123gh6pm.h"
+#include "eeprom.h"
+
+void initEeprom(void)
+{
+    SYSCTL_RCGCEEPROM_R = SYSCTL_RCGCEEPROM_R0;
+    _delay_cycles(6);
+    while (EEPROM_EEDONE_R & EEPROM_EEDONE_WORKING);
+}
+
+// Writes one 32-bit word, add is a word address (0-511)
+void writeEeprom(uint16_t add, uint32_t data)
+{
+    EEPROM_EEBLOCK_R = add >> 4;
+    EEPROM_EEOFFSET_R = add & 0xF;
+    EEPROM_EERDWR_R = data;
+    while (EEPROM_EEDONE_R & EEPROM_EEDONE_WORKING);
+}
+
+// Reads one 32-bit word, add is a word address (0-511)
+uint32_t readEeprom(uint16_t add)
+{
+    EEPROM_EEBLOCK_R = add >> 4;
+    EEPROM_EEOFFSET_R = add & 0xF;
+    return EEPROM_EERDWR_R;
+}
@@ -0,0 +1,18 @@
+/*
+ * eeprom.h
+ *
+ *  Word access to the 2 KiB internal EEPROM, 32 blocks of 16 words
+ */
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include <stdint.h>
+
+#define EEPROM_WORDS 512
+
+void initEeprom(void);
+void writeEeprom(uint16_t add, uint32_t data);
+uint32_t readEeprom(uint16_t add);
+
+#endif
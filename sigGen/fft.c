@@ -0,0 +1,233 @@
+/*
+ * fft.c
+ *
+ *  Radix-2 decimation in time FFT on Q15 complex data, in place.
+ *  Each stage halves the data, so the output is X[k] / N and cannot
+ *  overflow.
+ *
+ *  Both inputs are transformed at once: the capture pairs [IN1, IN2]
+ *  are used directly as z = IN1 + j IN2 and the two real spectra are
+ *  separated afterwards in getFftPower():
+ *    IN1[k] = (Z[k] + conj(Z[N-k])) / 2
+ *    IN2[k] = (Z[k] - conj(Z[N-k])) / 2j
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "clock.h"
+#include "fft.h"
+
+#define ADC_MIDSCALE 2048
+#define ADC_TO_Q15_SHIFT 3  // 12-bit centered samples to +/-16384
+#define FULL_SCALE 16384.0f
+
+#define TONE_HALF_WIDTH 4   // bins either side of a tone (Hann main lobe plus leakage)
+#define DC_BINS 3
+#define HANN_POWER_GAIN 0.375f
+
+// sin(2 pi m / FFT_MAX_POINTS) for m in [0, FFT_MAX_POINTS / 2), Q15
+int16_t fftSine[FFT_MAX_POINTS / 2];
+float windowGain = 1.0f;
+
+void initFft(void)
+{
+    uint16_t i;
+
+    for(i = 0; i < FFT_MAX_POINTS / 2; i++)
+        fftSine[i] = (int16_t)(32767.0f * sinf(2.0f * M_PI * i / FFT_MAX_POINTS));
+}
+
+// Time budget for an n point transform, scaled from the 40 MHz figures
+uint32_t getFftBudgetUs(uint16_t n)
+{
+    uint32_t us;
+
+    if(n <= 256)
+        us = FFT_BUDGET_US_256;
+    else if(n <= 512)
+        us = FFT_BUDGET_US_512;
+    else
+        us = FFT_BUDGET_US_1024;
+    return us * 40 / SYSTEM_CLOCK_MHZ;
+}
+
+// cos(2 pi m / FFT_MAX_POINTS) for m in [0, FFT_MAX_POINTS / 2)
+static int16_t fftCosine(uint16_t m)
+{
+    if(m < FFT_MAX_POINTS / 4)
+        return fftSine[m + FFT_MAX_POINTS / 4];
+    else
+        return -fftSine[m - FFT_MAX_POINTS / 4];
+}
+
+// Centers ADC pairs (12-bit codes << shift) on mid-scale, scales them to Q15 and applies a Hann window
+void prepareFft(uint16_t* pairs, uint16_t n, bool window, uint8_t shift)
+{
+    int16_t* data = (int16_t*)pairs;
+    int32_t w;
+    uint16_t i;
+
+    for(i = 0; i < 2 * n; i++)
+        data[i] = (((int32_t)pairs[i] - (ADC_MIDSCALE << shift)) << ADC_TO_Q15_SHIFT) >> shift;
+
+    windowGain = window ? HANN_POWER_GAIN : 1.0f;
+    if(!window)
+        return;
+
+    // Hann: w[i] = sin^2(pi i / n)
+    for(i = 0; i < n; i++)
+    {
+        w = fftSine[(uint32_t)i * FFT_MAX_POINTS / (2 * n)];
+        w = (w * w) >> 15;
+        data[2 * i] = (data[2 * i] * w) >> 15;
+        data[2 * i + 1] = (data[2 * i + 1] * w) >> 15;
+    }
+}
+
+// In place FFT of n complex Q15 values, n a power of two up to FFT_MAX_POINTS
+void fftQ15(int16_t* data, uint16_t n)
+{
+    uint16_t i, j, k, bit, len, half, step;
+    int32_t wr, wi, tr, ti, ur, ui;
+    int16_t temp;
+
+    // bit reversed order
+    for(i = 1, j = 0; i < n; i++)
+    {
+        for(bit = n >> 1; j & bit; bit >>= 1)
+            j ^= bit;
+        j |= bit;
+        if(i < j)
+        {
+            temp = data[2 * i];
+            data[2 * i] = data[2 * j];
+            data[2 * j] = temp;
+            temp = data[2 * i + 1];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j + 1] = temp;
+        }
+    }
+
+    for(len = 2; len <= n; len <<= 1)
+    {
+        half = len >> 1;
+        step = FFT_MAX_POINTS / len;
+        for(k = 0; k < half; k++)
+        {
+            wr = fftCosine(k * step);
+            wi = -fftSine[k * step];
+            for(i = k; i < n; i += len)
+            {
+                j = i + half;
+                // products and halvings round to nearest, truncating both left every
+                // bin about 1 LSB low
+                tr = (wr * data[2 * j] - wi * data[2 * j + 1] + 0x4000) >> 15;
+                ti = (wr * data[2 * j + 1] + wi * data[2 * j] + 0x4000) >> 15;
+                ur = data[2 * i] + 1;
+                ui = data[2 * i + 1] + 1;
+                data[2 * i] = (ur + tr) >> 1;
+                data[2 * i + 1] = (ui + ti) >> 1;
+                data[2 * j] = (ur - tr) >> 1;
+                data[2 * j + 1] = (ui - ti) >> 1;
+            }
+        }
+    }
+}
+
+// Power of bin k (0 to n/2) of input 0 (IN1) or 1 (IN2), a full scale sine gives 0.5 over its bins
+float getFftPower(int16_t* data, uint16_t n, uint8_t input, uint16_t k)
+{
+    uint16_t m = (n - k) & (n - 1);
+    float re, im, power;
+
+    if(input == 0)
+    {
+        re = (float)(data[2 * k] + data[2 * m]) / 2;
+        im = (float)(data[2 * k + 1] - data[2 * m + 1]) / 2;
+    }
+    else
+    {
+        re = (float)(data[2 * k + 1] + data[2 * m + 1]) / 2;
+        im = (float)(data[2 * m] - data[2 * k]) / 2;
+    }
+
+    power = (re * re + im * im) / (FULL_SCALE * FULL_SCALE * windowGain);
+    // one-sided spectrum, fold the negative frequencies in
+    if(k != 0 && k != n / 2)
+        power *= 2;
+    return power;
+}
+
+static float tonePower(int16_t* data, uint16_t n, uint8_t input, uint16_t k)
+{
+    float power = 0;
+    int16_t b;
+
+    for(b = (int16_t)k - TONE_HALF_WIDTH; b <= (int16_t)k + TONE_HALF_WIDTH; b++)
+        if(b >= 0 && b <= n / 2)
+            power += getFftPower(data, n, input, b);
+    return power;
+}
+
+// Finds the fundamental, THD over FFT_HARMONICS harmonics, SINAD and the largest local peaks
+void analyzeSpectrum(int16_t* data, uint16_t n, uint8_t input, uint8_t peaks, SPECTRUM* result)
+{
+    float power, previous, next, total = 0, dc = 0, harmonics = 0;
+    float peakPower[FFT_MAX_PEAKS];
+    uint16_t k, h, bin;
+    uint8_t p, q;
+
+    if(peaks > FFT_MAX_PEAKS)
+        peaks = FFT_MAX_PEAKS;
+    result->peaks = 0;
+    result->fundamental = DC_BINS;
+
+    previous = 0;
+    power = getFftPower(data, n, input, 0);
+    for(k = 0; k <= n / 2; k++)
+    {
+        next = k < n / 2 ? getFftPower(data, n, input, k + 1) : 0;
+
+        total += power;
+        if(k < DC_BINS)
+            dc += power;
+        else
+        {
+            if(power > getFftPower(data, n, input, result->fundamental))
+                result->fundamental = k;
+
+            // insert local maxima into the sorted peak list
+            if(power > previous && power >= next)
+            {
+                for(p = 0; p < result->peaks && peakPower[p] >= power; p++);
+                if(p < peaks)
+                {
+                    for(q = (result->peaks < peaks ? result->peaks : peaks - 1); q > p; q--)
+                    {
+                        peakPower[q] = peakPower[q - 1];
+                        result->peakBin[q] = result->peakBin[q - 1];
+                    }
+                    peakPower[p] = power;
+                    result->peakBin[p] = k;
+                    if(result->peaks < peaks)
+                        result->peaks++;
+                }
+            }
+        }
+        previous = power;
+        power = next;
+    }
+
+    result->fundamentalPower = tonePower(data, n, input, result->fundamental);
+    for(h = 2; h < 2 + FFT_HARMONICS; h++)
+    {
+        bin = h * result->fundamental;
+        if(bin > n / 2 - TONE_HALF_WIDTH)
+            break;
+        harmonics += tonePower(data, n, input, bin);
+    }
+
+    result->thd = harmonics / result->fundamentalPower;
+    result->sinad = result->fundamentalPower / (total - dc - result->fundamentalPower);
+}
@@ -0,0 +1,40 @@
+/*
+ * fft.h
+ *
+ *  Fixed-point FFT spectrum analyzer for captured ADC pairs
+ */
+
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FFT_MIN_POINTS 256
+#define FFT_MAX_POINTS 1024 // limited by SCOPE_PAIRS
+#define FFT_HARMONICS 5     // 2nd to 6th used for THD
+#define FFT_MAX_PEAKS 8
+
+// prepareFft() plus fftQ15() time allowed at 40 MHz, about n log2(n) with headroom
+#define FFT_BUDGET_US_256 1200
+#define FFT_BUDGET_US_512 2700
+#define FFT_BUDGET_US_1024 6000
+
+typedef struct _SPECTRUM
+{
+    uint16_t fundamental;   // bin of the largest non-DC tone
+    float fundamentalPower; // power of the fundamental, full scale sine = 0.5
+    float thd;              // harmonic / fundamental power ratio
+    float sinad;            // fundamental / (noise + distortion) power ratio
+    uint8_t peaks;
+    uint16_t peakBin[FFT_MAX_PEAKS];
+} SPECTRUM;
+
+void initFft(void);
+uint32_t getFftBudgetUs(uint16_t n);
+void prepareFft(uint16_t* pairs, uint16_t n, bool window, uint8_t shift);
+void fftQ15(int16_t* data, uint16_t n);
+float getFftPower(int16_t* data, uint16_t n, uint8_t input, uint16_t k);
+void analyzeSpectrum(int16_t* data, uint16_t n, uint8_t input, uint8_t peaks, SPECTRUM* result);
+
+#endif /* FFT_H_ */
@@ -0,0 +1,123 @@
+/*
+ * goertzel.c
+ *
+ *  Runs s[n] = x[n] + 2cos(w) s[n-1] - s[n-2] for every bin on both inputs
+ *  as capture blocks arrive, so a measurement is just a streaming stage.
+ *  Samples are centered on ADC mid-scale. A tone on the bin grows the states
+ *  by about A/(2sin(w)) per sample, so a low bin at a high capture rate blows
+ *  through 32 bits long before 65535 samples (tone 100 10000 does). The
+ *  states are 64-bit: |s[n]| <= A*n*(n+1)/2, under 2^45 for 65535 samples of
+ *  a 14-bit input (12 bits plus GOERTZEL_MAX_FRACTION), and the Q29 product
+ *  is split in two so it never needs more than 64 bits either.
+ *
+ *  Pick samples as a whole number of cycles of each bin so DC and the
+ *  other bins fall in nulls.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "goertzel.h"
+
+#define ADC_MIDSCALE 2048
+
+// 2cos(w) * s with coef in Q29 and |s| < 2^45, as coef * (s >> 16) plus the
+// low 16 bits, so neither partial product leaves 64 bits
+static inline int64_t coefProduct(int32_t coef, int64_t s)
+{
+    int64_t high = (int64_t)coef * (int32_t)(s >> 16);
+    int64_t low = ((int64_t)coef * (int32_t)(s & 0xFFFF)) >> 16;
+
+    return (high + low) >> (GOERTZEL_COEF_BITS - 16);
+}
+
+// shift is the number of fraction bits below the 12-bit code in each sample
+// The bin frequency is set in double: cosf() near w = 0 is only good to 2^-24, which puts
+// a low bin a few hundredths of a bin off over 65535 samples, and Q29 holds more than that
+void startGoertzel(GOERTZEL* g, float* freqs, uint8_t bins, uint32_t sampleRate, uint32_t samples, uint8_t shift)
+{
+    double w, cosw;
+    uint8_t b;
+
+    if(bins > GOERTZEL_MAX_BINS)
+        bins = GOERTZEL_MAX_BINS;
+
+    g->bins = bins;
+    g->remaining = samples;
+    g->count = 0;
+    g->fraction = shift < GOERTZEL_MAX_FRACTION ? shift : GOERTZEL_MAX_FRACTION;
+    g->shift = shift - g->fraction;
+    for(b = 0; b < bins; b++)
+    {
+        w = 2.0 * M_PI * freqs[b] / sampleRate;
+        cosw = cos(w);
+        g->coef[b] = (int32_t)lround(2.0 * cosw * (1 << GOERTZEL_COEF_BITS));
+        g->cosw[b] = (float)cosw;
+        g->sinw[b] = (float)sin(w);
+        g->s1[0][b] = g->s2[0][b] = 0;
+        g->s1[1][b] = g->s2[1][b] = 0;
+    }
+}
+
+// Feeds a capture block, returns true once all samples have been processed
+bool updateGoertzel(GOERTZEL* g, uint16_t* block, uint16_t pairs)
+{
+    int32_t x0, x1;
+    int64_t s0;
+    int32_t midscale = ADC_MIDSCALE << g->fraction;
+    uint16_t i;
+    uint8_t b;
+
+    if(pairs > g->remaining)
+        pairs = g->remaining;
+
+    for(b = 0; b < g->bins; b++)
+    {
+        int32_t coef = g->coef[b];
+        int64_t a1 = g->s1[0][b], a2 = g->s2[0][b];
+        int64_t b1 = g->s1[1][b], b2 = g->s2[1][b];
+
+        for(i = 0; i < pairs; i++)
+        {
+            x0 = (int32_t)(block[2 * i] >> g->shift) - midscale;
+            x1 = (int32_t)(block[2 * i + 1] >> g->shift) - midscale;
+
+            s0 = x0 + coefProduct(coef, a1) - a2;
+            a2 = a1;
+            a1 = s0;
+
+            s0 = x1 + coefProduct(coef, b1) - b2;
+            b2 = b1;
+            b1 = s0;
+        }
+
+        g->s1[0][b] = a1;
+        g->s2[0][b] = a2;
+        g->s1[1][b] = b1;
+        g->s2[1][b] = b2;
+    }
+
+    g->count += pairs;
+    g->remaining -= pairs;
+    return g->remaining == 0;
+}
+
+// Amplitude in ADC codes (peak) and phase in degrees of input 0 (IN1) or 1 (IN2)
+// Phase is taken at the last sample, so compare inputs against each other
+void getGoertzelResult(GOERTZEL* g, uint8_t input, uint8_t bin, float* amplitude, float* phase)
+{
+    float s1 = (float)g->s1[input][bin];
+    float s2 = (float)g->s2[input][bin];
+    float re = s1 - s2 * g->cosw[bin];
+    float im = s2 * g->sinw[bin];
+
+    if(g->count == 0)
+    {
+        *amplitude = 0;
+        *phase = 0;
+        return;
+    }
+
+    *amplitude = 2.0f * sqrtf(re * re + im * im) / (float)(g->count << g->fraction);
+    *phase = atan2f(im, re) * 180.0f / M_PI;
+}
@@ -0,0 +1,36 @@
+/*
+ * goertzel.h
+ *
+ *  Fixed-point Goertzel single-bin analyzer for both ADC inputs
+ */
+
+#ifndef GOERTZEL_H_
+#define GOERTZEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GOERTZEL_MAX_BINS 4
+#define GOERTZEL_COEF_BITS 29 // 2cos(w) in Q29
+#define GOERTZEL_MAX_FRACTION 2 // fraction bits kept from decimated input
+#define GOERTZEL_MAX_SAMPLES 65535
+
+typedef struct _GOERTZEL
+{
+    uint8_t bins;
+    int32_t coef[GOERTZEL_MAX_BINS];        // 2cos(w), Q29
+    float cosw[GOERTZEL_MAX_BINS];
+    float sinw[GOERTZEL_MAX_BINS];
+    int64_t s1[2][GOERTZEL_MAX_BINS];       // last two filter states per input and bin
+    int64_t s2[2][GOERTZEL_MAX_BINS];
+    uint32_t remaining;                     // sample pairs left
+    uint32_t count;                         // sample pairs processed
+    uint8_t shift;                          // input fraction bits dropped
+    uint8_t fraction;                       // input fraction bits kept
+} GOERTZEL;
+
+void startGoertzel(GOERTZEL* g, float* freqs, uint8_t bins, uint32_t sampleRate, uint32_t samples, uint8_t shift);
+bool updateGoertzel(GOERTZEL* g, uint16_t* block, uint16_t pairs);
+void getGoertzelResult(GOERTZEL* g, uint8_t input, uint8_t bin, float* amplitude, float* phase);
+
+#endif /* GOERTZEL_H_ */
@@ -302,6 +302,8 @@ void clearPinInterrupt(PORT port, uint8_t pin)
     *p = 1;
 }
 
+// Copied to SRAM at boot (.TI.ramfunc), latchDAC() calls it in every DDS tick
+#pragma CODE_SECTION(setPinValue, ".TI.ramfunc")
 void setPinValue(PORT port, uint8_t pin, bool value)
 {
     uint32_t* p;
@@ -0,0 +1,143 @@
+/*
+ * level.c
+ *
+ *  Each control tick pairs the (untrimmed) code the DAC is playing with
+ *  the ADC reading of the same output at the load. A least squares fit of
+ *  load volts against target volts over LEVEL_WINDOW samples gives the
+ *  gain and offset error of the whole path, which a PI loop removes by
+ *  trimming the codes sent to the DAC.
+ *
+ *  With a DC output, or an output the tick rate samples at a fixed phase,
+ *  the target has no swing and only the offset is corrected.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "level.h"
+
+#define LEVEL_MIN_SPREAD 32     // codes rms of target swing needed to fit gain
+#define LEVEL_KP_RATIO 0.5f     // proportional gain relative to the integral gain
+#define LEVEL_MAX_KI 1.0f
+#define Q14 16384.0f
+
+static void applyTrim(LEVEL* level)
+{
+    // output = gain * target + offset moved into code space
+    float codeOffset = ((level->gain - 1) * level->outOffset + level->offset) / level->outSlope;
+
+    level->gainQ14 = level->gain * Q14;
+    level->offsetQ14 = codeOffset * Q14;
+}
+
+void initLevel(LEVEL* level, float outOffset, float outSlope, float inOffset, float inSlope)
+{
+    level->outOffset = outOffset;
+    level->outSlope = outSlope;
+    level->inOffset = inOffset;
+    level->inSlope = inSlope;
+    setLevelBandwidth(level, LEVEL_DEFAULT_BW);
+    resetLevel(level);
+}
+
+// Back to unity gain and no offset
+void resetLevel(LEVEL* level)
+{
+    level->gain = 1;
+    level->offset = 0;
+    level->gainIntegral = 0;
+    level->offsetIntegral = 0;
+    level->gainError = 0;
+    level->offsetError = 0;
+    level->saturated = false;
+    level->gainValid = false;
+    level->updates = 0;
+    level->count = 0;
+    level->sumX = level->sumY = level->sumXX = level->sumXY = 0;
+    applyTrim(level);
+}
+
+// The loop is a pure integrator on a unity plant, one pole at 1 - ki per update
+void setLevelBandwidth(LEVEL* level, float bandwidth)
+{
+    float updateRate = (float)LEVEL_RATE / LEVEL_WINDOW;
+
+    level->bandwidth = bandwidth;
+    level->ki = 2 * M_PI * bandwidth / updateRate;
+    if(level->ki > LEVEL_MAX_KI)
+        level->ki = LEVEL_MAX_KI;
+    level->kp = LEVEL_KP_RATIO * level->ki;
+}
+
+static float clamp(float value, float low, float high, bool* saturated)
+{
+    if(value < low)
+    {
+        *saturated = true;
+        return low;
+    }
+    if(value > high)
+    {
+        *saturated = true;
+        return high;
+    }
+    return value;
+}
+
+// Starts the loop from a known trim, e.g. one saved earlier, instead of unity
+void presetLevel(LEVEL* level, float gain, float offset)
+{
+    resetLevel(level);
+    level->gain = clamp(gain, LEVEL_MIN_GAIN, LEVEL_MAX_GAIN, &level->saturated);
+    level->offset = clamp(offset, -LEVEL_MAX_OFFSET, LEVEL_MAX_OFFSET, &level->saturated);
+    level->gainIntegral = level->gain - 1;
+    level->offsetIntegral = level->offset;
+    applyTrim(level);
+}
+
+// Adds one target/load code pair, returns true when the trim was updated
+bool updateLevel(LEVEL* level, uint16_t target, uint16_t load)
+{
+    float n, spreadX, slope, intercept, scale;
+
+    level->sumX += target;
+    level->sumY += load;
+    level->sumXX += (int32_t)target * target;
+    level->sumXY += (int32_t)target * load;
+    if(++level->count < LEVEL_WINDOW)
+        return false;
+
+    // fit load = slope * target + intercept in codes
+    n = level->count;
+    spreadX = (float)(level->count * level->sumXX - level->sumX * level->sumX);
+    level->gainValid = spreadX >= n * n * LEVEL_MIN_SPREAD * LEVEL_MIN_SPREAD;
+    scale = level->inSlope / level->outSlope;
+    if(level->gainValid)
+        slope = (float)(level->count * level->sumXY - level->sumX * level->sumY) / spreadX;
+    else
+        slope = 1 / scale; // gain unobservable, fit offset only
+    intercept = (level->sumY - slope * level->sumX) / n;
+
+    // the same fit in volts, load = slope * target + intercept
+    slope *= scale;
+    intercept = level->inOffset + level->inSlope * intercept - slope * level->outOffset;
+
+    level->gainError = level->gainValid ? 1 - slope : 0;
+    level->offsetError = -intercept;
+
+    level->saturated = false;
+    level->gainIntegral += level->ki * level->gainError;
+    level->gainIntegral = clamp(level->gainIntegral, LEVEL_MIN_GAIN - 1, LEVEL_MAX_GAIN - 1, &level->saturated);
+    level->offsetIntegral += level->ki * level->offsetError;
+    level->offsetIntegral = clamp(level->offsetIntegral, -LEVEL_MAX_OFFSET, LEVEL_MAX_OFFSET, &level->saturated);
+    level->gain = clamp(1 + level->gainIntegral + level->kp * level->gainError,
+                        LEVEL_MIN_GAIN, LEVEL_MAX_GAIN, &level->saturated);
+    level->offset = clamp(level->offsetIntegral + level->kp * level->offsetError,
+                          -LEVEL_MAX_OFFSET, LEVEL_MAX_OFFSET, &level->saturated);
+    applyTrim(level);
+
+    level->updates++;
+    level->count = 0;
+    level->sumX = level->sumY = level->sumXX = level->sumXY = 0;
+    return true;
+}
@@ -0,0 +1,72 @@
+/*
+ * level.h
+ *
+ *  Closed-loop output level control, trims gain and offset of one output
+ *  so the voltage measured at the load follows the programmed waveform
+ */
+
+#ifndef LEVEL_H_
+#define LEVEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LEVEL_RATE 4000         // Hz, one ADC pair per control tick
+#define LEVEL_WINDOW 256        // samples per PI update
+#define LEVEL_DEFAULT_BW 0.5f   // Hz, closed-loop bandwidth
+#define LEVEL_MIN_GAIN 0.5f
+#define LEVEL_MAX_GAIN 2.0f
+#define LEVEL_MAX_OFFSET 2.0f   // V
+
+typedef struct _LEVEL
+{
+    // code to volts maps, volts = offset + slope * code
+    float outOffset;
+    float outSlope;
+    float inOffset;
+    float inSlope;
+
+    float bandwidth;        // Hz, kp and ki follow from it
+    float kp;
+    float ki;
+    float gain;             // applied trim, output = gain * target + offset
+    float offset;           // V
+    float gainIntegral;
+    float offsetIntegral;
+    float gainError;        // last measured, 1 - load / target
+    float offsetError;      // V
+    bool saturated;         // trim hit a limit on the last update
+    bool gainValid;         // last window had enough swing to measure gain
+    uint32_t updates;
+
+    // trim in DAC codes read by tickIsr, code' = (code * gainQ14 + offsetQ14) >> 14
+    volatile int32_t gainQ14;
+    volatile int32_t offsetQ14;
+
+    // least squares of load code (y) against target code (x) over one window
+    uint16_t count;
+    int64_t sumX;
+    int64_t sumY;
+    int64_t sumXX;
+    int64_t sumXY;
+} LEVEL;
+
+void initLevel(LEVEL* level, float outOffset, float outSlope, float inOffset, float inSlope);
+void resetLevel(LEVEL* level);
+void setLevelBandwidth(LEVEL* level, float bandwidth);
+void presetLevel(LEVEL* level, float gain, float offset);
+bool updateLevel(LEVEL* level, uint16_t target, uint16_t load);
+
+// Applies the trim to one DAC code, called from the DDS tick
+static inline uint16_t trimLevel(LEVEL* level, uint16_t code)
+{
+    int32_t value = ((int32_t)code * level->gainQ14 + level->offsetQ14) >> 14;
+
+    if(value < 0)
+        return 0;
+    if(value > 4095)
+        return 4095;
+    return value;
+}
+
+#endif /* LEVEL_H_ */
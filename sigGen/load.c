@@ -0,0 +1,103 @@
+/*
+ * load.c
+ *
+ *  Each ISR adds the clocks of its body to a running total, and the shell
+ *  adds the time it spent on each command less the ISR time inside it.
+ *  Every LOAD_PERIOD_MS the totals are differenced into a slot of the
+ *  rolling window. Idle is what is left: the shell waiting for input,
+ *  plus the stacking and unstacking of every interrupt.
+ *
+ *  A command is counted when it finishes, so a long one ('bode', 'bench')
+ *  lands in a single slot. It is clipped to what the ISRs left of the window.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "load.h"
+
+static char* const names[LOAD_SOURCES] =
+{
+    "tickIsr", "captureIsr", "levelIsr", "timer2tick", "shell"
+};
+
+char* getLoadName(LOAD_SOURCE source)
+{
+    return source < LOAD_SOURCES ? names[source] : "?";
+}
+
+void startLoad(LOAD* load, uint32_t now)
+{
+    uint8_t s;
+
+    for(s = 0; s < LOAD_SOURCES; s++)
+        load->last[s] = load->total[s];
+    load->lastTime = now;
+    load->next = 0;
+    load->filled = 0;
+    load->sequence = 0;
+}
+
+// Clocks taken by all the ISRs so far, the shell subtracts what fell inside a command
+uint32_t getLoadIsrTotal(LOAD* load)
+{
+    return load->total[LOAD_TICK] + load->total[LOAD_CAPTURE] + load->total[LOAD_LEVEL] + load->total[LOAD_TIMER2];
+}
+
+// Closes a slot, called every LOAD_PERIOD_MS
+void sampleLoad(LOAD* load, uint32_t now)
+{
+    uint32_t total;
+    uint8_t s;
+
+    load->sequence++;
+    for(s = 0; s < LOAD_SOURCES; s++)
+    {
+        total = load->total[s];
+        load->slot[load->next][s] = total - load->last[s];
+        load->last[s] = total;
+    }
+    load->slotTime[load->next] = now - load->lastTime;
+    load->lastTime = now;
+    load->next = (load->next + 1) % LOAD_SLOTS;
+    if(load->filled < LOAD_SLOTS)
+        load->filled++;
+    load->sequence++;
+}
+
+// Percent of the window per source, false until the first slot closes
+bool getLoad(LOAD* load, LOAD_RESULT* result)
+{
+    uint64_t sum[LOAD_SOURCES], window;
+    uint32_t sequence;
+    float used;
+    uint8_t i, s;
+
+    do
+    {
+        sequence = load->sequence;
+        window = 0;
+        for(s = 0; s < LOAD_SOURCES; s++)
+            sum[s] = 0;
+        for(i = 0; i < load->filled; i++)
+        {
+            window += load->slotTime[i];
+            for(s = 0; s < LOAD_SOURCES; s++)
+                sum[s] += load->slot[i][s];
+        }
+    } while((sequence & 1) || sequence != load->sequence);
+
+    if(window == 0)
+        return false;
+
+    used = 0;
+    for(s = 0; s < LOAD_SOURCES; s++)
+    {
+        result->percent[s] = 100.0f * sum[s] / window;
+        if(s == LOAD_SHELL && used + result->percent[s] > 100)
+            result->percent[s] = 100 - used;
+        used += result->percent[s];
+    }
+    result->idle = used < 100 ? 100 - used : 0;
+    result->window = window;
+    return true;
+}
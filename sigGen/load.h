@@ -0,0 +1,58 @@
+/*
+ * load.h
+ *
+ *  CPU time per ISR and for the shell over a rolling window
+ */
+
+#ifndef LOAD_H_
+#define LOAD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LOAD_PERIOD_MS 100  // sampling period
+#define LOAD_SLOTS 10       // samples in the rolling window
+
+typedef enum _LOAD_SOURCE
+{
+    LOAD_TICK = 0,          // tickIsr()
+    LOAD_CAPTURE = 1,       // captureIsr() and its block handler
+    LOAD_LEVEL = 2,         // levelIsr()
+    LOAD_TIMER2 = 3,        // timer2tick() ('sample' printing)
+    LOAD_SHELL = 4,         // main loop running commands, ISRs taken out
+    LOAD_SOURCES = 5
+} LOAD_SOURCE;
+
+typedef struct _LOAD
+{
+    volatile uint32_t total[LOAD_SOURCES]; // clocks, each written by one context only, wraps
+    uint32_t last[LOAD_SOURCES];
+    uint32_t lastTime;
+
+    // rolling window, read with getLoad()
+    volatile uint32_t sequence; // odd while being written
+    uint32_t slot[LOAD_SLOTS][LOAD_SOURCES];
+    uint32_t slotTime[LOAD_SLOTS];
+    uint8_t next;
+    uint8_t filled;
+} LOAD;
+
+typedef struct _LOAD_RESULT
+{
+    float percent[LOAD_SOURCES];
+    float idle;             // percent left over, includes ISR entry and exit
+    uint32_t window;        // clocks covered
+} LOAD_RESULT;
+
+static inline void addLoad(LOAD* load, LOAD_SOURCE source, uint32_t cycles)
+{
+    load->total[source] += cycles;
+}
+
+void startLoad(LOAD* load, uint32_t now);
+uint32_t getLoadIsrTotal(LOAD* load);
+void sampleLoad(LOAD* load, uint32_t now);
+bool getLoad(LOAD* load, LOAD_RESULT* result);
+char* getLoadName(LOAD_SOURCE source);
+
+#endif /* LOAD_H_ */
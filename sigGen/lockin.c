@@ -0,0 +1,112 @@
+/*
+ * lockin.c
+ *
+ *  Multiplies interleaved capture pairs by sin and cos of a reference phase
+ *  that advances at freq / sampleRate per pair and integrates over a whole
+ *  number of cycles. DC is removed exactly at the end using the reference
+ *  sums, so the ADC mid-scale offset does not bias the result.
+ *
+ *  Both inputs share the reference, so their phase difference does not
+ *  depend on where the reference started.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "lockin.h"
+
+// Q15 sine, cos is read a quarter table ahead
+int16_t refTable[LOCKIN_TABLE_SIZE];
+
+void initLockin(void)
+{
+    uint16_t i;
+
+    for(i = 0; i < LOCKIN_TABLE_SIZE; i++)
+        refTable[i] = (int16_t)(32767.0f * sinf(2.0f * M_PI * i / LOCKIN_TABLE_SIZE));
+}
+
+// Integrates the nearest whole number of sample pairs to cycles periods of freq
+void startLockin(LOCKIN* lockin, float freq, uint32_t sampleRate, uint16_t cycles)
+{
+    startLockinPhase(lockin, 0, (uint32_t)((double)freq / (double)sampleRate * 4294967296.0),
+                     (uint32_t)((float)cycles * (float)sampleRate / freq + 0.5f));
+}
+
+// Integrates pairs samples against a reference starting at phase, for samples
+// locked to the source (2^32 is one cycle), so phases are relative to the source
+void startLockinPhase(LOCKIN* lockin, uint32_t phase, uint32_t phaseStep, uint32_t pairs)
+{
+    uint8_t n;
+
+    lockin->phase = phase;
+    lockin->phaseStep = phaseStep;
+    lockin->remaining = pairs;
+    lockin->count = 0;
+    for(n = 0; n < 2; n++)
+    {
+        lockin->sumI[n] = 0;
+        lockin->sumQ[n] = 0;
+        lockin->sumX[n] = 0;
+    }
+    lockin->sumCos = 0;
+    lockin->sumSin = 0;
+}
+
+// Feeds a capture block, returns true once enough samples have been integrated
+bool updateLockin(LOCKIN* lockin, uint16_t* block, uint16_t pairs)
+{
+    uint32_t phase = lockin->phase;
+    uint32_t index;
+    int32_t s, c, x0, x1;
+    uint16_t i;
+
+    if(pairs > lockin->remaining)
+        pairs = lockin->remaining;
+
+    for(i = 0; i < pairs; i++)
+    {
+        index = phase >> (32 - LOCKIN_TABLE_BITS);
+        s = refTable[index];
+        c = refTable[(index + LOCKIN_TABLE_SIZE / 4) & (LOCKIN_TABLE_SIZE - 1)];
+        x0 = block[2 * i];
+        x1 = block[2 * i + 1];
+
+        lockin->sumI[0] += x0 * c;
+        lockin->sumQ[0] += x0 * s;
+        lockin->sumI[1] += x1 * c;
+        lockin->sumQ[1] += x1 * s;
+        lockin->sumX[0] += x0;
+        lockin->sumX[1] += x1;
+        lockin->sumCos += c;
+        lockin->sumSin += s;
+
+        phase += lockin->phaseStep;
+    }
+
+    lockin->phase = phase;
+    lockin->count += pairs;
+    lockin->remaining -= pairs;
+    return lockin->remaining == 0;
+}
+
+// Amplitude in sample units (peak, ADC codes << getCaptureShift()) and phase in degrees of input 0 (IN1) or 1 (IN2)
+void getLockinResult(LOCKIN* lockin, uint8_t input, float* amplitude, float* phase)
+{
+    float n = (float)lockin->count;
+    float mean, i, q;
+
+    if(lockin->count == 0)
+    {
+        *amplitude = 0;
+        *phase = 0;
+        return;
+    }
+
+    mean = (float)lockin->sumX[input] / n;
+    i = ((float)lockin->sumI[input] - mean * (float)lockin->sumCos) / (n * 32767.0f);
+    q = ((float)lockin->sumQ[input] - mean * (float)lockin->sumSin) / (n * 32767.0f);
+
+    *amplitude = 2.0f * sqrtf(i * i + q * q);
+    *phase = atan2f(i, q) * 180.0f / M_PI;
+}
@@ -0,0 +1,35 @@
+/*
+ * lockin.h
+ *
+ *  Synchronous (lock-in) detector for gain and phase of both ADC inputs
+ */
+
+#ifndef LOCKIN_H_
+#define LOCKIN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LOCKIN_TABLE_BITS 9
+#define LOCKIN_TABLE_SIZE (1 << LOCKIN_TABLE_BITS)
+
+typedef struct _LOCKIN
+{
+    uint32_t phase;         // reference phase, 2^32 is one cycle
+    uint32_t phaseStep;     // reference phase advance per sample pair
+    uint32_t remaining;     // sample pairs left to integrate
+    uint32_t count;         // sample pairs integrated
+    int64_t sumI[2];        // x * cos per input
+    int64_t sumQ[2];        // x * sin per input
+    int64_t sumX[2];        // x per input, removes DC at the end
+    int64_t sumCos;
+    int64_t sumSin;
+} LOCKIN;
+
+void initLockin(void);
+void startLockin(LOCKIN* lockin, float freq, uint32_t sampleRate, uint16_t cycles);
+void startLockinPhase(LOCKIN* lockin, uint32_t phase, uint32_t phaseStep, uint32_t pairs);
+bool updateLockin(LOCKIN* lockin, uint16_t* block, uint16_t pairs);
+void getLockinResult(LOCKIN* lockin, uint8_t input, float* amplitude, float* phase);
+
+#endif /* LOCKIN_H_ */
@@ -0,0 +1,266 @@
+/*
+ * macro.c
+ *
+ *  Named command macros kept in EEPROM as pre-parsed shell lines.
+ *  Each line is stored after parseFields() has run, so replay skips
+ *  the UART and the parser and goes straight to command dispatch.
+ *
+ *  Line record: [size][fieldCount][fieldType x MAX_FIELDS][fieldPosition x MAX_FIELDS][buffer text]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "macro.h"
+#include "eeprom.h"
+#include "uart0.h"
+
+#define HEADER_MAGIC 0
+#define HEADER_BOOT 1
+#define SLOT_BASE 16
+
+#define RECORD_HEADER (2 + 2 * MAX_FIELDS)
+
+// One macro body, used for recording and for replay (never both at once)
+uint32_t macroWords[MACRO_DATA_BYTES / 4];
+uint16_t macroLength = 0;
+uint16_t macroOffset = 0;
+char macroName[MACRO_NAME_CHARS + 1];
+bool recording = false;
+
+static uint16_t slotAddress(int8_t slot)
+{
+    return SLOT_BASE + slot * MACRO_SLOT_WORDS;
+}
+
+// Packs up to MACRO_NAME_CHARS of name into two words, zero padded
+static void packName(char* name, uint32_t* words)
+{
+    uint8_t* bytes = (uint8_t*)words;
+    uint8_t i;
+
+    words[0] = words[1] = 0;
+    for(i = 0; i < MACRO_NAME_CHARS && name[i] != '\0'; i++)
+        bytes[i] = name[i];
+}
+
+static bool slotUsed(int8_t slot)
+{
+    uint32_t first = readEeprom(slotAddress(slot));
+    return first != 0 && first != 0xFFFFFFFF;
+}
+
+void initMacros(void)
+{
+    int8_t slot;
+
+    initEeprom();
+    if(readEeprom(HEADER_MAGIC) != MACRO_MAGIC)
+    {
+        for(slot = 0; slot < MACRO_SLOTS; slot++)
+            writeEeprom(slotAddress(slot), 0);
+        writeEeprom(HEADER_BOOT, (uint32_t)MACRO_NONE);
+        writeEeprom(HEADER_MAGIC, MACRO_MAGIC);
+    }
+}
+
+bool beginMacro(char* name)
+{
+    uint8_t i;
+
+    if(recording || name == 0 || name[0] == '\0')
+        return false;
+
+    for(i = 0; i < MACRO_NAME_CHARS && name[i] != '\0'; i++)
+        macroName[i] = name[i];
+    macroName[i] = '\0';
+    macroLength = 0;
+    recording = true;
+    return true;
+}
+
+bool isRecordingMacro(void)
+{
+    return recording;
+}
+
+// Appends a parsed line, returns false if the macro is full
+bool addMacroLine(USER_DATA* data)
+{
+    uint8_t* bytes = (uint8_t*)macroWords;
+    uint8_t last = data->fieldCount - 1;
+    uint8_t textLength;
+    uint8_t i;
+
+    if(!recording || data->fieldCount == 0 || data->fieldCount > MAX_FIELDS)
+        return false;
+
+    // text runs to the end of the last field, including its terminator
+    textLength = data->fieldPosition[last];
+    while(data->buffer[textLength] != '\0')
+        textLength++;
+    textLength++;
+
+    if(macroLength + RECORD_HEADER + textLength > MACRO_DATA_BYTES)
+        return false;
+
+    bytes[macroLength++] = RECORD_HEADER + textLength;
+    bytes[macroLength++] = data->fieldCount;
+    for(i = 0; i < MAX_FIELDS; i++)
+        bytes[macroLength++] = data->fieldType[i];
+    for(i = 0; i < MAX_FIELDS; i++)
+        bytes[macroLength++] = data->fieldPosition[i];
+    for(i = 0; i < textLength; i++)
+        bytes[macroLength++] = data->buffer[i];
+
+    return true;
+}
+
+// Writes the recorded macro over a slot with the same name or the first free one
+bool endMacro(void)
+{
+    uint32_t name[2];
+    int8_t slot;
+    uint16_t add, i;
+
+    if(!recording)
+        return false;
+    recording = false;
+
+    slot = findMacro(macroName);
+    if(slot == MACRO_NONE)
+        for(slot = 0; slot < MACRO_SLOTS && slotUsed(slot); slot++);
+    if(slot == MACRO_SLOTS)
+        return false;
+
+    add = slotAddress(slot);
+    packName(macroName, name);
+    writeEeprom(add, 0); // slot reads as free until fully written
+    writeEeprom(add + 2, macroLength);
+    for(i = 0; i < (macroLength + 3) / 4; i++)
+        writeEeprom(add + 3 + i, macroWords[i]);
+    writeEeprom(add + 1, name[1]);
+    writeEeprom(add, name[0]);
+
+    return true;
+}
+
+int8_t findMacro(char* name)
+{
+    uint32_t packed[2];
+    int8_t slot;
+
+    if(name == 0 || name[0] == '\0')
+        return MACRO_NONE;
+
+    packName(name, packed);
+    for(slot = 0; slot < MACRO_SLOTS; slot++)
+        if(readEeprom(slotAddress(slot)) == packed[0] && readEeprom(slotAddress(slot) + 1) == packed[1])
+            return slot;
+    return MACRO_NONE;
+}
+
+bool deleteMacro(char* name)
+{
+    int8_t slot = findMacro(name);
+
+    if(slot == MACRO_NONE)
+        return false;
+    if(getBootMacro() == slot)
+        writeEeprom(HEADER_BOOT, (uint32_t)MACRO_NONE);
+    writeEeprom(slotAddress(slot), 0);
+    return true;
+}
+
+void listMacros(void)
+{
+    uint32_t name[3];
+    int8_t slot;
+    int8_t boot = getBootMacro();
+
+    name[2] = 0;
+    for(slot = 0; slot < MACRO_SLOTS; slot++)
+    {
+        if(!slotUsed(slot))
+            continue;
+        name[0] = readEeprom(slotAddress(slot));
+        name[1] = readEeprom(slotAddress(slot) + 1);
+        putsUart0((char*)name);
+        putsUart0(" (");
+        putuUart0(readEeprom(slotAddress(slot) + 2));
+        putsUart0(" bytes)");
+        if(slot == boot)
+            putsUart0(" [boot]");
+        putcUart0('\n');
+    }
+}
+
+// name of 0 or "off" clears the boot macro
+bool setBootMacro(char* name)
+{
+    int8_t slot = MACRO_NONE;
+
+    if(name != 0 && !strcomp(name, "off"))
+    {
+        slot = findMacro(name);
+        if(slot == MACRO_NONE)
+            return false;
+    }
+    writeEeprom(HEADER_BOOT, (uint32_t)slot);
+    return true;
+}
+
+int8_t getBootMacro(void)
+{
+    int32_t slot = readEeprom(HEADER_BOOT);
+
+    if(slot < 0 || slot >= MACRO_SLOTS || !slotUsed(slot))
+        return MACRO_NONE;
+    return slot;
+}
+
+// Reads a macro body into RAM and rewinds replay
+bool loadMacro(int8_t slot)
+{
+    uint16_t add, i;
+
+    if(recording || slot < 0 || slot >= MACRO_SLOTS || !slotUsed(slot))
+        return false;
+
+    add = slotAddress(slot);
+    macroLength = readEeprom(add + 2);
+    if(macroLength > MACRO_DATA_BYTES)
+        return false;
+    for(i = 0; i < (macroLength + 3) / 4; i++)
+        macroWords[i] = readEeprom(add + 3 + i);
+    macroOffset = 0;
+    return true;
+}
+
+// Rebuilds the next stored line into data, returns false at the end of the macro
+bool nextMacroLine(USER_DATA* data)
+{
+    uint8_t* bytes = (uint8_t*)macroWords;
+    uint8_t size, i;
+
+    if(macroOffset + RECORD_HEADER > macroLength)
+        return false;
+
+    size = bytes[macroOffset];
+    if(size <= RECORD_HEADER || size - RECORD_HEADER > MAX_CHARS + 1 || macroOffset + size > macroLength)
+        return false;
+
+    data_flush(data);
+    data->fieldCount = bytes[macroOffset + 1];
+    if(data->fieldCount == 0 || data->fieldCount > MAX_FIELDS)
+        return false;
+    for(i = 0; i < MAX_FIELDS; i++)
+    {
+        data->fieldType[i] = bytes[macroOffset + 2 + i];
+        data->fieldPosition[i] = bytes[macroOffset + 2 + MAX_FIELDS + i];
+    }
+    for(i = 0; i < size - RECORD_HEADER; i++)
+        data->buffer[i] = bytes[macroOffset + RECORD_HEADER + i];
+
+    macroOffset += size;
+    return true;
+}
@@ -0,0 +1,44 @@
+/*
+ * macro.h
+ *
+ *  Named command macros kept in EEPROM as pre-parsed shell lines
+ */
+
+#ifndef MACRO_H_
+#define MACRO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cmd.h"
+
+// EEPROM layout (word addresses)
+// 0-15:    header (magic, boot macro)
+// 16-463:  MACRO_SLOTS slots of MACRO_SLOT_WORDS
+// 464-483: saved generator state (state.h)
+// 484-511: free for other settings
+#define MACRO_MAGIC 0x4D414332 // "MAC2", bump when the record layout changes
+#define MACRO_SLOTS 4
+#define MACRO_SLOT_WORDS 112
+#define MACRO_NAME_CHARS 8
+#define MACRO_DATA_BYTES ((MACRO_SLOT_WORDS - 3) * 4)
+#define MACRO_EEPROM_END (16 + MACRO_SLOTS * MACRO_SLOT_WORDS)
+#define MACRO_NONE -1
+
+void initMacros(void);
+
+bool beginMacro(char* name);
+bool isRecordingMacro(void);
+bool addMacroLine(USER_DATA* data);
+bool endMacro(void);
+
+int8_t findMacro(char* name);
+bool deleteMacro(char* name);
+void listMacros(void);
+
+bool setBootMacro(char* name);
+int8_t getBootMacro(void);
+
+bool loadMacro(int8_t slot);
+bool nextMacroLine(USER_DATA* data);
+
+#endif /* MACRO_H_ */
@@ -0,0 +1,129 @@
+/*
+ * meter.c
+ *
+ *  Every sample costs a fixed handful of adds and compares per input, so the
+ *  meter can follow the capture stream at its full rate from the block ISR.
+ *  At the end of each window the sums are turned into results, published
+ *  behind a sequence count so the shell can read them at any time.
+ *
+ *  Rising crossings of the previous window's mean (with METER_HYSTERESIS)
+ *  time the frequency as whole periods between the first and last crossing.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "meter.h"
+
+#define ADC_MIDSCALE 2048
+
+static void setThresholds(METER_INPUT* in, uint16_t mean)
+{
+    in->low = mean > METER_HYSTERESIS ? mean - METER_HYSTERESIS : 0;
+    in->high = mean + METER_HYSTERESIS;
+}
+
+static void clearInput(METER_INPUT* in)
+{
+    in->sum = 0;
+    in->sumSquares = 0;
+    in->min = 0xFFFF;
+    in->max = 0;
+    in->crossings = 0;
+}
+
+void startMeter(METER* meter, uint32_t rate, uint32_t window)
+{
+    uint8_t n;
+
+    meter->rate = rate;
+    meter->window = window;
+    meter->count = 0;
+    meter->sequence = 0;
+    meter->windows = 0;
+    meter->cyclesPerPair = 0;
+    for(n = 0; n < 2; n++)
+    {
+        clearInput(&meter->input[n]);
+        setThresholds(&meter->input[n], ADC_MIDSCALE);
+        meter->input[n].above = false;
+    }
+}
+
+static void publishInput(METER* meter, METER_INPUT* in, METER_VALUES* values)
+{
+    float n = meter->count;
+    float mean = in->sum / n;
+    float variance = in->sumSquares / n - mean * mean;
+
+    values->mean = mean;
+    values->rms = variance > 0 ? sqrtf(variance) : 0;
+    values->min = in->min;
+    values->max = in->max;
+    if(in->crossings >= 2)
+        values->freq = (float)(in->crossings - 1) * meter->rate / (in->lastCrossing - in->firstCrossing);
+    else
+        values->freq = 0;
+
+    setThresholds(in, mean + 0.5f);
+    clearInput(in);
+}
+
+// Feeds a block of pairs, constant work per sample
+void updateMeter(METER* meter, uint16_t* block, uint16_t pairs)
+{
+    uint16_t i, x;
+    uint8_t n;
+
+    for(i = 0; i < pairs; i++)
+    {
+        for(n = 0; n < 2; n++)
+        {
+            METER_INPUT* in = &meter->input[n];
+
+            x = block[2 * i + n];
+            in->sum += x;
+            in->sumSquares += (uint32_t)x * x;
+            if(x < in->min)
+                in->min = x;
+            if(x > in->max)
+                in->max = x;
+
+            if(in->above)
+                in->above = x >= in->low;
+            else if(x > in->high)
+            {
+                in->above = true;
+                if(in->crossings++ == 0)
+                    in->firstCrossing = meter->count;
+                in->lastCrossing = meter->count;
+            }
+        }
+
+        if(++meter->count == meter->window)
+        {
+            meter->sequence++;
+            publishInput(meter, &meter->input[0], &meter->values[0]);
+            publishInput(meter, &meter->input[1], &meter->values[1]);
+            meter->windows++;
+            meter->sequence++;
+            meter->count = 0;
+        }
+    }
+}
+
+// Copies the latest results, false if no window has finished yet
+bool getMeterValues(METER* meter, METER_VALUES* in1, METER_VALUES* in2, uint32_t* windows)
+{
+    uint32_t sequence;
+
+    do
+    {
+        sequence = meter->sequence;
+        *in1 = meter->values[0];
+        *in2 = meter->values[1];
+        *windows = meter->windows;
+    } while((sequence & 1) || sequence != meter->sequence);
+
+    return *windows > 0;
+}
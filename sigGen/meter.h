@@ -0,0 +1,57 @@
+/*
+ * meter.h
+ *
+ *  Running DC, RMS, min/max and zero-crossing frequency of both ADC inputs
+ */
+
+#ifndef METER_H_
+#define METER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define METER_HYSTERESIS 8  // ADC codes either side of the mean for a crossing
+#define METER_MAX_WINDOW 1000000 // pairs, keeps the 12-bit sums in 32 bits
+
+typedef struct _METER_VALUES
+{
+    float mean;             // ADC codes
+    float rms;              // ADC codes, AC part only
+    uint16_t min;
+    uint16_t max;
+    float freq;             // Hz, 0 with fewer than two rising crossings
+} METER_VALUES;
+
+typedef struct _METER_INPUT
+{
+    uint32_t sum;
+    uint64_t sumSquares;
+    uint16_t min;
+    uint16_t max;
+    uint16_t low;           // crossing thresholds from the last window's mean
+    uint16_t high;
+    bool above;
+    uint32_t firstCrossing; // sample index of the first and last rising crossing
+    uint32_t lastCrossing;
+    uint32_t crossings;
+} METER_INPUT;
+
+typedef struct _METER
+{
+    uint32_t rate;          // pairs per second
+    uint32_t window;        // pairs per result
+    uint32_t count;         // pairs in the current window
+    METER_INPUT input[2];
+
+    // latest finished window, read with getMeterValues()
+    volatile uint32_t sequence; // odd while being written
+    METER_VALUES values[2];
+    uint32_t windows;
+    float cyclesPerPair;    // CPU cost of the last block
+} METER;
+
+void startMeter(METER* meter, uint32_t rate, uint32_t window);
+void updateMeter(METER* meter, uint16_t* block, uint16_t pairs);
+bool getMeterValues(METER* meter, METER_VALUES* in1, METER_VALUES* in2, uint32_t* windows);
+
+#endif /* METER_H_ */
@@ -0,0 +1,194 @@
+/*
+ * scope.c
+ *
+ *  Copies capture blocks into a ring of the requested depth until the
+ *  trigger fires with enough history behind it, then keeps copying until
+ *  the post-trigger part is full. Everything runs on the uDMA capture
+ *  stream from the main loop, so tickIsr() is never held off.
+ *
+ *  Binary frame (little-endian):
+ *    0   'S' 'C'
+ *    2   uint8 version
+ *    3   uint8 flags, bit 0 set if the trigger fired (clear on timeout)
+ *    4   uint32 sample rate (pairs/s)
+ *    8   uint16 pairs
+ *    10  uint16 trigger index (pre-trigger depth)
+ *    12  pairs * 3 bytes, two 12-bit samples per pair:
+ *        IN1[7:0], IN2[3:0]:IN1[11:8], IN2[11:4]
+ *    end uint16 sum of the packed sample bytes
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scope.h"
+#include "capture.h"
+#include "uart0.h"
+
+uint16_t scopeBuffer[SCOPE_PAIRS * 2];
+uint16_t scopePairs = 0;
+uint16_t scopePre = 0;
+uint32_t scopeRate = 0;
+bool scopeStalled = false; // last runScope() gave up waiting for capture data
+bool scopeTriggered = false;
+uint8_t scopeShift = 0;     // fraction bits of decimated samples
+
+TRIGGER triggerMode = TRIG_NONE;
+uint8_t triggerInput = 0;   // 0 = IN1, 1 = IN2
+uint16_t triggerLevel = 2048;
+
+void setScopeTrigger(TRIGGER mode, uint8_t input, uint16_t level)
+{
+    triggerMode = mode;
+    triggerInput = input;
+    triggerLevel = level;
+}
+
+static bool isTrigger(uint16_t previous, uint16_t sample)
+{
+    switch(triggerMode)
+    {
+    case TRIG_NONE: return true;
+    case TRIG_RISE: return previous < triggerLevel && sample >= triggerLevel;
+    case TRIG_FALL: return previous > triggerLevel && sample <= triggerLevel;
+    case TRIG_HIGH: return sample >= triggerLevel;
+    case TRIG_LOW:  return sample <= triggerLevel;
+    default:        return true;
+    }
+}
+
+// Reverses pairs first..last of the ring, used to rotate it in place
+static void reversePairs(uint16_t first, uint16_t last)
+{
+    uint32_t* pairs = (uint32_t*)scopeBuffer;
+    uint32_t temp;
+
+    while(first < last)
+    {
+        temp = pairs[first];
+        pairs[first++] = pairs[last];
+        pairs[last--] = temp;
+    }
+}
+
+// Captures pairs samples with pre of them before the trigger, oldest first in scopeBuffer
+// Falls back to an untriggered capture after about a second without a trigger
+// Returns false for bad arguments, or with isScopeStalled() if capture data stopped
+bool runScope(uint32_t rate, uint16_t pairs, uint16_t pre)
+{
+    uint16_t* block;
+    uint16_t write = 0;
+    uint16_t filled = 0;
+    uint16_t post = 0;
+    uint16_t previous;
+    uint16_t start = 0;
+    uint32_t timeoutBlocks;
+    uint16_t i;
+    bool triggered = false;
+    bool forced = false;
+
+    scopeStalled = false;
+    if(pairs == 0 || pairs > SCOPE_PAIRS || pre >= pairs || !startCapture(rate))
+        return false;
+
+    scopeRate = getCaptureRate();
+    scopeShift = getCaptureShift();
+    timeoutBlocks = scopeRate / CAPTURE_PAIRS + 2;
+    previous = triggerMode == TRIG_FALL ? 0 : 0xFFFF;
+
+    while(!triggered || post < pairs - pre)
+    {
+        if((block = waitCaptureBlock()) == 0)
+        {
+            stopCapture();
+            scopeStalled = true;
+            return false;
+        }
+
+        for(i = 0; i < CAPTURE_PAIRS; i++)
+        {
+            uint16_t sample = block[2 * i + triggerInput] >> scopeShift;
+
+            scopeBuffer[2 * write] = block[2 * i];
+            scopeBuffer[2 * write + 1] = block[2 * i + 1];
+
+            if(triggered)
+            {
+                if(++post == pairs - pre)
+                    break;
+            }
+            else if(filled >= pre && (forced || isTrigger(previous, sample)))
+            {
+                triggered = true;
+                start = write;
+                if(++post == pairs - pre)
+                    break;
+            }
+            previous = sample;
+
+            if(filled < pairs)
+                filled++;
+            if(++write == pairs)
+                write = 0;
+        }
+
+        if(!triggered && timeoutBlocks > 0 && --timeoutBlocks == 0)
+            forced = true;
+    }
+    stopCapture();
+
+    // rotate so the oldest pre-trigger pair is first
+    start = (start + pairs - pre) % pairs;
+    if(start != 0)
+    {
+        reversePairs(0, start - 1);
+        reversePairs(start, pairs - 1);
+        reversePairs(0, pairs - 1);
+    }
+
+    scopePairs = pairs;
+    scopePre = pre;
+    scopeTriggered = !forced;
+    return true;
+}
+
+bool isScopeStalled(void)
+{
+    return scopeStalled;
+}
+
+void sendScopeFrame(void)
+{
+    uint8_t header[12];
+    uint8_t packed[3];
+    uint16_t sum = 0;
+    uint16_t in1, in2, i;
+
+    header[0] = 'S';
+    header[1] = 'C';
+    header[2] = SCOPE_FRAME_VERSION;
+    header[3] = scopeTriggered ? 1 : 0;
+    header[4] = scopeRate & 0xFF;
+    header[5] = (scopeRate >> 8) & 0xFF;
+    header[6] = (scopeRate >> 16) & 0xFF;
+    header[7] = scopeRate >> 24;
+    header[8] = scopePairs & 0xFF;
+    header[9] = scopePairs >> 8;
+    header[10] = scopePre & 0xFF;
+    header[11] = scopePre >> 8;
+    putBufferUart0(header, sizeof(header));
+
+    for(i = 0; i < scopePairs; i++)
+    {
+        in1 = (scopeBuffer[2 * i] >> scopeShift) & 0xFFF;
+        in2 = (scopeBuffer[2 * i + 1] >> scopeShift) & 0xFFF;
+        packed[0] = in1 & 0xFF;
+        packed[1] = (in1 >> 8) | ((in2 & 0xF) << 4);
+        packed[2] = in2 >> 4;
+        sum += packed[0] + packed[1] + packed[2];
+        putBufferUart0(packed, 3);
+    }
+
+    packed[0] = sum & 0xFF;
+    packed[1] = sum >> 8;
+    putBufferUart0(packed, 2);
+}
@@ -0,0 +1,35 @@
+/*
+ * scope.h
+ *
+ *  Triggered capture of both inputs with pre-trigger and binary dump
+ */
+
+#ifndef SCOPE_H_
+#define SCOPE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// RAM budget for one capture, pairs of [IN1, IN2]
+#define SCOPE_PAIRS 1024
+
+#define SCOPE_FRAME_VERSION 1
+
+typedef enum _TRIGGER
+{
+    TRIG_NONE = 0,  // capture immediately
+    TRIG_RISE = 1,  // source crosses level going up
+    TRIG_FALL = 2,  // source crosses level going down
+    TRIG_HIGH = 3,  // source at or above level
+    TRIG_LOW = 4    // source at or below level
+} TRIGGER;
+
+// Samples as delivered by capture, see getCaptureShift()
+extern uint16_t scopeBuffer[SCOPE_PAIRS * 2];
+
+void setScopeTrigger(TRIGGER mode, uint8_t input, uint16_t level);
+bool runScope(uint32_t rate, uint16_t pairs, uint16_t pre);
+bool isScopeStalled(void);
+void sendScopeFrame(void);
+
+#endif /* SCOPE_H_ */
@@ -0,0 +1,256 @@
+/*
+ * selftest.c
+ *
+ *  Each case builds its tables with calculateWave() and plays them through
+ *  ddsTick() into a buffer of [OUT A, OUT B] pairs, the same layout as the
+ *  ADC capture, so the FFT can look at the codes exactly as they would be
+ *  sent to the DAC. The tone sits on a bin (phase step of a power of two)
+ *  so the record holds whole cycles and the spectrum has no leakage.
+ *
+ *  The expected amplitudes come from output2RValue() itself, which keeps
+ *  the check independent of the DAC calibration values.
+ *
+ *  The DDS state is saved and put back. The tables are rendered again from
+ *  their saved WAVE_PARAMS and the records restored, so a 'save' after a
+ *  self test stores the user's waveform; a table with no record (type 0)
+ *  keeps the test waveform but stays marked as not rendered.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "selftest.h"
+#include "dds.h"
+#include "fft.h"
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+#define FULL_SCALE_CODES 2048.0f // FFT power 0.5 is a sine of this amplitude
+
+typedef enum _SELFTEST_CASE
+{
+    CASE_SINE,
+    CASE_SQUARE,
+    CASE_SAWTOOTH,
+    CASE_TRIANGLE,
+    CASE_DIFFERENTIAL,
+    CASE_HILBERT,
+    CASE_CYCLES,
+    CASE_COUNT
+} SELFTEST_CASE;
+
+static char* const names[CASE_COUNT] =
+{
+    "sine", "square", "sawtooth", "triangle", "differential", "hilbert", "cycles"
+};
+
+uint8_t getSelfTestCount(void)
+{
+    return CASE_COUNT;
+}
+
+char* getSelfTestName(uint8_t test)
+{
+    return test < CASE_COUNT ? names[test] : 0;
+}
+
+static float toDb(float ratio)
+{
+    return 10 * log10f(ratio + 1e-20f);
+}
+
+// Power of harmonic h relative to the fundamental for each ideal shape
+static float harmonicPower(WAVE type, uint8_t h)
+{
+    switch(type)
+    {
+    case SQUARE:
+        return (h & 1) ? 1.0f / (h * h) : 0;
+    case SAW:
+        return 1.0f / (h * h);
+    case TRI:
+        return (h & 1) ? 1.0f / ((float)h * h * h * h) : 0;
+    default:
+        return 0;
+    }
+}
+
+// Fundamental amplitude of each ideal shape with peak 1
+static float fundamentalGain(WAVE type)
+{
+    switch(type)
+    {
+    case SQUARE:
+        return 4 / M_PI;
+    case SAW:
+        return 2 / M_PI;
+    case TRI:
+        return 8 / (M_PI * M_PI);
+    default:
+        return 1;
+    }
+}
+
+// Plays n ticks into buffer, returns the ticks OUT A played
+static uint32_t render(uint16_t* buffer, uint16_t n, uint8_t outputs, uint32_t* checksum)
+{
+    uint16_t i, codeA = 0, codeB = 0;
+    uint32_t ticks = 0, hash = FNV_OFFSET;
+    uint8_t playing;
+
+    lut_i_A = lut_i_B = 0;
+    currentCycles_A = currentCycles_B = 0;
+    phaseAccum_A = phaseAccum_B = (uint32_t)SELFTEST_BIN << (DDS_PHASE_BITS - 10); // n = 2^10
+    outA_EN = outB_EN = true;
+
+    for(i = 0; i < n; i++)
+    {
+        playing = ddsTick(&codeA, &codeB);
+        if(playing & DDS_OUT_A)
+            ticks++;
+        buffer[2 * i] = codeA;
+        buffer[2 * i + 1] = codeB;
+
+        if(outputs & DDS_OUT_A)
+            hash = (hash ^ codeA) * FNV_PRIME;
+        if(outputs & DDS_OUT_B)
+            hash = (hash ^ codeB) * FNV_PRIME;
+    }
+    *checksum = hash;
+    return ticks;
+}
+
+// Normalized correlation of the AC parts of OUT A and OUT B
+static float correlate(uint16_t* buffer, uint16_t n)
+{
+    float meanA = 0, meanB = 0, ab = 0, aa = 0, bb = 0, a, b;
+    uint16_t i;
+
+    for(i = 0; i < n; i++)
+    {
+        meanA += buffer[2 * i];
+        meanB += buffer[2 * i + 1];
+    }
+    meanA /= n;
+    meanB /= n;
+    for(i = 0; i < n; i++)
+    {
+        a = buffer[2 * i] - meanA;
+        b = buffer[2 * i + 1] - meanB;
+        ab += a * b;
+        aa += a * a;
+        bb += b * b;
+    }
+    return ab / sqrtf(aa * bb + 1e-20f);
+}
+
+// Largest bin other than DC and the fundamental, relative to the fundamental
+static float getSfdr(int16_t* data, uint16_t n, uint16_t fundamental)
+{
+    float spur = 0, power;
+    uint16_t k;
+
+    for(k = 1; k <= n / 2; k++)
+    {
+        if(k == fundamental)
+            continue;
+        power = getFftPower(data, n, 0, k);
+        if(power > spur)
+            spur = power;
+    }
+    return toDb(getFftPower(data, n, 0, fundamental) / (spur + 1e-20f));
+}
+
+// Renders the saved waveforms again, B first with the modes off like a restore
+static void restoreTables(WAVE_PARAMS* waveA, WAVE_PARAMS* waveB, bool differential, bool hilbert)
+{
+    differentialEN = false;
+    hilbertEN = false;
+    if(waveB->type != 0)
+        calculateWave((WAVE)waveB->type, DAC_B, waveB->amp, waveB->ofs, waveB->dutyCycle);
+    differentialEN = differential;
+    hilbertEN = hilbert;
+    if(waveA->type != 0)
+        calculateWave((WAVE)waveA->type, DAC_A, waveA->amp, waveA->ofs, waveA->dutyCycle);
+
+    *getWaveParams(lutA_edit) = *waveA;
+    *getWaveParams(lutB_edit) = *waveB;
+}
+
+void runSelfTest(uint8_t test, uint16_t* buffer, SELFTEST_RESULT* result)
+{
+    // saved so the check leaves the generator as it found it
+    WAVE_PARAMS saveWaveA = *getWaveParams(lutA_edit), saveWaveB = *getWaveParams(lutB_edit);
+    uint32_t saveStepA = phaseAccum_A, saveStepB = phaseAccum_B;
+    uint32_t saveIndexA = lut_i_A, saveIndexB = lut_i_B;
+    uint32_t saveCyclesA = currentCycles_A, saveCyclesB = currentCycles_B;
+    int32_t saveMaxA = maxCycles_A, saveMaxB = maxCycles_B;
+    bool saveA = outA_EN, saveB = outB_EN;
+    bool saveDifferential = differentialEN, saveHilbert = hilbertEN;
+    WAVE type = SINE;
+    SPECTRUM spectrum;
+    float expected = 0, amplitude;
+    uint8_t h, outputs = DDS_OUT_A;
+
+    result->correlation = 0;
+    result->ticks = 0;
+
+    differentialEN = test == CASE_DIFFERENTIAL;
+    hilbertEN = test == CASE_HILBERT;
+    maxCycles_A = test == CASE_CYCLES ? SELFTEST_CYCLES : -1;
+    maxCycles_B = -1;
+    if(test == CASE_SQUARE)
+        type = SQUARE;
+    else if(test == CASE_SAWTOOTH)
+        type = SAW;
+    else if(test == CASE_TRIANGLE)
+        type = TRI;
+    if(differentialEN || hilbertEN)
+        outputs |= DDS_OUT_B;
+
+    calculateWave(type, DAC_A, SELFTEST_AMP, 0, 50);
+    result->ticks = render(buffer, SELFTEST_POINTS, outputs, &result->checksum);
+    if(outputs & DDS_OUT_B)
+        result->correlation = correlate(buffer, SELFTEST_POINTS);
+
+    prepareFft(buffer, SELFTEST_POINTS, false, 0);
+    fftQ15((int16_t*)buffer, SELFTEST_POINTS);
+    analyzeSpectrum((int16_t*)buffer, SELFTEST_POINTS, 0, 0, &spectrum);
+
+    // codes fall as the voltage rises
+    amplitude = ((float)output2RValue(DAC_A, -SELFTEST_AMP) - output2RValue(DAC_A, SELFTEST_AMP)) / 2;
+    result->bin = spectrum.fundamental;
+    result->amplitude = sqrtf(2 * spectrum.fundamentalPower) * FULL_SCALE_CODES / (amplitude * fundamentalGain(type));
+    result->thd = toDb(spectrum.thd);
+    result->sfdr = getSfdr((int16_t*)buffer, SELFTEST_POINTS, spectrum.fundamental);
+    for(h = 2; h < 2 + FFT_HARMONICS; h++)
+        expected += harmonicPower(type, h);
+    result->thdExpected = type == SINE ? SELFTEST_SINE_THD : toDb(expected);
+
+    result->pass = result->bin == SELFTEST_BIN;
+    if(test == CASE_CYCLES)
+        // one cycle is SELFTEST_POINTS / SELFTEST_BIN ticks, the last may run one more
+        result->pass = fabsf(result->ticks - (float)SELFTEST_CYCLES * SELFTEST_POINTS / SELFTEST_BIN) <= 1;
+    else
+        result->pass &= fabsf(result->amplitude - 1) <= SELFTEST_AMP_TOLERANCE;
+    if(type == SINE && test != CASE_CYCLES)
+        result->pass &= result->thd <= SELFTEST_SINE_THD && result->sfdr >= SELFTEST_SINE_SFDR;
+    else if(type != SINE)
+        result->pass &= fabsf(result->thd - result->thdExpected) <= SELFTEST_THD_TOLERANCE;
+    if(test == CASE_DIFFERENTIAL)
+        result->pass &= result->correlation <= -SELFTEST_CORRELATION;
+    if(test == CASE_HILBERT)
+        result->pass &= fabsf(result->correlation) <= SELFTEST_QUADRATURE;
+
+    restoreTables(&saveWaveA, &saveWaveB, saveDifferential, saveHilbert);
+    phaseAccum_A = saveStepA;
+    phaseAccum_B = saveStepB;
+    lut_i_A = saveIndexA;
+    lut_i_B = saveIndexB;
+    currentCycles_A = saveCyclesA;
+    currentCycles_B = saveCyclesB;
+    maxCycles_A = saveMaxA;
+    maxCycles_B = saveMaxB;
+    outA_EN = saveA;
+    outB_EN = saveB;
+}
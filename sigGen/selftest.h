@@ -0,0 +1,42 @@
+/*
+ * selftest.h
+ *
+ *  Renders the DDS into memory and checks the codes against the expected waveform
+ */
+
+#ifndef SELFTEST_H_
+#define SELFTEST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SELFTEST_POINTS 1024 // ticks rendered, one FFT record
+#define SELFTEST_BIN 25     // whole cycles in the record, coherent so no window is needed
+#define SELFTEST_AMP 2.5    // volts
+#define SELFTEST_CYCLES 3   // for the 'cycles' case
+
+#define SELFTEST_AMP_TOLERANCE 0.02f    // fundamental against the expected amplitude
+#define SELFTEST_THD_TOLERANCE 0.5f     // dB from the ideal shape
+#define SELFTEST_SINE_THD -50.0f        // dB, at most, the codes carry output2RValue()'s predistortion
+#define SELFTEST_SINE_SFDR 55.0f        // dB, at least
+#define SELFTEST_CORRELATION 0.999f     // differential, at most minus this
+#define SELFTEST_QUADRATURE 0.01f       // Hilbert, magnitude at most
+
+typedef struct _SELFTEST_RESULT
+{
+    bool pass;
+    uint16_t bin;           // fundamental found on OUT A
+    float amplitude;        // fundamental over the expected amplitude
+    float thd;              // dB
+    float thdExpected;      // dB, of the ideal shape over the same harmonics
+    float sfdr;             // dB
+    float correlation;      // OUT A against OUT B, two output cases only
+    uint32_t ticks;         // ticks played, 'cycles' case only
+    uint32_t checksum;      // FNV-1a of the codes under test, compare across builds
+} SELFTEST_RESULT;
+
+uint8_t getSelfTestCount(void);
+char* getSelfTestName(uint8_t test);
+void runSelfTest(uint8_t test, uint16_t* buffer, SELFTEST_RESULT* result);
+
+#endif /* SELFTEST_H_ */
@@ -19,22 +19,24 @@
 #include "cmd.h" // Command line handling
 #include "timer.h" // timer services
 #include "adc0.h"
-
-// Enums
-typedef enum _DAC
-{
-    DAC_A = 1,
-    DAC_B = 2,
-    DAC_INVALID = 3
-} DAC;
-
-typedef enum _WAVE
-{
-	  SINE = 1,
-	SQUARE = 2,
-	   SAW = 3,
-	   TRI = 4
-} WAVE;
+#include "nvic.h"
+#include "macro.h" // EEPROM command macros
+#include "capture.h" // timer triggered ADC capture
+#include "lockin.h" // gain and phase detector
+#include "goertzel.h" // single bin tone analyzer
+#include "cycles.h" // DWT cycle counter
+#include "scope.h" // triggered capture
+#include "fft.h" // spectrum analyzer
+#include "level.h" // closed-loop output level
+#include "decimate.h" // CIC decimation for capture
+#include "meter.h" // background RMS / DC / frequency
+#include "dds.h" // lookup tables and phase accumulators
+#include "bench.h" // hot path timing
+#include "budget.h" // tick timing model
+#include "selftest.h" // rendered waveform checks
+#include "trace.h" // event ring
+#include "load.h" // CPU time per ISR
+#include "state.h" // saved generator settings
 
 // Pins
 #define RED_LED PORTF,1
@@ -53,27 +55,28 @@ typedef enum _WAVE
  *   C A L B I B R A T I O N   *
  *  ========================== */
 
-// DAC Calibration Values
-#define DAC_SLOPE_A 0.000501
-#define DAC_OFFSET_A 0.002917
+// INPUT Calibration Values, volts at the load per ADC code
+// Nominal +/-5 V front end, recalibrate like the OUTPUT values
+#define IN_SLOPE_A 0.002442
+#define IN_OFFSET_A -5.0
 
-#define DAC_SLOPE_B 0.0005
-#define DAC_OFFSET_B 0.000583
+#define IN_SLOPE_B 0.002442
+#define IN_OFFSET_B -5.0
 
-#define DAC_MAX_RVALUE 4095
-#define DAC_MIN_RVALUE 0
+// Interrupt priorities, 0 is highest, the DAC tick never waits on anything
+// UART0 is polled and has no interrupt
+#define TICK_PRIORITY 0     // Timer 4, DDS tick
+                            // CAPTURE_PRIORITY 1 (capture.h), ADC0 SS1 uDMA blocks
+#define LEVEL_PRIORITY 2    // Timer 3, level control task
+#define SAMPLE_PRIORITY 3   // Timer 2, 'sample' printing, blocks on the UART
+#define LOAD_PRIORITY 7     // SysTick, CPU load window
 
-// OUTPUT Calibration Values
-#define OUT_SLOPE_A -5.32148859
-#define OUT_OFFSET_A 5.335339304
-
-#define OUT_SLOPE_B -5.246581272
-#define OUT_OFFSET_B 5.299569261
-
-#define PRECISION_VALUE 4294967296 // 2^32
-
-#define MAX_VPOS 4.4
-#define MAX_VNEG -4.8
+// UART link
+#define UART_DEFAULT_BAUD 115200
+#define BAUD_CONFIRM_US 2000000 // host has 2 s to answer at the new rate
+#define AUTOBAUD_LISTEN_US 100000 // time spent listening at each candidate rate
+#define AUTOBAUD_PASSES 5
+#define AUTOBAUD_DRAIN_MS 1000 // longest the host may keep sending once the rate is found
 
 
 // ||||| D E B U G   D E F I N E |||||
@@ -81,23 +84,30 @@ typedef enum _WAVE
 
 void initHw()
 {
-    initSystemClockTo40Mhz();
+    initSystemClock();
+    
+	// Cycle counter for timing measurements, started first so boot time counts from here
+	initCycleCounter();
 
     enablePort(PORTF);
 
 	// Spi1 for communicating with SPI DAC
 	// Uses pins D0-D1 and D3 (SPI RX ununsed)
     initSpi1(USE_SSI_FSS); // Port D in enabled in here
-    setSpi1BaudRate(20e6, 40e6);
+    setSpi1BaudRate(20e6, SYSTEM_CLOCK_HZ);
     setSpi1Mode(0,0);
 
 	// UART for debugging and extra info
     initUart0();
-    setUart0BaudRate(115200, 40e6);
+    setUart0BaudRate(UART_DEFAULT_BAUD, SYSTEM_CLOCK_HZ);
 	
 	// Timer Services for writing out to LUTs
-	initTimer();
-	initTimer2();
+	initTimer(SYSTEM_CLOCK_HZ);
+	initTimer2(SYSTEM_CLOCK_HZ);
+	initTimer3(LEVEL_RATE, SYSTEM_CLOCK_HZ); // level control task
+	setNvicInterruptPriority(INT_TIMER4A, TICK_PRIORITY);
+	setNvicInterruptPriority(INT_TIMER3A, LEVEL_PRIORITY);
+	setNvicInterruptPriority(INT_TIMER2A, SAMPLE_PRIORITY);
 	
 	// ADC library for reading in signals
 	enablePort(PORTE);
@@ -108,9 +118,20 @@ void initHw()
 	setPinAuxFunction(ADC_IN1, GPIO_PCTL_PE4_AIN9);
 	setPinAuxFunction(ADC_IN2, GPIO_PCTL_PE5_AIN8);
 	initAdc0Ss2_3();
-	setAdc0Ss2_3Log2AverageCount(2); // 16 samples == shown value
+	setAdc0Ss2_3Log2AverageCount(0); // full rate, filtering is done by decimation
+	setAdc0Dither(true);
 	setAdc0Ss3Mux(9); // PE4, IN1
 	setAdc0Ss2Mux(8); // PE5, IN2
+	initCapture(); // SS1 + Timer 1 + uDMA, both inputs in one sequence
+	
+	initFft();
+	
+	// SysTick closes a CPU load slot every LOAD_PERIOD_MS
+	NVIC_ST_CTRL_R = 0;
+	NVIC_ST_RELOAD_R = SYSTEM_CLOCK_HZ / 1000 * LOAD_PERIOD_MS - 1;
+	NVIC_ST_CURRENT_R = 0;
+	NVIC_SYS_PRI3_R = (NVIC_SYS_PRI3_R & ~NVIC_SYS_PRI3_TICK_M) | (LOAD_PRIORITY << NVIC_SYS_PRI3_TICK_S);
+	NVIC_ST_CTRL_R = NVIC_ST_CTRL_CLK_SRC | NVIC_ST_CTRL_INTEN | NVIC_ST_CTRL_ENABLE;
 
 	// LDAC pin for latching the SPI DAC 
     selectPinPushPullOutput(SPI_LDAC);
@@ -127,6 +148,7 @@ void initHw()
 // ==============================
 
 // Takes values from SPI buffer and latches it
+#pragma CODE_SECTION(latchDAC, ".TI.ramfunc")
 void latchDAC()
 {
     setPinValue(SPI_LDAC, 0);
@@ -186,60 +208,11 @@ bool selectDACVoltage(DAC select, float voltage)
     return wrote2Spi;
 }
 
-#define X5_A -0.000149548
-#define X4_A -0.000278675
-#define X3_A 0.002751298
-#define X2_A 0
-#define X1_A -0.197731281
-#define X0_A 1.002577993
-
-#define X5_B -0.000293044
-#define X4_B -0.000891307
-#define X3_B 0.007338118
-#define X2_B 0x0
-#define X1_B -0.235113482
-#define X0_B 0.879180291
-
-uint16_t output2RValue(DAC select, float voltage)
-{
-	float dacVoltage = 0;
-	uint16_t r_value = 0;
-	
-	// caps the requested voltage based on limits
-	if(voltage > MAX_VPOS)
-		voltage = MAX_VPOS;
-	if(voltage < MAX_VNEG)
-		voltage = MAX_VNEG;
-	
-	switch(select)
-	{
-	case DAC_A:
-		//dacVoltage = pow(voltage, 5) * X5_A + pow(voltage, 4) * X4_A + pow(voltage, 3) * X3_A + pow(voltage, 2) * X2_A + voltage * X1_A + X0_A;
-		dacVoltage = (voltage - OUT_OFFSET_A) / OUT_SLOPE_A;
-		
-		if(dacVoltage >= 0 && dacVoltage <= DAC_OFFSET_A)
-            dacVoltage = DAC_OFFSET_A;
-		
-		r_value = (dacVoltage - DAC_OFFSET_A) / DAC_SLOPE_A;
-		break;
-	case DAC_B:
-		//dacVoltage = pow(voltage, 5) * X5_B + pow(voltage, 4) * X4_B + pow(voltage, 3) * X3_B + pow(voltage, 2) * X2_B + voltage * X1_B + X0_B;
-		dacVoltage = (voltage - OUT_OFFSET_B) / OUT_SLOPE_B;
-		
-		if(dacVoltage >= 0 && dacVoltage <= DAC_OFFSET_B)
-            dacVoltage = DAC_OFFSET_B;
-		r_value = (dacVoltage - DAC_OFFSET_B) / DAC_SLOPE_B;
-		break;
-	default:
-		break;
-	}
-	
-	return r_value;
-}
-
 bool selectOutputVoltage(DAC select, float voltage)
 {
+#ifdef DEBUG
 	float dacVoltage = -1;
+#endif
     uint16_t r_value = 0;
 	bool wrote2Spi = false;
     switch(select)
@@ -272,218 +245,450 @@ bool selectOutputVoltage(DAC select, float voltage)
 	return wrote2Spi;
 }
 
+ /* ======================================= *
+  *               UART LINK                 *
+  * ======================================= */
+
+// Standard rates tried by auto-baud, 2.5M and 3M use the UART high-speed divisor
+const uint32_t baudRates[] =
+{
+    9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600,
+    1000000, 1500000, 2000000, 2500000, 3000000
+};
+#define BAUD_RATE_COUNT (sizeof(baudRates) / sizeof(baudRates[0]))
+
+uint32_t uartBaud = UART_DEFAULT_BAUD;
+
+// Switches to newBaud, then waits for the host to send 'y' at the new rate
+// Falls back to the old rate if nothing valid arrives so the session is never lost
+bool changeBaud(uint32_t newBaud)
+{
+    int16_t c;
+
+    if(newBaud == 0 || newBaud > SYSTEM_CLOCK_HZ / 8)
+    {
+        putsUart0("ERROR: Baud rate out of range.\n");
+        return false;
+    }
+
+    putsUart0("Switching to ");
+    putuUart0(newBaud);
+    putsUart0(" baud, send 'y' at the new rate to confirm.\n");
+    flushUart0();
+
+    setUart0BaudRate(newBaud, SYSTEM_CLOCK_HZ);
+    clearUart0();
+    c = getcUart0Timeout(BAUD_CONFIRM_US);
+
+    if(c == 'y' || c == 'Y')
+    {
+        uartBaud = newBaud;
+        putsUart0("Baud set.\n");
+        return true;
+    }
+
+    setUart0BaudRate(uartBaud, SYSTEM_CLOCK_HZ);
+    clearUart0();
+    putsUart0("Baud change not confirmed, staying at ");
+    putuUart0(uartBaud);
+    putsUart0(" baud.\n");
+    return false;
+}
+
+// Steps through baudRates until two clean 'U' (0x55) characters are received in a row
+// 'U' alternates every bit, so a wrong rate shows up as a framing error or another value
+bool autoBaud()
+{
+    uint32_t drained, limit;
+    uint8_t pass, i;
+    int16_t c;
+
+    putsUart0("Auto-baud: send 'U' repeatedly at the new rate.\n");
+    flushUart0();
+
+    for(pass = 0; pass < AUTOBAUD_PASSES; pass++)
+    {
+        for(i = 0; i < BAUD_RATE_COUNT; i++)
+        {
+            setUart0BaudRate(baudRates[i], SYSTEM_CLOCK_HZ);
+            clearUart0();
+            if(getcUart0Timeout(AUTOBAUD_LISTEN_US) != 'U')
+                continue;
+            c = getcUart0Timeout(AUTOBAUD_LISTEN_US);
+            if(c == 'U')
+            {
+                // let the host stop sending before answering, at most AUTOBAUD_DRAIN_MS
+                // of characters (10 bits each) so a stuck sender cannot hold the shell
+                limit = baudRates[i] / 10 * AUTOBAUD_DRAIN_MS / 1000;
+                for(drained = 0; drained <= limit && getcUart0Timeout(AUTOBAUD_LISTEN_US) != -1; drained++);
+                if(drained > limit)
+                {
+                    setUart0BaudRate(uartBaud, SYSTEM_CLOCK_HZ);
+                    clearUart0();
+                    putsUart0("Auto-baud failed, the host kept sending; staying at ");
+                    putuUart0(uartBaud);
+                    putsUart0(" baud.\n");
+                    return false;
+                }
+                uartBaud = baudRates[i];
+                putsUart0("Baud locked at ");
+                putuUart0(uartBaud);
+                putsUart0(".\n");
+                return true;
+            }
+        }
+    }
+
+    setUart0BaudRate(uartBaud, SYSTEM_CLOCK_HZ);
+    clearUart0();
+    putsUart0("Auto-baud failed, staying at ");
+    putuUart0(uartBaud);
+    putsUart0(" baud.\n");
+    return false;
+}
+
  /* ======================================= *
   *              LUT PROCESSING             *
   * ======================================= */
 
-#define LUT_SIZE (uint32_t)2048
-uint32_t lut_i_A = 0; // current lut index
-uint32_t lut_i_B = 0;
-uint32_t currentCycles_A = 0;
-uint32_t currentCycles_B = 0;
-int32_t maxCycles_A = -1; // defaults to -1 == continuous
-int32_t maxCycles_B = -1;
-uint32_t phaseAccum_A = 0; // delta phase, how much to add to i
-uint32_t phaseAccum_B = 0;
-uint16_t lutA[LUT_SIZE] = {0};
-uint16_t lutB[LUT_SIZE] = {0};
-bool outA_EN = false;
-bool outB_EN = false;
-
-// Optional Flags
-bool differentialEN = false;
-bool hilbertEN = false;
-
-void calculateWave(WAVE type, DAC select, float amp, float ofs, uint8_t dutyCycle)
-{
-	//ofs = 0;
-	//amp = 1;
-	uint16_t i;
-	float y;
-	float squarePercent = (float)dutyCycle / 100;
-	// gain should be bits/voltage * amp voltage I want
+volatile uint32_t tickCount = 0; // Timer4 ticks since reset, paces macro 'wait'
+volatile uint32_t tickCycles = 0; // DWT clocks of the last tickIsr() body
+volatile uint32_t tickMaxCycles = 0; // longest body since 'headroom' last read it
+volatile uint32_t tickMinLatency = 0xFFFFFFFF; // clocks from the Timer4 timeout to tickIsr(),
+volatile uint32_t tickMaxLatency = 0; // their spread is the output jitter
+LOAD load; // CPU time per ISR, sampled by loadIsr()
+
+// Level control, trims applied in tickIsr() while levelEN
+LEVEL levelA;
+LEVEL levelB;
+bool levelEN = false;
+volatile uint16_t playedCode_A = 0; // untrimmed code on each DAC
+volatile uint16_t playedCode_B = 0;
+
+/* ======================================= *
+ *          STAGED CONFIGURATION           *
+ * ======================================= */
+
+// Settings collected between 'begin' and 'commit'
+typedef struct _STAGED_CONFIG
+{
+    uint32_t phaseAccum_A;
+    uint32_t phaseAccum_B;
+    int32_t maxCycles_A;
+    int32_t maxCycles_B;
+    bool outA_EN;
+    bool outB_EN;
+} STAGED_CONFIG;
+
+STAGED_CONFIG staged;
+volatile bool commitPending = false;
+uint32_t commitStart = 0; // CYCLE_COUNT when 'commit' handed over
+uint32_t commitLatency = 0; // clocks from 'commit' to the tick that applied it, measured
+
+void setPhaseAccum(DAC select, uint32_t value)
+{
+    if(select == DAC_A)
+    {
+        if(stagedEN)
+            staged.phaseAccum_A = value;
+        else
+            phaseAccum_A = value;
+    }
+    else if(select == DAC_B)
+    {
+        if(stagedEN)
+            staged.phaseAccum_B = value;
+        else
+            phaseAccum_B = value;
+    }
+}
+
+uint32_t getPhaseAccum(DAC select)
+{
+    if(select == DAC_A)
+        return stagedEN ? staged.phaseAccum_A : phaseAccum_A;
+    else
+        return stagedEN ? staged.phaseAccum_B : phaseAccum_B;
+}
+
+void setMaxCycles(DAC select, int32_t value)
+{
+    if(select == DAC_A)
+    {
+        if(stagedEN)
+            staged.maxCycles_A = value;
+        else
+            maxCycles_A = value;
+    }
+    else if(select == DAC_B)
+    {
+        if(stagedEN)
+            staged.maxCycles_B = value;
+        else
+            maxCycles_B = value;
+    }
+}
+
+// Starts staging: edits go to the idle tables, which start as a copy of what is playing
+// Staging holds the tables, phase steps and cycle limits. 'run', 'stop', '<shape> stop',
+// 'differential' and 'hilbert' act on the playing outputs at once, so the shell refuses
+// them until 'commit' or 'abort' rather than let them bypass the staged swap
+void beginStaged()
+{
+    uint16_t i;
+
+    lutA_edit = (lutA == lutA_0) ? lutA_1 : lutA_0;
+    lutB_edit = (lutB == lutB_0) ? lutB_1 : lutB_0;
+    for(i = 0; i < LUT_SIZE; i++)
+    {
+        lutA_edit[i] = lutA[i];
+        lutB_edit[i] = lutB[i];
+    }
+    *getWaveParams(lutA_edit) = *getWaveParams(lutA);
+    *getWaveParams(lutB_edit) = *getWaveParams(lutB);
+
+    staged.phaseAccum_A = phaseAccum_A;
+    staged.phaseAccum_B = phaseAccum_B;
+    staged.maxCycles_A = maxCycles_A;
+    staged.maxCycles_B = maxCycles_B;
+    staged.outA_EN = outA_EN;
+    staged.outB_EN = outB_EN;
+    stagedEN = true;
+}
+
+// Drops staged edits and goes back to editing the playing tables
+void abortStaged()
+{
+    stagedEN = false;
+    lutA_edit = lutA;
+    lutB_edit = lutB;
+}
+
+// Called from tickIsr(), swaps tables and loads every staged setting in the same tick
+// Both phases restart at 0 so channel A and B keep a fixed relationship
+static inline void applyStaged()
+{
+    lutA = lutA_edit;
+    lutB = lutB_edit;
+    phaseAccum_A = staged.phaseAccum_A;
+    phaseAccum_B = staged.phaseAccum_B;
+    maxCycles_A = staged.maxCycles_A;
+    maxCycles_B = staged.maxCycles_B;
+    lut_i_A = 0;
+    lut_i_B = 0;
+    currentCycles_A = 0;
+    currentCycles_B = 0;
+    outA_EN = staged.outA_EN;
+    outB_EN = staged.outB_EN;
+    stagedEN = false;
+    commitLatency = CYCLE_COUNT - commitStart;
+    commitPending = false;
+    traceEvent(TRACE_SWAP, 0);
+}
+
+// Hands the staged settings to the next tick, returns once they are playing
+void commitStaged()
+{
+    // a stopped timer starts a full period from here
+    if(!(TIMER4_CTL_R & TIMER_CTL_TAEN))
+        TIMER4_TAV_R = TIMER4_TAILR_R;
+    commitStart = CYCLE_COUNT;
+    commitPending = true;
+    TIMER4_CTL_R |= TIMER_CTL_TAEN;
+    while(commitPending);
+}
+
+void testAdc()
+{
 	
-	//if(select == DAC_A)
-	outA_EN = false;
-	//if(select == DAC_B)
-	outB_EN = false;
+}
+
+#define GAIN_POINTS 21
+#define LOCKIN_CYCLES 8 // signal cycles integrated per point, coherent so no leakage
+#define LOCKIN_SAMPLES_PER_CYCLE 16 // capture rate target, limited by the ADC
+
+// Bode defaults, dwell grows with frequency so every point integrates at least BODE_MIN_DWELL
+#define BODE_SETTLE_CYCLES 2
+#define BODE_MIN_CYCLES 4
+#define BODE_MIN_DWELL 0.005 // s
+#define BODE_MAX_CYCLES 2000
+#define BODE_FRAME_SYNC 0xA5
+
+float dbArray[GAIN_POINTS];
+float phaseArray[GAIN_POINTS];
+bool bodeBinary = false;
+
+/*  =============================== *
+ *  ||||||| C O H E R E N T ||||||| *
+ *  =============================== */
+
+#define COHERENT_SAMPLES_PER_CYCLE 8 // minimum, sets the DDS ticks per sample
+#define COHERENT_MAX_TICKS 32768
+
+// Sample pairs every 2^k DDS ticks over a 2^n tick record, so a tone on the
+// record's bin grid has an exact DDS phase step and a whole number of cycles
+typedef struct _COHERENT_PLAN
+{
+	uint16_t ticks;     // DDS ticks per sample pair
+	uint32_t pairs;     // sample pairs in the record
+	uint32_t cycles;    // tone cycles in the record
+	uint32_t step;      // DDS phase step of the tone
+	float freq;         // tone actually played
+} COHERENT_PLAN;
+
+// Phase locked capture, started by tickIsr()
+volatile bool lockPending = false;
+uint32_t lockPhase = 0;     // DDS A index played on the tick that started Timer 1
+uint16_t lockTicks = 1;
+uint16_t lockDecimation = 1;
+
+float getTickRate()
+{
+	return (float)SYSTEM_CLOCK_HZ / (TIMER4_TAILR_R + 1);
+}
+
+// Snaps freq to the nearest tone with at least cycles whole cycles in the record
+void planCoherent(float freq, uint16_t cycles, COHERENT_PLAN* plan)
+{
+	float tickRate = getTickRate();
+	uint8_t bits;
 	
-	if(select == DAC_B && differentialEN)
-	{
-		putsUart0("ERROR: Differential is on, cannot change DAC_B!\n");
-		return;
-	}
-	if(select == DAC_B && hilbertEN)
-	{
-		putsUart0("ERROR: Hilbert is on, cannot change DAC_B!\n");
-		return;
-	}
-	switch(type)
-	{
-	case SINE:
-		for(i = 0; i < LUT_SIZE; i++)
-		{
-			y = ( 2 * M_PI )*((float)i/(float)LUT_SIZE);
-			if(select == DAC_A)
-			{
-				lutA[i] = output2RValue(select, ofs + (amp * sin(y)));
-				if(differentialEN)
-					lutB[i] = output2RValue( DAC_B, -1*( ofs + (amp * sin(y)) ) );
-				else if(hilbertEN)
-					lutB[i] = output2RValue( DAC_B, -1*( ofs + (amp * cos(y)) ) );
-			}
-			else if(select == DAC_B)
-				lutB[i] = output2RValue(select, ofs + (amp * sin(y)));
-		}
-		break;
-	case SQUARE:
-		for(i = 0; i < LUT_SIZE; i++)
-		{
-			if(select == DAC_A)
-			{
-				if( i <= (LUT_SIZE * squarePercent) )
-				{
-					lutA[i] = output2RValue(select, ofs + amp);
-					if(differentialEN)
-						lutB[i] = output2RValue(DAC_B, ofs - amp);
-				}
-				else if( i > (LUT_SIZE * squarePercent) )
-				{
-					lutA[i] = output2RValue(select, ofs - amp);
-					if(differentialEN)
-						lutB[i] = output2RValue(DAC_B, ofs + amp);
-				}
-			}
-			else if(select == DAC_B)
-			{
-				if( i <= (LUT_SIZE * squarePercent) )
-					lutB[i] = output2RValue(select, ofs + amp);
-				else if( i > (LUT_SIZE * squarePercent) )
-					lutB[i] = output2RValue(select, ofs - amp);
-			}
-		}
-		break;
-	case SAW:
-	// start at (ofs - amp) end at (ofs + amp)
-		for(i = 0; i < LUT_SIZE; i++)
-		{
-			// y = b + mx | m = 2*amp, x = i/LUT_SIZE-1
-			y = (ofs-amp) + (2.0*amp)*(float)i/((float)LUT_SIZE-1.0);
-			
-			if(select == DAC_A)
-			{
-				lutA[i] = output2RValue(select, y);
-				if(differentialEN)
-					lutB[i] = output2RValue(DAC_B, -1.0 * y);
-			}
-			
-			else if(select == DAC_B)
-				lutB[i] = output2RValue(select, y);
-		}
-		break;
-	case TRI:
-		for(i = 0; i < LUT_SIZE; i++)
-		{
-			if(select == DAC_A)
-			{
-				if( i / (LUT_SIZE/2) == 0)
-				{
-					y = (ofs-amp) + (2.0*amp) * (float)i / (((float)LUT_SIZE-1.0)/2.0);
-					lutA[i] = output2RValue(select, y);
-					if(differentialEN)
-						lutB[i] = output2RValue(DAC_B, -1.0 * y);
-				}
-				else if( i / (LUT_SIZE/2) == 1)
-				{
-					y = (ofs+amp) - (2.0*amp) * (((float)i) - ((float)LUT_SIZE/2)) / (((float)LUT_SIZE-1.0)/2.0);
-					lutA[i] = output2RValue(select, y);
-					if(differentialEN)
-						lutB[i] = output2RValue(DAC_B, -1.0 * y);
-				}
-			}
-			else if(select == DAC_B)
-			{
-				if( i / (LUT_SIZE/2) == 0)
-				{
-					y = (ofs-amp) + (2.0*amp) * (float)i / (((float)LUT_SIZE-1.0)/2.0);
-					lutB[i] = output2RValue(select, y);
-				}
-				else if( i / (LUT_SIZE/2) == 1)
-				{
-					y = (ofs+amp) - (2.0*amp) * (((float)i) - ((float)LUT_SIZE/2)) / (((float)LUT_SIZE-1.0)/2.0);
-					lutB[i] = output2RValue(select, y);
-				}
-			}
-		}
-		break;
-	default:
-		putsUart0("ERROR: Invalid waveform type.\n");
-	}
+	plan->ticks = 1;
+	while(plan->ticks < COHERENT_MAX_TICKS && tickRate / (2 * plan->ticks) >= COHERENT_SAMPLES_PER_CYCLE * freq)
+		plan->ticks *= 2;
+	plan->pairs = 1;
+	while(plan->pairs < cycles * tickRate / (plan->ticks * freq)
+	      && ((uint64_t)plan->ticks * plan->pairs) < (1UL << DDS_PHASE_BITS))
+		plan->pairs *= 2;
 	
-	/* if(select == DAC_A)
-		outA_EN = true;
-	if(select == DAC_B || differentialEN)
-		outB_EN = true; */
+	for(bits = 0; (1UL << bits) < (uint32_t)plan->ticks * plan->pairs; bits++);
+	plan->cycles = freq * (1UL << bits) / tickRate + 0.5f;
+	if(plan->cycles == 0)
+		plan->cycles = 1;
+	plan->step = plan->cycles << (DDS_PHASE_BITS - bits);
+	plan->freq = plan->cycles * tickRate / (1UL << bits);
+}
+
+// Captures a pair every plan->ticks DDS ticks, Timer 1 is started by tickIsr()
+// right after a DAC update so every sample sees a known DDS phase
+// Decimation is suspended, it would smear samples across ticks
+// Fails if the capture can't be armed or no tick picks it up in time
+bool startCoherentCapture(COHERENT_PLAN* plan)
+{
+	uint32_t start, timeout = (TIMER4_TAILR_R + 1) + CAPTURE_TIMEOUT_MS * (SYSTEM_CLOCK_HZ / 1000);
 	
-#ifdef DEBUG
-	char buffer[100];
-	for(i = 0; i < LUT_SIZE; i++)
+	lockTicks = plan->ticks;
+	lockDecimation = getCaptureDecimation();
+	setCaptureDecimation(1);
+	if(!armLockedCapture((uint32_t)plan->ticks * (TIMER4_TAILR_R + 1)))
 	{
-	    sprintf(buffer, "%u\t%u\n", lutA[i], lutB[i] );
-	    putsUart0(buffer);
+		setCaptureDecimation(lockDecimation);
+		return false;
 	}
-#endif
-	
+	start = CYCLE_COUNT;
+	lockPending = true;
+	while(lockPending && CYCLE_COUNT - start < timeout);
+	if(lockPending)
+	{
+		lockPending = false;
+		stopCapture();
+		setCaptureDecimation(lockDecimation);
+		return false;
+	}
+	return true;
 }
 
-void testAdc()
+void stopCoherentCapture()
 {
-	
+	stopCapture();
+	setCaptureDecimation(lockDecimation);
 }
 
-#define INTEGER_BITS 16
-#define FRACTIONAL_BITS 32-INTEGER_BITS
-uint32_t float2uint(float input)
+// DDS A phase (2^DDS_PHASE_BITS per cycle) when sample pair n was taken
+uint32_t getCoherentPhase(uint32_t n)
 {
-	uint8_t i;
-	uint32_t returnValue = 0;
+	return (lockPhase + (n + 1) * lockTicks * phaseAccum_A) & ((1UL << DDS_PHASE_BITS) - 1);
+}
+
+// Plays a phase step on both DACs continuously, both starting from phase 0
+void playSweepTone(uint32_t step)
+{
+	outA_EN = outB_EN = false;
+	phaseAccum_A = step;
+	phaseAccum_B = phaseAccum_A;
+	maxCycles_A = maxCycles_B = -1;
+	currentCycles_A = 0;
+	currentCycles_B = 0;
+	lut_i_A = 0;
+	lut_i_B = 0;
+	outA_EN = outB_EN = true;
+}
+
+// Measures one point with the lock-in detector, both DACs play freq snapped
+// to a coherent tone, which is written back to freq
+// Waits settle cycles first, then integrates at least cycles whole cycles
+// Gain and phase are IN2 relative to IN1, returns false if no capture data arrived
+bool measurePoint(float* freq, uint16_t settle, uint16_t cycles, float* db, float* phase)
+{
+	COHERENT_PLAN plan;
+	LOCKIN lockin;
+	uint16_t* block;
+	float amp1, amp2, phase1, phase2;
 	
-	uint16_t intValue = (uint32_t)input / 1;
-	returnValue = intValue << INTEGER_BITS;
-	input -= intValue;
-	float calcValue;
+	planCoherent(*freq, cycles, &plan);
+	*freq = plan.freq;
+	playSweepTone(plan.step);
+	waitMicrosecond(settle * 1e6 / plan.freq);
 	
-	for(i = INTEGER_BITS; i > 0; i--)
+	// no leakage to average out, the record holds exactly plan.cycles cycles
+	if(!startCoherentCapture(&plan))
+		return false;
+	startLockinPhase(&lockin, getCoherentPhase(0) << (32 - DDS_PHASE_BITS),
+	                 (plan.ticks * plan.step) << (32 - DDS_PHASE_BITS), plan.pairs);
+	do
 	{
-	    calcValue = input - (float)1/(2 << (INTEGER_BITS-i));
-		if( calcValue > 0 )
+		if((block = waitCaptureBlock()) == 0)
 		{
-		    returnValue |= (1 << i-1);
-		    input = calcValue;
+			stopCoherentCapture();
+			return false;
 		}
-
-	}
+	} while(!updateLockin(&lockin, block, CAPTURE_PAIRS));
+	stopCoherentCapture();
+	
+	getLockinResult(&lockin, 0, &amp1, &phase1);
+	getLockinResult(&lockin, 1, &amp2, &phase2);
 	
-	return returnValue;
+	*db = 20 * log10f(amp2 / amp1);
+	*phase = phase2 - phase1;
+	if(*phase > 180)
+		*phase -= 360;
+	else if(*phase < -180)
+		*phase += 360;
+	return true;
 }
 
-float dbArray[20];
+// Renders the sweep sine on OUT A and gives OUT B the same table, through the
+// edit tables like any other table change so 'save' sees what B plays
+void renderSweepTables(uint8_t dutyCycle)
+{
+	uint16_t i;
+	
+	calculateWave(SINE, DAC_A, 2, 0, dutyCycle);
+	for(i = 0; i < LUT_SIZE; i++)
+		lutB_edit[i] = lutA_edit[i];
+	*getWaveParams(lutB_edit) = *getWaveParams(lutA_edit);
+}
 
 void freqSweep(float freqFrom, float freqTo)
 {
-	float freq_ref = (((float)40e6 / (float)TIMER4_TAILR_R)) * (1.0 / (float)LUT_SIZE);
-	float freqTable[21];
+	float freqTable[GAIN_POINTS];
 	float decades = log10(freqTo / freqFrom);
-	float steps = 20.0 / decades;
+	float steps = (GAIN_POINTS - 1) / decades;
 	float stepSize = pow(10, (1/steps)) - 1;
 	
-	uint32_t rawA = 0, rawB = 0;
 	uint8_t i;
-	uint16_t counter;
-	
-	char buffer[50];
 	
-	for(i = 0; i < 20; i++)
+	for(i = 0; i < GAIN_POINTS - 1; i++)
 	{
 		//freqTable[i] = (freqFrom + freqFrom * stepSize * i);
 		freqTable[i] = freqFrom;
@@ -491,73 +696,311 @@ void freqSweep(float freqFrom, float freqTo)
 	}
 	freqTable[i] = freqTo;
 	
-	for(i = 0; i < 21; i++)
+	for(i = 0; i < GAIN_POINTS; i++)
 	{
-		phaseAccum_A = float2uint(freqTable[i] / freq_ref);
-		phaseAccum_B = phaseAccum_A;
-		
-		maxCycles_A = maxCycles_B = 200;
-		
-		currentCycles_A = 0;
-		currentCycles_B = 0;
-		lut_i_A = 0;
-		lut_i_B = 0;
-		outA_EN = outB_EN = true;
-		while(outA_EN || outB_EN)
+		if(!measurePoint(&freqTable[i], 1, LOCKIN_CYCLES, &dbArray[i], &phaseArray[i]))
+		{
+			outA_EN = outB_EN = false;
+			putsUart0("ERROR: No capture data arrived.\n");
+			return;
+		}
+	}
+	outA_EN = outB_EN = false;
+	
+	putsUart0("Freq\tdB\tDeg\n");
+	for(i = 0; i < GAIN_POINTS; i++)
+	{
+		putFloatUart0(freqTable[i], 3);
+		putcUart0('\t');
+		putFloatUart0(dbArray[i], 3);
+		putcUart0('\t');
+		putFloatUart0(phaseArray[i], 1);
+		putcUart0('\n');
+	}
+}
+
+// Sends one bode point as soon as it is measured
+// Binary frame: sync, uint16 index, float freq, float dB, float degrees, 8-bit sum of the previous bytes
+void streamBodePoint(uint16_t index, float freq, float db, float phase)
+{
+	uint8_t frame[16];
+	uint8_t sum = 0;
+	uint8_t i;
+	
+	if(!bodeBinary)
+	{
+		putFloatUart0(freq, 3);
+		putcUart0(',');
+		putFloatUart0(db, 3);
+		putcUart0(',');
+		putFloatUart0(phase, 2);
+		putcUart0('\n');
+		return;
+	}
+	
+	frame[0] = BODE_FRAME_SYNC;
+	frame[1] = index & 0xFF;
+	frame[2] = index >> 8;
+	memcpy(&frame[3], &freq, 4);
+	memcpy(&frame[7], &db, 4);
+	memcpy(&frame[11], &phase, 4);
+	for(i = 0; i < 15; i++)
+		sum += frame[i];
+	frame[15] = sum;
+	putBufferUart0(frame, sizeof(frame));
+}
+
+// Log sweep from freqFrom to freqTo, any received character aborts between points
+// cycles is the minimum per point, raised so each point lasts at least BODE_MIN_DWELL
+void bodeSweep(float freqFrom, float freqTo, uint16_t pointsPerDecade, uint16_t settle, uint16_t cycles)
+{
+	float step = powf(10, 1.0f / pointsPerDecade);
+	float freq = freqFrom;
+	float db, phase, dwellCycles, played;
+	uint16_t index = 0;
+	bool last = false;
+	
+	clearUart0();
+	if(!bodeBinary)
+		putsUart0("freq,db,deg\n");
+	
+	while(!last)
+	{
+		if(freq >= freqTo * 0.9999f)
 		{
-			rawA += readAdc0Ss2();
-			rawB += readAdc0Ss3();
-			counter++;
+			freq = freqTo;
+			last = true;
 		}
-		//waitMicrosecond(3000000);
-		outA_EN = false;
-		outB_EN = false;
 		
-		rawA /= counter;
-		rawB /= counter;
+		dwellCycles = freq * BODE_MIN_DWELL;
+		if(dwellCycles < cycles)
+			dwellCycles = cycles;
+		if(dwellCycles > BODE_MAX_CYCLES)
+			dwellCycles = BODE_MAX_CYCLES;
 		
-		//sprintf(buffer, "A: %d\tB: %d\n", rawA, rawB);
-		putsUart0(buffer);	
+		played = freq;
+		if(!measurePoint(&played, settle, (uint16_t)dwellCycles, &db, &phase))
+		{
+			putsUart0("ERROR: No capture data arrived.\n");
+			break;
+		}
+		streamBodePoint(index++, played, db, phase);
 		
-		dbArray[i] = 20 * log10((float)rawA / (float)rawB);
+		if(kbhitUart0())
+		{
+			clearUart0();
+			if(!bodeBinary)
+				putsUart0("aborted\n");
+			break;
+		}
+		freq *= step;
 	}
 	outA_EN = outB_EN = false;
+}
+
+#define TONE_CYCLES 10 // cycles of the lowest tone analyzed
+
+// Captures both inputs and reports amplitude and phase at each requested frequency
+// Also reports the Goertzel cost in core cycles per sample pair
+void toneAnalyze(float* freqs, uint8_t bins)
+{
+	GOERTZEL goertzel;
+	uint16_t* block;
+	uint32_t rate, samples, start;
+	uint32_t cycles = 0;
+	float low = freqs[0], high = freqs[0];
+	float amp, phase;
+	bool done;
+	uint8_t b, n;
 	
+	for(b = 1; b < bins; b++)
+	{
+		if(freqs[b] < low)
+			low = freqs[b];
+		if(freqs[b] > high)
+			high = freqs[b];
+	}
 	
+	rate = high * LOCKIN_SAMPLES_PER_CYCLE;
+	if(rate > getCaptureMaxRate())
+		rate = getCaptureMaxRate();
+	if(rate == 0)
+		rate = 1;
+	startCapture(rate);
 	
-	for(i = 0; i < 21; i++)
+	// a capped rate can leave the highest bins at or past Nyquist
+	if(high >= getCaptureRate() / 2)
 	{
-		sprintf(buffer, "%f\n", freqTable[i]);
-		putsUart0(buffer);
+		stopCapture();
+		putsUart0("ERROR: Tones must be below ");
+		putuUart0(getCaptureRate() / 2);
+		putsUart0(" Hz.\n");
+		return;
 	}
-	for(i = 0; i < 21; i++)
+	
+	samples = TONE_CYCLES * getCaptureRate() / low;
+	if(samples > GOERTZEL_MAX_SAMPLES)
+		samples = GOERTZEL_MAX_SAMPLES;
+	startGoertzel(&goertzel, freqs, bins, getCaptureRate(), samples, getCaptureShift());
+	
+	do
 	{
-		sprintf(buffer, "%f\n", dbArray[i]);
-		putsUart0(buffer);
+		if((block = waitCaptureBlock()) == 0)
+		{
+			stopCapture();
+			putsUart0("ERROR: No capture data arrived.\n");
+			return;
+		}
+		start = CYCLE_COUNT;
+		done = updateGoertzel(&goertzel, block, CAPTURE_PAIRS);
+		cycles += CYCLE_COUNT - start;
+	} while(!done);
+	stopCapture();
+	
+	for(b = 0; b < bins; b++)
+	{
+		putEngUart0(freqs[b], 3);
+		putsUart0("Hz");
+		for(n = 0; n < 2; n++)
+		{
+			getGoertzelResult(&goertzel, n, b, &amp, &phase);
+			putsUart0(n == 0 ? "\tIN1: " : "\tIN2: ");
+			putFloatUart0(amp * 3.3 / 4095.0, 4);
+			putsUart0(" V ");
+			putFloatUart0(phase, 1);
+			putsUart0(" deg");
+		}
+		putcUart0('\n');
 	}
+	putsUart0("Samples: ");
+	putuUart0(goertzel.count);
+	putsUart0(" at ");
+	putuUart0(getCaptureRate());
+	putsUart0(" Hz, ");
+	putFloatUart0((float)cycles / goertzel.count, 1);
+	putsUart0(" cycles/pair\n");
 }
 
-void tickIsr()
+/*  =============================== *
+ *  ||||||| S P E C T R U M ||||||| *
+ *  =============================== */
+
+#define SPECTRUM_DEFAULT_POINTS 1024
+#define SPECTRUM_DEFAULT_PEAKS 4
+
+// Last transform, left in scopeBuffer for 'spectrum bins'
+bool spectrumWindow = true;
+bool spectrumValid = false;
+uint16_t spectrumPoints;
+uint8_t spectrumInput;
+
+static void putDbUart0(float ratio)
+{
+	putFloatUart0(10 * log10f(ratio), 1);
+	putsUart0(" dB");
+}
+
+// Captures POINTS pairs at RATE, transforms both inputs at once and reports INPUT
+bool spectrumAnalyze(uint32_t rate, uint16_t points, uint8_t input, uint8_t peaks)
 {
-	// for looping the wave
-	if((lut_i_A >> INTEGER_BITS) >= LUT_SIZE)
+	SPECTRUM result;
+	uint32_t start, cycles;
+	float binWidth;
+	uint8_t p;
+	
+	if(points < FFT_MIN_POINTS || points > FFT_MAX_POINTS || (points & (points - 1)) != 0)
+		return false;
+	if(!runScope(rate, points, 0))
+		return false;
+	
+	start = CYCLE_COUNT;
+	prepareFft(scopeBuffer, points, spectrumWindow, getCaptureShift());
+	fftQ15((int16_t*)scopeBuffer, points);
+	cycles = CYCLE_COUNT - start;
+	
+	spectrumValid = true;
+	spectrumPoints = points;
+	spectrumInput = input;
+	
+	analyzeSpectrum((int16_t*)scopeBuffer, points, input, peaks, &result);
+	binWidth = (float)getCaptureRate() / points;
+	
+	putsUart0("Fundamental: ");
+	putEngUart0(result.fundamental * binWidth, 3);
+	putsUart0("Hz ");
+	putDbUart0(2 * result.fundamentalPower);
+	putsUart0("FS\nTHD: ");
+	putDbUart0(result.thd);
+	putsUart0(" (");
+	putFloatUart0(100 * sqrtf(result.thd), 3);
+	putsUart0(" %)\nSINAD: ");
+	putDbUart0(result.sinad);
+	putsUart0(" (");
+	putFloatUart0((10 * log10f(result.sinad) - 1.76f) / 6.02f, 2);
+	putsUart0(" ENOB)\n");
+	for(p = 0; p < result.peaks; p++)
 	{
-		lut_i_A = lut_i_A % (LUT_SIZE << INTEGER_BITS);
-		currentCycles_A++;
+		putsUart0("Peak ");
+		putuUart0(p + 1);
+		putsUart0(": ");
+		putEngUart0(result.peakBin[p] * binWidth, 3);
+		putsUart0("Hz ");
+		putDbUart0(2 * getFftPower((int16_t*)scopeBuffer, points, input, result.peakBin[p]));
+		putsUart0("FS\n");
 	}
+	putuUart0(points);
+	putsUart0(" points at ");
+	putuUart0(getCaptureRate());
+	putsUart0(" Hz, ");
+	putEngUart0(binWidth, 3);
+	putsUart0("Hz/bin, ");
+	putsUart0(spectrumWindow ? "Hann" : "no window");
+	putsUart0(", FFT ");
+	putuUart0(cycles / SYSTEM_CLOCK_MHZ);
+	putsUart0(" us of ");
+	putuUart0(getFftBudgetUs(points));
+	putsUart0(cycles / SYSTEM_CLOCK_MHZ > getFftBudgetUs(points) ? " us budget, OVER\n" : " us budget\n");
+	return true;
+}
+
+// Dumps the magnitude of every bin of the last transform as CSV
+void spectrumBins(void)
+{
+	float binWidth = (float)getCaptureRate() / spectrumPoints;
+	uint16_t k;
 	
-	if((lut_i_B >> INTEGER_BITS) >= LUT_SIZE)
+	putsUart0("bin,freq,dBFS\n");
+	for(k = 0; k <= spectrumPoints / 2; k++)
 	{
-		lut_i_B = lut_i_B % (LUT_SIZE << INTEGER_BITS);
-		currentCycles_B++;
+		putuUart0(k);
+		putcUart0(',');
+		putFloatUart0(k * binWidth, 2);
+		putcUart0(',');
+		putFloatUart0(10 * log10f(2 * getFftPower((int16_t*)scopeBuffer, spectrumPoints, spectrumInput, k) + 1e-12f), 2);
+		putcUart0('\n');
 	}
+}
+
+// The whole tick path runs from SRAM, free of flash wait states above 40 MHz.
+// The linker command file needs: .TI.ramfunc : {} load=FLASH, run=SRAM, table(BINIT)
+#pragma CODE_SECTION(tickIsr, ".TI.ramfunc")
+void tickIsr()
+{
+	uint32_t latency = TIMER4_TAILR_R - TIMER4_TAV_R; // counts down from TAILR after the timeout
+	uint32_t start = CYCLE_COUNT;
+	uint16_t codeA, codeB;
+	uint8_t playing;
+	
+	if(latency < tickMinLatency)
+		tickMinLatency = latency;
+	if(latency > tickMaxLatency)
+		tickMaxLatency = latency;
+	tickCount++;
 	
-	// if cycles hit the set limit, stop
-	// ignore if the maxCycles value set to -1
-	if(currentCycles_A == maxCycles_A && maxCycles_A != -1)
-		outA_EN = false;
-	if(currentCycles_B == maxCycles_B && maxCycles_B != -1)
-		outB_EN = false;
+	if(commitPending)
+		applyStaged();
+	
+	playing = ddsTick(&codeA, &codeB);
 	
 	/*if(hilbertFlag && outA_EN && outB_EN)
 		init
@@ -565,46 +1008,1755 @@ void tickIsr()
 	*/
 	
 	// writing each value to SPI
-	if(outA_EN)
+	if(playing & DDS_OUT_A)
 	{
-		writeSpi1Data( 0x3000 | lutA[lut_i_A >> INTEGER_BITS] );
+		playedCode_A = codeA;
+		writeSpi1Data( 0x3000 | (levelEN ? trimLevel(&levelA, playedCode_A) : playedCode_A) );
 		latchDAC();
-		lut_i_A += phaseAccum_A;
 	}
 	
-	if(outB_EN)
+	if(playing & DDS_OUT_B)
 	{
-		writeSpi1Data( 0xB000 | lutB[lut_i_B >> INTEGER_BITS] );
+		playedCode_B = codeB;
+		writeSpi1Data( 0xB000 | (levelEN ? trimLevel(&levelB, playedCode_B) : playedCode_B) );
 		latchDAC();
-		lut_i_B += phaseAccum_B;
 	}
 	
+	// start a phase locked capture just after this tick's DAC update
+	if(lockPending)
+	{
+		TIMER1_CTL_R |= TIMER_CTL_TAEN;
+		lockPhase = lut_i_A - phaseAccum_A;
+		lockPending = false;
+	}
+	
+	tickCycles = CYCLE_COUNT - start;
+	if(tickCycles > tickMaxCycles)
+		tickMaxCycles = tickCycles;
+	addLoad(&load, LOAD_TICK, tickCycles);
+	if(tickCycles + BUDGET_ENTRY_EXIT > TIMER4_TAILR_R)
+		traceEvent(TRACE_OVERRUN, tickCycles > 0xFFFF ? 0xFFFF : tickCycles);
+	
     TIMER4_ICR_R = TIMER_ICR_TATOCINT;
 }
 
-void timer2tick()
+/*  =============================== *
+ *  ||||||||| L E V E L ||||||||||| *
+ *  =============================== */
+
+// Codes played when the ADC pair in flight was started
+uint16_t levelTarget_A;
+uint16_t levelTarget_B;
+bool levelPending = false;
+
+// Timer 3 control task at LEVEL_RATE, placed on the Timer 3A vector in the startup file.
+// Never waits on the ADC: the pair started on the previous tick is read here and
+// the next one is started, so the DDS tick is not held off.
+void levelIsr()
 {
-	// prints out SS3 and SS2 value
-	char buffer[20];
-	sprintf(buffer, "1: %u\t2: %u\n", readAdc0Ss3(), readAdc0Ss2());
-	putsUart0(buffer);
+	uint32_t start = CYCLE_COUNT;
 	
-	TIMER2_ICR_R = TIMER_ICR_TATOCINT;
+	if(levelPending && !(ADC0_SSFSTAT2_R & ADC_SSFSTAT2_EMPTY) && !(ADC0_SSFSTAT3_R & ADC_SSFSTAT3_EMPTY))
+	{
+		// OUT A is watched on SS2, OUT B on SS3 (as in 'voltage')
+		if(outA_EN)
+			updateLevel(&levelA, levelTarget_A, ADC0_SSFIFO2_R);
+		else
+			ADC0_SSFIFO2_R;
+		if(outB_EN)
+			updateLevel(&levelB, levelTarget_B, ADC0_SSFIFO3_R);
+		else
+			ADC0_SSFIFO3_R;
+	}
+	
+	levelTarget_A = playedCode_A;
+	levelTarget_B = playedCode_B;
+	ADC0_PSSI_R |= ADC_PSSI_SS2 | ADC_PSSI_SS3;
+	levelPending = true;
+	
+	TIMER3_ICR_R = TIMER_ICR_TATOCINT;
+	addLoad(&load, LOAD_LEVEL, CYCLE_COUNT - start);
 }
 
+void startLevel()
+{
+	resetLevel(&levelA);
+	resetLevel(&levelB);
+	
+	// drop stale results so pairs stay matched
+	while(!(ADC0_SSFSTAT2_R & ADC_SSFSTAT2_EMPTY))
+		ADC0_SSFIFO2_R;
+	while(!(ADC0_SSFSTAT3_R & ADC_SSFSTAT3_EMPTY))
+		ADC0_SSFIFO3_R;
+	levelPending = false;
+	
+	levelEN = true;
+	TIMER3_CTL_R |= TIMER_CTL_TAEN;
+}
 
- /* ======================================= *
-  *           SHELL PROCESSING              *
-  * ======================================= */
+void stopLevel()
+{
+	TIMER3_CTL_R &= ~TIMER_CTL_TAEN;
+	levelEN = false;
+	resetLevel(&levelA);
+	resetLevel(&levelB);
+}
 
-int main(void)
+void printLevel(char* name, LEVEL* level)
 {
+	putsUart0(name);
+	putsUart0(": gain ");
+	putFloatUart0(100 * (level->gain - 1), 2);
+	putsUart0(" %, offset ");
+	putFloatUart0(1000 * level->offset, 1);
+	putsUart0(" mV, error ");
+	if(level->gainValid)
+	{
+		putFloatUart0(100 * level->gainError, 2);
+		putsUart0(" % ");
+	}
+	putFloatUart0(1000 * level->offsetError, 1);
+	putsUart0(" mV");
+	if(!level->gainValid)
+		putsUart0(" (offset only)");
+	if(level->saturated)
+		putsUart0(" SATURATED");
+	putsUart0(", ");
+	putuUart0(level->updates);
+	putsUart0(" updates\n");
+}
+
+/*  =============================== *
+ *  ||||||| V O L T A G E ||||||||| *
+ *  =============================== */
+
+#define VOLTAGE_DECIMATION 64
+#define VOLTAGE_RATE 1000 // decimated pairs per second, one block is 256 ms
+
+// Mean of one decimated block of input 0 (IN1) or 1 (IN2), in 100 uV steps at the pin
+// Returns false if no block arrived
+bool readInputVoltage(uint8_t input, uint32_t* tenthMillivolts)
+{
+	uint16_t previous = getCaptureDecimation();
+	uint16_t* block;
+	uint32_t sum = 0;
+	uint16_t i;
+	
+	setCaptureDecimation(VOLTAGE_DECIMATION);
+	startCapture(VOLTAGE_RATE);
+	block = waitCaptureBlock();
+	for(i = 0; block != 0 && i < CAPTURE_PAIRS; i++)
+		sum += block[2 * i + input];
+	stopCapture();
+	setCaptureDecimation(previous);
+	
+	// 16-bit full scale is 4095 << DECIMATE_FRACTION_BITS
+	*tenthMillivolts = (sum / CAPTURE_PAIRS) * 33000 / (4095 << DECIMATE_FRACTION_BITS);
+	return block != 0;
+}
+
+/*  =============================== *
+ *  ||||||||| M E T E R ||||||||||| *
+ *  =============================== */
+
+#define METER_DEFAULT_WINDOW_MS 100
+
+METER meter;
+
+// Capture block handler, runs in captureIsr()
+void meterBlock(uint16_t* block)
+{
+	uint32_t start = CYCLE_COUNT;
+	
+	updateMeter(&meter, block, CAPTURE_PAIRS);
+	meter.cyclesPerPair = (float)(CYCLE_COUNT - start) / CAPTURE_PAIRS;
+}
+
+bool isMeterRunning()
+{
+	return isCapturing() && getCaptureBlockHandler() == meterBlock;
+}
+
+// Runs capture at rate with the meter on every raw block, windowMs per result
+bool startMeasure(uint32_t rate, uint32_t windowMs)
+{
+	uint32_t window;
+	
+	if(windowMs == 0 || !startCapture(rate))
+		return false;
+	
+	window = (uint64_t)getCaptureRawRate() * windowMs / 1000;
+	if(window < CAPTURE_PAIRS)
+		window = CAPTURE_PAIRS;
+	if(window > METER_MAX_WINDOW)
+		window = METER_MAX_WINDOW;
+	startMeter(&meter, getCaptureRawRate(), window);
+	setCaptureBlockHandler(meterBlock);
+	return true;
+}
+
+void printMeterInput(char* name, METER_VALUES* values)
+{
+	putsUart0(name);
+	putsUart0(": DC ");
+	putFloatUart0(values->mean * 3.3 / 4095.0, 4);
+	putsUart0(" V, RMS ");
+	putFloatUart0(values->rms * 3.3 / 4095.0, 4);
+	putsUart0(" V, min ");
+	putFloatUart0(values->min * 3.3 / 4095.0, 3);
+	putsUart0(" V, max ");
+	putFloatUart0(values->max * 3.3 / 4095.0, 3);
+	putsUart0(" V, ");
+	putEngUart0(values->freq, 4);
+	putsUart0("Hz\n");
+}
+
+void printMeasure()
+{
+	METER_VALUES in1, in2;
+	uint32_t windows;
+	
+	if(!getMeterValues(&meter, &in1, &in2, &windows))
+	{
+		putsUart0(isMeterRunning() ? "No window finished yet.\n" : "Meter is off, use 'measure start RATE'.\n");
+		return;
+	}
+	printMeterInput("IN1", &in1);
+	printMeterInput("IN2", &in2);
+	putsUart0("Window ");
+	putuUart0(meter.window);
+	putsUart0(" pairs at ");
+	putuUart0(meter.rate);
+	putsUart0(" Hz, ");
+	putuUart0(windows);
+	putsUart0(isMeterRunning() ? " windows, " : " windows (stopped), ");
+	putFloatUart0(meter.cyclesPerPair, 1);
+	putsUart0(" cycles/pair\n");
+}
+
+ /* ======================================= *
+  *                BENCHMARK                *
+  * ======================================= */
+
+#define BENCH_DEFAULT_RUNS 32
+
+uint32_t benchSamples[BENCH_MAX_SAMPLES];
+
+// Times BENCH_WARMUP + runs calls of run, less the cost of timing an empty call
+void timeBench(_benchRun run, uint16_t runs, uint32_t overhead, BENCH_STATS* stats)
+{
+	uint32_t start, cycles;
+	uint16_t i;
+	
+	for(i = 0; i < BENCH_WARMUP + runs; i++)
+	{
+		start = CYCLE_COUNT;
+		run();
+		cycles = CYCLE_COUNT - start;
+		if(i >= BENCH_WARMUP)
+			benchSamples[i - BENCH_WARMUP] = cycles > overhead ? cycles - overhead : 0;
+	}
+	summarizeBench(benchSamples, runs, stats);
+}
+
+void printBenchCase(const BENCH_CASE* c, BENCH_STATS* stats, bool json)
+{
+	if(json)
+	{
+		putsUart0("{\"name\":\"");
+		putsUart0(c->name);
+		putsUart0("\",\"calls\":");
+		putuUart0(c->calls);
+		putsUart0(",\"median\":");
+		putFloatUart0((float)stats->median / c->calls, 1);
+		putsUart0(",\"p99\":");
+		putFloatUart0((float)stats->p99 / c->calls, 1);
+		putsUart0(",\"min\":");
+		putFloatUart0((float)stats->min / c->calls, 1);
+		putsUart0(",\"max\":");
+		putFloatUart0((float)stats->max / c->calls, 1);
+		putsUart0("}");
+		return;
+	}
+	putsUart0(c->name);
+	putsUart0(": median ");
+	putFloatUart0((float)stats->median / c->calls, 1);
+	putsUart0(", p99 ");
+	putFloatUart0((float)stats->p99 / c->calls, 1);
+	putsUart0(", min ");
+	putFloatUart0((float)stats->min / c->calls, 1);
+	putsUart0(", max ");
+	putFloatUart0((float)stats->max / c->calls, 1);
+	putsUart0(" cycles/call (");
+	putFloatUart0((float)stats->median / c->calls / SYSTEM_CLOCK_MHZ, 2);
+	putsUart0(" us)\n");
+}
+
+// Runs the named case, or all of them for name 0, false if no case matched
+bool runBench(char* name, uint16_t runs, bool json)
+{
+	BENCH_STATS stats;
+	uint32_t overhead;
+	bool saveA = outA_EN, saveB = outB_EN;
+	int32_t saveMaxA = maxCycles_A, saveMaxB = maxCycles_B;
+	uint8_t i, matched = 0;
+	
+	timeBench(benchNone, runs, 0, &stats);
+	overhead = stats.median;
+	
+	setupBench();
+	
+	if(json)
+	{
+		putsUart0("{\"clock\":");
+		putuUart0(SYSTEM_CLOCK_HZ);
+		putsUart0(",\"runs\":");
+		putuUart0(runs);
+		putsUart0(",\"warmup\":");
+		putuUart0(BENCH_WARMUP);
+		putsUart0(",\"unit\":\"cycles/call\",\"cases\":[");
+	}
+	for(i = 0; i < benchCaseCount; i++)
+	{
+		if(name && !strcomp(name, benchCases[i].name))
+			continue;
+		
+		// ddsTick() plays both channels from wherever the indexes were left
+		outA_EN = outB_EN = true;
+		maxCycles_A = maxCycles_B = -1;
+		timeBench(benchCases[i].run, runs, overhead, &stats);
+		outA_EN = saveA;
+		outB_EN = saveB;
+		maxCycles_A = saveMaxA;
+		maxCycles_B = saveMaxB;
+		
+		if(json && matched)
+			putcUart0(',');
+		printBenchCase(&benchCases[i], &stats, json);
+		matched++;
+	}
+	if(json)
+		putsUart0("]}\n");
+	return matched > 0;
+}
+
+ /* ======================================= *
+  *              TICK HEADROOM              *
+  * ======================================= */
+
+// Tick as currently set up, both outputs when nothing is playing
+void getTickConfig(TICK_CONFIG* config)
+{
+	bool playing = TIMER4_CTL_R & TIMER_CTL_TAEN;
+	
+	config->fcyc = SYSTEM_CLOCK_HZ;
+	config->spiClocks = SSI1_CPSR_R * (1 + ((SSI1_CR0_R & SSI_CR0_SCR_M) >> SSI_CR0_SCR_S));
+	config->channels = playing ? (outA_EN ? 1 : 0) + (outB_EN ? 1 : 0) : 2;
+	config->level = levelEN;
+	config->lock = false;
+}
+
+// Model against rate (0 for the running Timer4 rate), and the DWT timings of tickIsr()
+void printHeadroom(uint32_t rate)
+{
+	TICK_CONFIG config;
+	TICK_BUDGET budget;
+	uint32_t period, measured;
+	
+	getTickConfig(&config);
+	predictTick(&config, &budget);
+	period = rate ? config.fcyc / rate : TIMER4_TAILR_R + 1;
+	
+	putsUart0("Tick: ");
+	putuUart0(config.fcyc / period);
+	putsUart0(" Hz, ");
+	putuUart0(period);
+	putsUart0(" clocks, ");
+	putuUart0(config.channels);
+	putsUart0(config.level ? " outputs trimmed" : " outputs");
+	putsUart0(", SPI ");
+	putuUart0(config.fcyc / config.spiClocks);
+	putsUart0(" Hz\n");
+	
+	putsUart0("Model: entry/exit ");
+	putuUart0(budget.entryExit);
+	putsUart0(" + fixed ");
+	putuUart0(budget.fixed);
+	putsUart0(" + dds ");
+	putuUart0(budget.dds);
+	putsUart0(" + spi ");
+	putuUart0(budget.spi);
+	putsUart0(" + latch ");
+	putuUart0(budget.latch);
+	putsUart0(" + level ");
+	putuUart0(budget.level);
+	putsUart0(" = ");
+	putuUart0(budget.total);
+	putsUart0(" clocks, headroom ");
+	putiUart0(getTickHeadroom(&budget, period));
+	putsUart0("%\n");
+	
+	// body only, the DWT reads sit inside the entry and exit
+	measured = tickMaxCycles;
+	tickMaxCycles = 0;
+	if(TIMER4_CTL_R & TIMER_CTL_TAEN)
+	{
+		putsUart0("Measured body: last ");
+		putuUart0(tickCycles);
+		putsUart0(", max ");
+		putuUart0(measured);
+		putsUart0(" clocks (model ");
+		putuUart0(budget.body);
+		putsUart0(", max includes commits)\n");
+		putsUart0("Entry latency: min ");
+		putuUart0(tickMinLatency);
+		putsUart0(", max ");
+		putuUart0(tickMaxLatency);
+		putsUart0(" clocks, jitter ");
+		putuUart0((tickMaxLatency - tickMinLatency) * 1000 / SYSTEM_CLOCK_MHZ);
+		putsUart0(" ns\n");
+	}
+	tickMinLatency = 0xFFFFFFFF;
+	tickMaxLatency = 0;
+	
+	putsUart0("Max safe rate: ");
+	putuUart0(budget.maxRate);
+	putsUart0(" Hz (TAILR ");
+	putuUart0(budget.minPeriod - 1);
+	putsUart0(", ");
+	putuUart0(BUDGET_MARGIN_PERCENT);
+	putsUart0("% kept for the other ISRs)\n");
+}
+
+ /* ======================================= *
+  *                SELF TEST                *
+  * ======================================= */
+
+// Runs one case (or all for name 0) through the DDS into scopeBuffer, false if no case matched
+bool runSelfTests(char* name)
+{
+	SELFTEST_RESULT result;
+	uint8_t i, matched = 0, failed = 0;
+	
+	spectrumValid = false;
+	for(i = 0; i < getSelfTestCount(); i++)
+	{
+		if(name && !strcomp(name, getSelfTestName(i)))
+			continue;
+		runSelfTest(i, scopeBuffer, &result);
+		matched++;
+		if(!result.pass)
+			failed++;
+		
+		putsUart0(getSelfTestName(i));
+		putsUart0(result.pass ? ": PASS" : ": FAIL");
+		if(strcomp(getSelfTestName(i), "cycles"))
+		{
+			putsUart0(", ");
+			putuUart0(result.ticks);
+			putsUart0(" ticks");
+		}
+		else
+		{
+			putsUart0(", bin ");
+			putuUart0(result.bin);
+			putsUart0(", amplitude ");
+			putFloatUart0(result.amplitude, 4);
+			putsUart0(", THD ");
+			putFloatUart0(result.thd, 1);
+			putsUart0(" dB (");
+			putFloatUart0(result.thdExpected, 1);
+			putsUart0("), SFDR ");
+			putFloatUart0(result.sfdr, 1);
+			putsUart0(" dB");
+			if(strcomp(getSelfTestName(i), "differential") || strcomp(getSelfTestName(i), "hilbert"))
+			{
+				putsUart0(", A/B correlation ");
+				putFloatUart0(result.correlation, 4);
+			}
+		}
+		putsUart0(", checksum ");
+		putxUart0(result.checksum, 8);
+		putcUart0('\n');
+	}
+	if(matched > 1)
+	{
+		putuUart0(matched - failed);
+		putsUart0(" of ");
+		putuUart0(matched);
+		putsUart0(" passed\n");
+	}
+	return matched > 0;
+}
+
+ /* ======================================= *
+  *                SCRIPTING                *
+  * ======================================= */
+
+// No prompt, every response ends with a line holding only '.' (tools/sigshell.py)
+bool scriptMode = false;
+
+void printOutputStatus(char* name, bool enabled, uint32_t step, uint16_t code, uint32_t cycles, int32_t maxCycles)
+{
+	putsUart0(name);
+	putsUart0(": en=");
+	putuUart0(enabled);
+	putsUart0(" freq=");
+	putFloatUart0(step * getTickRate() / (1UL << DDS_PHASE_BITS), 3);
+	putsUart0(" step=");
+	putuUart0(step);
+	putsUart0(" code=");
+	putuUart0(code);
+	putsUart0(" cycles=");
+	putuUart0(cycles);
+	putsUart0(" max=");
+	putiUart0(maxCycles);
+	putcUart0('\n');
+}
+
+// key=value readback of what the DDS is playing, one line per output
+void printStatus()
+{
+	putsUart0("run=");
+	putuUart0((TIMER4_CTL_R & TIMER_CTL_TAEN) != 0);
+	putsUart0(" rate=");
+	putFloatUart0(getTickRate(), 2);
+	putsUart0(" ticks=");
+	putuUart0(tickCount);
+	putsUart0(" staged=");
+	putuUart0(stagedEN);
+	putsUart0(" differential=");
+	putuUart0(differentialEN);
+	putsUart0(" hilbert=");
+	putuUart0(hilbertEN);
+	putsUart0(" level=");
+	putuUart0(levelEN);
+	putsUart0(" capture=");
+	putuUart0(isCapturing());
+	putcUart0('\n');
+	printOutputStatus("A", outA_EN, phaseAccum_A, playedCode_A, currentCycles_A, maxCycles_A);
+	printOutputStatus("B", outB_EN, phaseAccum_B, playedCode_B, currentCycles_B, maxCycles_B);
+}
+
+ /* ======================================= *
+  *                  TRACE                  *
+  * ======================================= */
+
+// Dumps the ring oldest first as text or as the binary frame in trace.c, recording paused
+void dumpTrace(bool binary)
+{
+	uint32_t mask = traceMask;
+	uint8_t bytes[TRACE_HEADER];
+	uint16_t i, count, checksum = 0;
+	TRACE_ENTRY* entry;
+	uint32_t first;
+	
+	traceMask = 0;
+	count = getTraceCount();
+	if(binary)
+	{
+		putBufferUart0(bytes, packTraceHeader(bytes));
+		for(i = 0; i < count; i++)
+		{
+			checksum += packTraceEntry(i, bytes);
+			putBufferUart0(bytes, TRACE_ENTRY_BYTES);
+		}
+		bytes[0] = checksum & 0xFF;
+		bytes[1] = checksum >> 8;
+		putBufferUart0(bytes, 2);
+	}
+	else
+	{
+		first = count ? getTraceEntry(0)->time : 0;
+		for(i = 0; i < count; i++)
+		{
+			entry = getTraceEntry(i);
+			putsUart0("+");
+			putFloatUart0((float)(entry->time - first) / SYSTEM_CLOCK_MHZ, 1);
+			putsUart0(" us ");
+			putsUart0(getTraceName((TRACE_EVENT)entry->event));
+			putcUart0(' ');
+			if(entry->event == TRACE_COMMAND || entry->event == TRACE_DISPATCHED)
+			{
+				putcUart0(entry->data >> 8 ? entry->data >> 8 : '-');
+				putcUart0(entry->data & 0xFF ? entry->data & 0xFF : '-');
+			}
+			else
+				putxUart0(entry->data, 4);
+			putcUart0('\n');
+		}
+		putuUart0(count);
+		putsUart0(" of ");
+		putuUart0(traceHead);
+		putsUart0(" events held\n");
+	}
+	traceMask = mask;
+}
+
+void printTraceMask()
+{
+	uint8_t e;
+	
+	putsUart0("Tracing:");
+	for(e = 0; e < TRACE_EVENTS; e++)
+		if(traceMask & (1UL << e))
+		{
+			putcUart0(' ');
+			putsUart0(getTraceName((TRACE_EVENT)e));
+		}
+	putsUart0(traceMask ? "\n" : " nothing\n");
+}
+
+// trace on|off [EVENT|all], false if EVENT is unknown
+bool setTraceMask(USER_DATA* data, bool on)
+{
+	TRACE_EVENT event;
+	uint32_t bits;
+	
+	if(data->fieldCount < 3 || strcomp(getFieldString(data, 2), "all"))
+		bits = (1UL << TRACE_EVENTS) - 1;
+	else if(findTraceEvent(getFieldString(data, 2), &event))
+		bits = 1UL << event;
+	else
+		return false;
+	
+	if(on)
+		traceMask |= bits;
+	else
+		traceMask &= ~bits;
+	return true;
+}
+
+ /* ======================================= *
+  *                CPU LOAD                 *
+  * ======================================= */
+
+// SysTick, closes one slot of the rolling load window
+void loadIsr()
+{
+	sampleLoad(&load, CYCLE_COUNT);
+}
+
+void printLoad()
+{
+	LOAD_RESULT result;
+	uint8_t s;
+	
+	if(!getLoad(&load, &result))
+	{
+		putsUart0("No load sample yet.\n");
+		return;
+	}
+	putsUart0("Window ");
+	putuUart0(result.window / (SYSTEM_CLOCK_HZ / 1000));
+	putsUart0(" ms:\n");
+	for(s = 0; s < LOAD_SOURCES; s++)
+	{
+		putsUart0(getLoadName((LOAD_SOURCE)s));
+		putsUart0(": ");
+		putFloatUart0(result.percent[s], 2);
+		putsUart0(" %\n");
+	}
+	putsUart0("idle: ");
+	putFloatUart0(result.idle, 2);
+	putsUart0(" % (UART is polled, its time is in shell and idle)\n");
+}
+
+ /* ======================================= *
+  *              SAVED STATE                *
+  * ======================================= */
+
+uint32_t bootCycles = 0; // clocks from initCycleCounter() to the restored output, 0 if none
+
+void getGenState(GEN_STATE* state)
+{
+	state->wave[0] = *getWaveParams(lutA);
+	state->wave[1] = *getWaveParams(lutB);
+	state->phaseAccum[0] = phaseAccum_A;
+	state->phaseAccum[1] = phaseAccum_B;
+	state->maxCycles[0] = maxCycles_A;
+	state->maxCycles[1] = maxCycles_B;
+	state->levelGain[0] = levelA.gain;
+	state->levelGain[1] = levelB.gain;
+	state->levelOffset[0] = levelA.offset;
+	state->levelOffset[1] = levelB.offset;
+	state->levelBandwidth = levelA.bandwidth;
+	state->flags = ((TIMER4_CTL_R & TIMER_CTL_TAEN) ? STATE_RUN : 0)
+	             | (outA_EN ? STATE_OUT_A : 0)
+	             | (outB_EN ? STATE_OUT_B : 0)
+	             | (differentialEN ? STATE_DIFFERENTIAL : 0)
+	             | (hilbertEN ? STATE_HILBERT : 0)
+	             | (levelEN ? STATE_LEVEL : 0);
+}
+
+// Renders the tables again and starts the outputs as saved
+// B goes first with the modes off, rendering A with them on rebuilds a derived B
+void applyGenState(GEN_STATE* state)
+{
+	WAVE_PARAMS* wave = state->wave;
+	
+	TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
+	if(levelEN)
+		stopLevel();
+	
+	differentialEN = false;
+	hilbertEN = false;
+	if(wave[1].type != 0)
+		calculateWave((WAVE)wave[1].type, DAC_B, wave[1].amp, wave[1].ofs, wave[1].dutyCycle);
+	differentialEN = (state->flags & STATE_DIFFERENTIAL) != 0;
+	hilbertEN = (state->flags & STATE_HILBERT) != 0;
+	if(wave[0].type != 0)
+		calculateWave((WAVE)wave[0].type, DAC_A, wave[0].amp, wave[0].ofs, wave[0].dutyCycle);
+	
+	phaseAccum_A = state->phaseAccum[0];
+	phaseAccum_B = state->phaseAccum[1];
+	maxCycles_A = state->maxCycles[0];
+	maxCycles_B = state->maxCycles[1];
+	lut_i_A = 0;
+	lut_i_B = 0;
+	currentCycles_A = 0;
+	currentCycles_B = 0;
+	outA_EN = (state->flags & STATE_OUT_A) != 0;
+	outB_EN = (state->flags & STATE_OUT_B) != 0;
+	
+	setLevelBandwidth(&levelA, state->levelBandwidth);
+	setLevelBandwidth(&levelB, state->levelBandwidth);
+	if(state->flags & STATE_LEVEL)
+	{
+		startLevel();
+		presetLevel(&levelA, state->levelGain[0], state->levelOffset[0]);
+		presetLevel(&levelB, state->levelGain[1], state->levelOffset[1]);
+	}
+	
+	if(state->flags & STATE_RUN)
+		TIMER4_CTL_R |= TIMER_CTL_TAEN;
+}
+
+// Restores the saved state, returns false and leaves everything as it was if there is none
+bool restoreGenState(STATE_RESULT* result)
+{
+	GEN_STATE state;
+	
+	*result = loadState(&state);
+	if(*result != STATE_OK)
+		return false;
+	applyGenState(&state);
+	return true;
+}
+
+void printSaveStatus()
+{
+	GEN_STATE state;
+	STATE_RESULT result = loadState(&state);
+	
+	putsUart0("Saved state: ");
+	putsUart0(getStateResultName(result));
+	if(result == STATE_OK)
+	{
+		putsUart0(", CRC ");
+		putxUart0(getStateCrc(), 8);
+	}
+	putsUart0("\nRestore at boot: ");
+	putsUart0(getStateBoot() ? "ON" : "OFF");
+	putsUart0("\nBoot to output: ");
+	if(bootCycles)
+	{
+		// clocks to us, printed as ms
+		putFixedUart0(bootCycles / SYSTEM_CLOCK_MHZ, 3);
+		putsUart0(" ms after the PLL locked\n");
+	}
+	else
+		putsUart0("not restored this boot\n");
+}
+
+void timer2tick()
+{
+	uint32_t start = CYCLE_COUNT;
+	
+	// prints out SS3 and SS2 value
+	putsUart0("1: ");
+	putuUart0(readAdc0Ss3());
+	putsUart0("\t2: ");
+	putuUart0(readAdc0Ss2());
+	putcUart0('\n');
+	
+	TIMER2_ICR_R = TIMER_ICR_TATOCINT;
+	addLoad(&load, LOAD_TIMER2, CYCLE_COUNT - start);
+}
+
+
+ /* ======================================= *
+  *           SHELL PROCESSING              *
+  * ======================================= */
+
+void playMacro(int8_t slot);
+
+// Runs one parsed shell line, shared by the UART shell and macro replay
+void processCommand(USER_DATA* data)
+{
+#ifdef DEBUG
+    char buffer[MAX_CHARS + 1];
+#endif
+	DAC dac = DAC_INVALID;
+    float voltage = 0, freq = 0, amp = 1, ofs = 0;
+	uint8_t dutyCycle = 50;
+	float freq_ref = (((float)SYSTEM_CLOCK_HZ / (float)(TIMER4_TAILR_R + 1))) * (1.0 / (float)LUT_SIZE);
+	int32_t testValue = 0;
+	uint32_t adcTenthMillivolts;
+	int32_t waitUs;
+	uint16_t i;
+
+    /*  ======================= *
+     *  ||||||||| D C ||||||||| *
+     *  ======================= */
+    if( isCommand(data, "dc", 2) )
+    {
+        dac = (DAC)getFieldInteger(data, 1);
+        voltage = getFieldFloat(data, 2);
+		
+#ifdef DEBUG
+        sprintf(buffer, "DAC: %u\tVoltage: %f\n", dac, voltage);
+        putsUart0(buffer);
+#endif
+
+		if( (dac <= 2) && selectOutputVoltage(dac, voltage) )
+			putsUart0("Successfully wrote to DAC.");
+		else
+			putsUart0("ERROR: Could not write DC Voltage to DAC.");
+
+    }
+	
+	/*  ======================= *
+     *  ||| S T A G I N G ||| *
+     *  ======================= */
+    else if( isCommand(data, "begin", 0) )
+    {
+		if(stagedEN)
+			putsUart0("ERROR: Already staging, use 'commit' or 'abort'.\n");
+		else
+		{
+			beginStaged();
+			putsUart0("Staging. Changes apply on 'commit'.\n");
+		}
+    }
+    else if( isCommand(data, "commit", 0) )
+    {
+		if(!stagedEN)
+			putsUart0("ERROR: Nothing staged, use 'begin' first.\n");
+		else
+		{
+			commitStaged();
+			// clocks to ns, printed as us
+			putsUart0("Committed in ");
+			putFixedUart0(commitLatency * 1000 / SYSTEM_CLOCK_MHZ, 3);
+			putsUart0(" us (sample period ");
+			putFixedUart0((TIMER4_TAILR_R + 1) * 1000 / SYSTEM_CLOCK_MHZ, 3);
+			putsUart0(" us).\n");
+		}
+    }
+    else if( isCommand(data, "abort", 0) )
+    {
+		abortStaged();
+		putsUart0("Staged changes discarded.\n");
+    }
+	
+	/*  ======================= *
+     *  ||| R U N / S T O P ||| *
+     *  ======================= */
+    else if( isCommand(data, "run", 0) )
+    {
+		if(stagedEN)
+			putsUart0("ERROR: 'commit' or 'abort' before 'run'.\n");
+		else
+		{
+			currentCycles_A = 0;
+			currentCycles_B = 0;
+			lut_i_A = 0;
+			lut_i_B = 0;
+			outA_EN = true;
+			outB_EN = true;
+			TIMER4_CTL_R |= TIMER_CTL_TAEN;
+		}
+    }
+	else if( isCommand(data, "stop", 0) )
+	{
+		if(stagedEN)
+			putsUart0("ERROR: 'commit' or 'abort' before 'stop'.\n");
+		else
+		{
+			selectOutputVoltage(DAC_A, 0);
+			selectOutputVoltage(DAC_B, 0);
+			TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
+		}
+	}
+	
+	/*  ======================= *
+     *  |||||||| D A C |||||||| *
+     *  ======================= */
+    else if( isCommand(data, "dac", 2) )
+    {
+        dac = (DAC)getFieldInteger(data, 1);
+        voltage = getFieldFloat(data, 2);
+		
+#ifdef DEBUG
+        sprintf(buffer, "Float: %f\n", voltage);
+        putsUart0(buffer);
+#endif
+
+		if( (dac <= 2 && voltage != -1) && selectDACVoltage(dac, voltage) )
+			putsUart0("Successfully wrote to DAC.");
+		else
+			putsUart0("ERROR: Could not write DC Voltage to DAC.");
+
+    }
+	
+	/*  ======================= *
+     *  ||||| C Y C L E S ||||| *
+     *  ======================= */
+    else if( isCommand(data, "cycles", 1) )
+    {
+		if(data->fieldType[1] == 'n')
+		{
+			if(getFieldInteger(data, 1) == 1)
+				setMaxCycles(DAC_A, getFieldInteger(data, 2));
+			else if(getFieldInteger(data, 1) == 2)
+				setMaxCycles(DAC_B, getFieldInteger(data, 2));
+		}
+		else if(data->fieldType[1] == 'a' && strcomp(getFieldString(data, 1), "continuous") )
+		{
+			setMaxCycles(DAC_A, -1);
+			setMaxCycles(DAC_B, -1);
+		}
+		else
+		{
+			putsUart0("ERROR: Invalid command for 'cycles'.");
+		}
+    }
+	
+	/*  ======================= *
+     *  ||||||| S I N E ||||||| * 
+     *  ======================= */
+	else if( isCommand(data, "sine", 3) )
+	{
+		dac = (DAC)getFieldInteger(data, 1);
+		freq = getFieldFloat(data, 2);
+		amp = getFieldFloat(data, 3);
+		
+		if( isCommand(data, "sine", 4) )
+			ofs = getFieldFloat(data, 4);
+		
+#ifdef DEBUG
+		sprintf(buffer, "DAC: %u\tFreq: %f\tAmp: %f\tOFS: %f", dac, freq, amp, ofs);
+		putsUart0(buffer);
+#endif
+		if( dac <= 2 )
+		{
+			calculateWave(SINE, dac, amp, ofs, dutyCycle);
+			putsUart0("Successfully calculated Sine wave.");
+			if(dac == DAC_A)
+				setPhaseAccum(DAC_A, float2uint(freq / freq_ref));
+			
+			if(dac == DAC_B && !differentialEN)
+				setPhaseAccum(DAC_B, float2uint(freq / freq_ref));
+			
+			if(differentialEN || hilbertEN)
+				setPhaseAccum(DAC_B, getPhaseAccum(DAC_A));
+			
+			TIMER4_CTL_R |= TIMER_CTL_TAEN;
+		}
+		else
+			putsUart0("ERROR: invalid argument for 'sine'.");
+	}
+	
+	
+	/*  ======================= *
+     *  ||||| S Q U A R E ||||| * 
+     *  ======================= */
+	else if( isCommand(data, "square", 3) )
+	{
+		dac = (DAC)getFieldInteger(data, 1);
+		freq = getFieldFloat(data, 2);
+		amp = getFieldFloat(data, 3);
+		
+		if( isCommand(data, "square", 4) )
+			ofs = getFieldFloat(data, 4);
+		
+		if( isCommand(data, "square", 5) )
+			dutyCycle = getFieldInteger(data, 5);
+		
+		putsUart0("DAC: ");
+		putuUart0(dac);
+		putsUart0("\nFreq: ");
+		putFloatUart0(freq, 3);
+		putsUart0("\nAmp: ");
+		putFloatUart0(amp, 3);
+		putsUart0("\nOFS: ");
+		putFloatUart0(ofs, 3);
+		putsUart0("\nD.C.: ");
+		putuUart0(dutyCycle);
+		putsUart0("%\n\n");
+
+		if( dac <= 2 )
+		{
+			calculateWave(SQUARE, dac, amp, ofs, dutyCycle);
+			putsUart0("Successfully calculated Square wave.");
+			if(dac == DAC_A)
+				setPhaseAccum(DAC_A, float2uint(freq / freq_ref));
+			else if(dac == DAC_B)
+				setPhaseAccum(DAC_B, float2uint(freq / freq_ref));
+			if(differentialEN)
+				setPhaseAccum(DAC_B, getPhaseAccum(DAC_A));
+			TIMER4_CTL_R |= TIMER_CTL_TAEN;
+		}
+		else if( strcomp(getFieldString(data, 1), "stop") && stagedEN )
+			putsUart0("ERROR: 'commit' or 'abort' before 'square stop'.\n");
+		else if( strcomp(getFieldString(data, 1), "stop") )
+		{
+			TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
+		}
+		else
+			putsUart0("ERROR: invalid argument for 'square'.");
+	}
+	
+	/*  ======================= *
+     *  |||||||| S A W |||||||| * 
+     *  ======================= */
+	else if( isCommand(data, "sawtooth", 3) )
+	{
+		dac = (DAC)getFieldInteger(data, 1);
+		freq = getFieldFloat(data, 2);
+		amp = getFieldFloat(data, 3);
+		
+		if( isCommand(data, "sawtooth", 4) )
+			ofs = getFieldFloat(data, 4);
+		
+#ifdef DEBUG
+		sprintf(buffer, "DAC: %u\tFreq: %f\tAmp: %f\tOFS: %f", dac, freq, amp, ofs);
+		putsUart0(buffer);
+#endif
+		if( dac <= 2 )
+		{
+			calculateWave(SAW, dac, amp, ofs, dutyCycle);
+			putsUart0("Successfully calculated Sawtooth wave.");
+			if(dac == DAC_A)
+				setPhaseAccum(DAC_A, float2uint(freq / freq_ref));
+			else if(dac == DAC_B)
+				setPhaseAccum(DAC_B, float2uint(freq / freq_ref));
+			if(differentialEN)
+				setPhaseAccum(DAC_B, getPhaseAccum(DAC_A));
+			TIMER4_CTL_R |= TIMER_CTL_TAEN;
+		}
+		else if( strcomp(getFieldString(data, 1), "stop") && stagedEN )
+			putsUart0("ERROR: 'commit' or 'abort' before 'sawtooth stop'.\n");
+		else if( strcomp(getFieldString(data, 1), "stop") )
+		{
+			TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
+		}
+		else
+			putsUart0("ERROR: invalid argument for 'sawtooth'.");
+	}
+	
+	/*  ======================= *
+     *  |||||||| T R I |||||||| * 
+     *  ======================= */
+	else if( isCommand(data, "triangle", 3) )
+	{
+		dac = (DAC)getFieldInteger(data, 1);
+		freq = getFieldFloat(data, 2);
+		amp = getFieldFloat(data, 3);
+		
+		if( isCommand(data, "triangle", 4) )
+			ofs = getFieldFloat(data, 4);
+		
+#ifdef DEBUG
+		sprintf(buffer, "DAC: %u\tFreq: %f\tAmp: %f\tOFS: %f", dac, freq, amp, ofs);
+		putsUart0(buffer);
+#endif
+		if( dac <= 2 )
+		{
+			calculateWave(TRI, dac, amp, ofs, dutyCycle);
+			putsUart0("Successfully calculated Triangle wave.");
+			if(dac == DAC_A)
+				setPhaseAccum(DAC_A, float2uint(freq / freq_ref));
+			else if(dac == DAC_B)
+				setPhaseAccum(DAC_B, float2uint(freq / freq_ref));
+			TIMER4_CTL_R |= TIMER_CTL_TAEN;
+			if(differentialEN)
+				setPhaseAccum(DAC_B, getPhaseAccum(DAC_A));
+		}
+		else if( strcomp(getFieldString(data, 1), "stop") && stagedEN )
+			putsUart0("ERROR: 'commit' or 'abort' before 'triangle stop'.\n");
+		else if( strcomp(getFieldString(data, 1), "stop") )
+		{
+			TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
+		}
+		else
+			putsUart0("ERROR: invalid argument for 'triangle'.");
+	}
+
+    /*  ======================== *
+     *  ||||||| T E S T |||||||| *
+     *  ======================== */
+    else if( isCommand(data, "test", 1) )
+    {
+        if( strcomp(getFieldString(data, 1), "DAC") )
+        {
+            putsUart0("Testing DAC Voltages...\n");
+			
+			testValue = 0xFFF;
+			putsUart0("test value: ");
+			putxUart0(testValue, 0);
+			putcUart0('\n');
+			setPinValue(RED_LED, 1);
+			setPinValue(BLUE_LED, 1);
+			writeSpi1Data(0x3000 | testValue);
+			writeSpi1Data(0xB000 | testValue);
+			latchDAC();
+			waitMicrosecond(4000000);
+			
+			for(testValue = 0xF00; testValue >= 0; testValue -= 0x100)
+			{
+				putsUart0("test value: ");
+				putxUart0(testValue, 0);
+				putcUart0('\n');
+				setPinValue(RED_LED, !getPinValue(RED_LED) );
+				setPinValue(BLUE_LED, !getPinValue(BLUE_LED) );
+				writeSpi1Data(0x3000 | testValue);
+				writeSpi1Data(0xB000 | testValue);
+				latchDAC();
+				waitMicrosecond(4000000);
+			}
+			
+			setPinValue(RED_LED, 0);
+			setPinValue(BLUE_LED, 0);
+			
+        }
+		else if( strcomp(getFieldString(data, 1), "adc" ) )
+		{
+			// timer2tick() reads SS2/SS3, which levelIsr() owns while level control runs
+			if( strcomp(getFieldString(data, 2), "ON" ) && levelEN )
+				putsUart0("ERROR: 'level OFF' before 'test adc ON'.\n");
+			else if( strcomp(getFieldString(data, 2), "ON" ) )
+				TIMER2_CTL_R |= TIMER_CTL_TAEN;
+			else if( strcomp(getFieldString(data, 2), "OFF" ) )
+			{
+				TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
+				setPinValue(GREEN_LED, 0);
+			}
+		}
+		
+        else
+        {
+            putsUart0("ERROR: Invalid argument for 'test'.");
+        }
+    }
+	
+	/*  =============================== *
+     *  ||||||||||| D I F F ||||||||||| *
+     *  =============================== */
+    else if( isCommand(data, "differential", 1) )
+    {
+        if( stagedEN )
+			putsUart0("ERROR: 'commit' or 'abort' before 'differential'.\n");
+        else if( strcomp(getFieldString(data, 1), "ON") )
+		{
+			putsUart0("Differential enabled. Please enter waveform on DAC A.\n");
+			differentialEN = true;
+		}
+		else if( strcomp(getFieldString(data, 1), "OFF") )
+		{
+			putsUart0("Differential disabled. Normal behavior resumed.\n");
+			differentialEN = false;
+		}
+		else
+			putsUart0("ERROR: Invalid command for 'differential'.\n");
+    }
+	
+	/*  =============================== *
+     *  |||||||| H I L B E R T |||||||| *
+     *  =============================== */
+    else if( isCommand(data, "hilbert", 1) )
+    {
+        if( stagedEN )
+			putsUart0("ERROR: 'commit' or 'abort' before 'hilbert'.\n");
+        else if( strcomp(getFieldString(data, 1), "ON") )
+		{
+			hilbertEN = true;
+			putsUart0("Hilbert enabled. Please enter sine wave on DAC A.\n");
+			//lut_i_B = (LUT_SIZE/4) << INTEGER_BITS;
+		}
+		else if( strcomp(getFieldString(data, 1), "OFF") )
+			hilbertEN = false;
+		else
+			putsUart0("ERROR: Invalid command for 'hilbert'.\n");
+    }
+	
+	/*  =============================== *
+     *  |||||||||| L E V E L |||||||||| *
+     *  =============================== */
+    else if( isCommand(data, "level", 1) )
+    {
+		// level ON | OFF | status | bw HZ
+		// measures each output at the load and trims its gain and offset (see level.c)
+        if( strcomp(getFieldString(data, 1), "ON") && (TIMER2_CTL_R & TIMER_CTL_TAEN) )
+			putsUart0("ERROR: 'test adc OFF' before 'level ON'.\n");
+        else if( strcomp(getFieldString(data, 1), "ON") )
+			startLevel();
+		else if( strcomp(getFieldString(data, 1), "OFF") )
+			stopLevel();
+		else if( strcomp(getFieldString(data, 1), "status") )
+		{
+			putsUart0(levelEN ? "Level control ON\n" : "Level control OFF\n");
+			printLevel("A", &levelA);
+			printLevel("B", &levelB);
+		}
+		else if( strcomp(getFieldString(data, 1), "bw") && isCommand(data, "level", 2) && getFieldFloat(data, 2) > 0 )
+		{
+			setLevelBandwidth(&levelA, getFieldFloat(data, 2));
+			setLevelBandwidth(&levelB, getFieldFloat(data, 2));
+		}
+		else
+			putsUart0("ERROR: Invalid command for 'level'.\n");
+    }
+	
+	/*  =============================== *
+     *  ||||||||||| G A I N ||||||||||| *
+     *  =============================== */
+    else if( isCommand(data, "gain", 1) )
+    {
+		// create freq array of requested range (log)
+		// output sine wave at freq...
+		//...wait for a second, measure voltage value for each channel
+		// calculate gain from both channels
+		// create table, graph gain plot
+		
+		if(stagedEN)
+			putsUart0("ERROR: 'commit' or 'abort' before 'gain'.\n");
+		else
+		{
+			outA_EN = false;
+			outB_EN = false;
+			TIMER4_CTL_R |= TIMER_CTL_TAEN;
+			renderSweepTables(dutyCycle);
+			
+			freqSweep(getFieldFloat(data, 1), getFieldFloat(data, 2) );
+		}
+		
+		//putsUart0("ERROR: Invalid command for 'gain'.\n");
+    }
+
+    /*  =============================== *
+     *  ||||||||||| B O D E ||||||||||| *
+     *  =============================== */
+    else if( isCommand(data, "bode", 1) )
+    {
+        if( strcomp(getFieldString(data, 1), "csv") )
+            bodeBinary = false;
+        else if( strcomp(getFieldString(data, 1), "bin") )
+            bodeBinary = true;
+        else if( stagedEN )
+            putsUart0("ERROR: 'commit' or 'abort' before 'bode'.\n");
+        else if( isCommand(data, "bode", 3) && getFieldFloat(data, 1) > 0 && getFieldFloat(data, 2) > getFieldFloat(data, 1)
+                 && getFieldInteger(data, 3) > 0 )
+        {
+            // getFieldInteger() is -1 for anything but a whole number
+            int32_t settle = isCommand(data, "bode", 4) ? getFieldInteger(data, 4) : BODE_SETTLE_CYCLES;
+            int32_t cycles = isCommand(data, "bode", 5) ? getFieldInteger(data, 5) : BODE_MIN_CYCLES;
+            
+            if( settle <= 0 || settle > BODE_MAX_CYCLES || cycles <= 0 || cycles > BODE_MAX_CYCLES )
+                putsUart0("ERROR: SETTLE and CYCLES must be 1 to 2000.\n");
+            else
+            {
+                renderSweepTables(dutyCycle);
+                TIMER4_CTL_R |= TIMER_CTL_TAEN;
+                
+                bodeSweep(getFieldFloat(data, 1), getFieldFloat(data, 2), getFieldInteger(data, 3), settle, cycles);
+            }
+        }
+        else
+            putsUart0("ERROR: Invalid command for 'bode'.\n");
+    }
+
+    /*  =============================== *
+     *  ||||||||||| T O N E ||||||||||| *
+     *  =============================== */
+    else if( isCommand(data, "tone", 1) )
+    {
+        float freqs[GOERTZEL_MAX_BINS];
+        uint8_t bins;
+
+        for(bins = 0; bins < GOERTZEL_MAX_BINS && bins + 1 < data->fieldCount; bins++)
+        {
+            freqs[bins] = getFieldFloat(data, bins + 1);
+            if( freqs[bins] <= 0 )
+                break;
+        }
+        if( bins + 1 < data->fieldCount )
+            putsUart0("ERROR: Invalid command for 'tone'.\n");
+        else
+            toneAnalyze(freqs, bins);
+    }
+
+    /*  =============================== *
+     *  |||||||| C A P T U R E |||||||| *
+     *  =============================== */
+    else if( isCommand(data, "trigger", 1) )
+    {
+        // trigger none | trigger IN LEVEL rise|fall|high|low
+        TRIGGER mode = TRIG_NONE;
+        char* edge = getFieldString(data, 3);
+
+        if( strcomp(getFieldString(data, 1), "none") )
+            setScopeTrigger(TRIG_NONE, 0, 0);
+        else if( isCommand(data, "trigger", 3) && (getFieldInteger(data, 1) == 1 || getFieldInteger(data, 1) == 2) )
+        {
+            if( strcomp(edge, "rise") )
+                mode = TRIG_RISE;
+            else if( strcomp(edge, "fall") )
+                mode = TRIG_FALL;
+            else if( strcomp(edge, "high") )
+                mode = TRIG_HIGH;
+            else if( strcomp(edge, "low") )
+                mode = TRIG_LOW;
+
+            if( mode == TRIG_NONE )
+                putsUart0("ERROR: Trigger must be rise, fall, high or low.\n");
+            else
+                setScopeTrigger(mode, getFieldInteger(data, 1) - 1, getFieldFloat(data, 2) * 4095.0 / 3.3);
+        }
+        else
+            putsUart0("ERROR: Invalid command for 'trigger'.\n");
+    }
+    else if( isCommand(data, "capture", 1) )
+    {
+        // capture RATE [PAIRS] [PRE], dumps a binary frame (see scope.c)
+        int32_t pairs = isCommand(data, "capture", 2) ? getFieldInteger(data, 2) : SCOPE_PAIRS;
+        int32_t pre = isCommand(data, "capture", 3) ? getFieldInteger(data, 3) : 0;
+
+        spectrumValid = false;
+        if( pairs <= 0 || pre < 0 || !runScope(getFieldInteger(data, 1), pairs, pre) )
+            putsUart0(isScopeStalled() ? "ERROR: No capture data arrived.\n" : "ERROR: Invalid command for 'capture'.\n");
+        else
+            sendScopeFrame();
+    }
+    else if( isCommand(data, "spectrum", 1) )
+    {
+        // spectrum RATE [POINTS] [IN] [PEAKS] | spectrum bins | spectrum window hann|none
+        int32_t points = isCommand(data, "spectrum", 2) ? getFieldInteger(data, 2) : SPECTRUM_DEFAULT_POINTS;
+        int32_t input = isCommand(data, "spectrum", 3) ? getFieldInteger(data, 3) : 1;
+        int32_t peaks = isCommand(data, "spectrum", 4) ? getFieldInteger(data, 4) : SPECTRUM_DEFAULT_PEAKS;
+
+        if( strcomp(getFieldString(data, 1), "bins") )
+        {
+            if( spectrumValid )
+                spectrumBins();
+            else
+                putsUart0("ERROR: No spectrum to dump.\n");
+        }
+        else if( strcomp(getFieldString(data, 1), "window") && isCommand(data, "spectrum", 2) )
+        {
+            if( strcomp(getFieldString(data, 2), "hann") )
+                spectrumWindow = true;
+            else if( strcomp(getFieldString(data, 2), "none") )
+                spectrumWindow = false;
+            else
+                putsUart0("ERROR: Window must be hann or none.\n");
+        }
+        else if( points < FFT_MIN_POINTS || points > FFT_MAX_POINTS || (points & (points - 1)) != 0 )
+            putsUart0("ERROR: POINTS must be 256, 512 or 1024 (the capture buffer holds 1024 pairs).\n");
+        else if( (input != 1 && input != 2) || peaks < 0 || peaks > FFT_MAX_PEAKS
+                 || !spectrumAnalyze(getFieldInteger(data, 1), points, input - 1, peaks) )
+            putsUart0(isScopeStalled() ? "ERROR: No capture data arrived.\n" : "ERROR: Invalid command for 'spectrum'.\n");
+    }
+
+    /*  =============================== *
+     *  ||||||||| R E S E T ||||||||||| *
+     *  =============================== */
+    else if( isCommand(data, "reset", 0) )
+    {
+        NVIC_APINT_R = NVIC_APINT_VECTKEY | NVIC_APINT_SYSRESETREQ;
+    }
+	
+	/*  =============================== *
+     *  |||||||| V O L T A G E |||||||| *
+     *  =============================== */
+    else if( isCommand(data, "voltage", 1) )
+    {
+        dac = (DAC)getFieldInteger(data, 1);
+		
+		// OUT A is watched on IN2, OUT B on IN1
+		if(dac != DAC_A && dac != DAC_B)
+			putsUart0("ERROR: Invalid command for 'voltage'.\n");
+		else if(isCapturing())
+			putsUart0("ERROR: Capture is running, use 'sample OFF' or 'measure stop' first.\n");
+		// kept in 100 uV steps to print without floats
+		else if(!readInputVoltage(dac == DAC_A ? 1 : 0, &adcTenthMillivolts))
+			putsUart0("ERROR: No capture data arrived.\n");
+		else
+		{
+			putsUart0(dac == DAC_A ? "IN2: " : "IN1: ");
+			putFixedUart0(adcTenthMillivolts, 4);
+			putsUart0(" V\n");
+		}
+    }
+    else if( isCommand(data, "measure", 0) )
+    {
+        // measure | measure start RATE [WINDOW_MS] | measure stop
+        if( data->fieldCount == 1 )
+            printMeasure();
+        else if( strcomp(getFieldString(data, 1), "stop") )
+        {
+            if( isMeterRunning() )
+                stopCapture();
+            setCaptureBlockHandler(0);
+        }
+        else if( !strcomp(getFieldString(data, 1), "start") || !isCommand(data, "measure", 2)
+                 || !startMeasure(getFieldInteger(data, 2),
+                                  isCommand(data, "measure", 3) ? getFieldInteger(data, 3) : METER_DEFAULT_WINDOW_MS) )
+            putsUart0("ERROR: Invalid command for 'measure'.\n");
+    }
+    else if( isCommand(data, "decimate", 0) )
+    {
+        // decimate [RATIO], CIC ratio for every capture, 1 is off
+        if( data->fieldCount > 1 && !setCaptureDecimation(getFieldInteger(data, 1)) )
+            putsUart0("ERROR: Ratio must be 1 or a power of two from 4 to 256.\n");
+        else
+        {
+            putsUart0("Decimation: ");
+            putuUart0(getCaptureDecimation());
+            putsUart0(", max rate ");
+            putuUart0(getCaptureMaxRate());
+            putsUart0(" Hz\n");
+        }
+    }
+
+    /*  ============================= *
+     *  ||||||| M A C R O S ||||||||| *
+     *  ============================= */
+    else if( isCommand(data, "record", 1) )
+    {
+        if( beginMacro(getFieldString(data, 1)) )
+            putsUart0("Recording macro, 'end' to save.\n");
+        else
+            putsUart0("ERROR: Could not start macro.\n");
+    }
+    else if( isCommand(data, "end", 0) )
+    {
+        if( !isRecordingMacro() )
+            putsUart0("ERROR: Not recording a macro.\n");
+        else if( endMacro() )
+            putsUart0("Macro saved.\n");
+        else
+            putsUart0("ERROR: No free macro slot.\n");
+    }
+    else if( isCommand(data, "play", 1) )
+    {
+        if( findMacro(getFieldString(data, 1)) == MACRO_NONE )
+            putsUart0("ERROR: Macro not found.\n");
+        else
+            playMacro(findMacro(getFieldString(data, 1)));
+    }
+    else if( isCommand(data, "macro", 1) )
+    {
+        if( strcomp(getFieldString(data, 1), "list") )
+            listMacros();
+        else if( strcomp(getFieldString(data, 1), "delete") && deleteMacro(getFieldString(data, 2)) )
+            putsUart0("Macro deleted.\n");
+        else if( strcomp(getFieldString(data, 1), "boot") && setBootMacro(getFieldString(data, 2)) )
+            putsUart0("Boot macro set.\n");
+        else
+            putsUart0("ERROR: Invalid command for 'macro'.\n");
+    }
+
+    // Waits in Timer4 ticks while the generator runs, so macro steps line up with the output
+    else if( isCommand(data, "wait", 1) )
+    {
+        if( getFieldFixed(data, 1, SCALE_MICRO, &waitUs) != NUM_OK || waitUs < 0 )
+            putsUart0("ERROR: Invalid time for 'wait'.\n");
+        else if( TIMER4_CTL_R & TIMER_CTL_TAEN )
+        {
+            uint32_t start = tickCount;
+            uint32_t ticks = ((uint64_t)waitUs * SYSTEM_CLOCK_MHZ) / (TIMER4_TAILR_R + 1);
+            while( tickCount - start < ticks );
+        }
+        else
+            waitMicrosecond(waitUs);
+    }
+
+    /*  ============================= *
+     *  ||||||||| S A M P L E ||||||| *
+     *  ============================= */
+    else if( isCommand(data, "sample", 0) )
+    {
+        if( data->fieldCount == 1 )
+        {
+            uint16_t* block = getCaptureBlock();
+            uint32_t sum1 = 0, sum2 = 0;
+
+            putsUart0("Rate: ");
+            putuUart0(isCapturing() ? getCaptureRate() : 0);
+            putsUart0(" Hz\nBlocks: ");
+            putuUart0(getCaptureBlockCount());
+            putsUart0("\nOverruns: ");
+            putuUart0(getCaptureOverruns());
+            putcUart0('\n');
+            if( block != 0 )
+            {
+                for(i = 0; i < CAPTURE_SAMPLES; i += 2)
+                {
+                    sum1 += block[i];
+                    sum2 += block[i + 1];
+                }
+                putsUart0("IN1: ");
+                putFixedUart0(((sum1 / CAPTURE_PAIRS) >> getCaptureShift()) * 3300 / 4095, 3);
+                putsUart0(" V\nIN2: ");
+                putFixedUart0(((sum2 / CAPTURE_PAIRS) >> getCaptureShift()) * 3300 / 4095, 3);
+                putsUart0(" V\n");
+            }
+        }
+        else if( strcomp(getFieldString(data, 1), "OFF") )
+            stopCapture();
+        else if( !startCapture(getFieldInteger(data, 1)) )
+            putsUart0("ERROR: Invalid rate for 'sample'.\n");
+    }
+
+    /*  ============================= *
+     *  ||||||||| B A U D ||||||||||| *
+     *  ============================= */
+    else if( isCommand(data, "baud", 0) )
+    {
+        if( data->fieldCount == 1 )
+        {
+            putsUart0("Baud: ");
+            putuUart0(uartBaud);
+            putcUart0('\n');
+        }
+        else if( strcomp(getFieldString(data, 1), "auto") )
+            autoBaud();
+        else if( getFieldInteger(data, 1) > 0 )
+            changeBaud(getFieldInteger(data, 1));
+        else
+            putsUart0("ERROR: Invalid argument for 'baud'.\n");
+    }
+
+    else if( isCommand(data, "bench", 0) )
+    {
+        // bench [CASE] [RUNS] [json], cycles per call of each hot path
+        char* name = 0;
+        int32_t runs = BENCH_DEFAULT_RUNS;
+        bool json = false;
+        
+        for(i = 1; i < data->fieldCount; i++)
+        {
+            if( strcomp(getFieldString(data, i), "json") )
+                json = true;
+            else if( data->fieldType[i] == 'n' )
+                runs = getFieldInteger(data, i);
+            else if( !strcomp(getFieldString(data, i), "all") )
+                name = getFieldString(data, i);
+        }
+        
+        if( TIMER4_CTL_R & TIMER_CTL_TAEN || stagedEN )
+            putsUart0("ERROR: Use 'stop' (and 'commit' or 'abort') before 'bench', it rewrites OUT A.\n");
+        else if( runs < 1 || runs > BENCH_MAX_SAMPLES )
+            putsUart0("ERROR: Runs must be 1 to 128.\n");
+        else if( !runBench(name, runs, json) )
+            putsUart0("ERROR: Unknown case, try sine square sawtooth triangle output2r float2uint parse field tick.\n");
+    }
+
+    else if( isCommand(data, "headroom", 0) )
+    {
+        // headroom [RATE], predicted tick cost against the running or a proposed rate
+        if( isCommand(data, "headroom", 1) && (getFieldInteger(data, 1) <= 0 || (uint32_t)getFieldInteger(data, 1) > SYSTEM_CLOCK_HZ) )
+            putsUart0("ERROR: Invalid rate for 'headroom'.\n");
+        else
+            printHeadroom(isCommand(data, "headroom", 1) ? getFieldInteger(data, 1) : 0);
+    }
+
+    else if( isCommand(data, "selftest", 0) )
+    {
+        // selftest [CASE], renders each waveform and mode in memory and checks its spectrum
+        if( TIMER4_CTL_R & TIMER_CTL_TAEN || stagedEN || isCapturing() )
+            putsUart0("ERROR: Use 'stop' and stop any capture before 'selftest', it rewrites the tables.\n");
+        else if( !runSelfTests(isCommand(data, "selftest", 1) && !strcomp(getFieldString(data, 1), "all") ? getFieldString(data, 1) : 0) )
+            putsUart0("ERROR: Unknown case, try sine square sawtooth triangle differential hilbert cycles.\n");
+    }
+
+    else if( isCommand(data, "status", 0) )
+    {
+        printStatus();
+    }
+    else if( isCommand(data, "script", 1) )
+    {
+        // script ON | OFF, terse framing for host scripts
+        if( strcomp(getFieldString(data, 1), "ON") )
+            scriptMode = true;
+        else if( strcomp(getFieldString(data, 1), "OFF") )
+            scriptMode = false;
+        else
+            putsUart0("ERROR: Invalid command for 'script'.\n");
+    }
+
+    else if( isCommand(data, "trace", 0) )
+    {
+        // trace | trace bin | trace clear | trace on|off [EVENT|all] | trace mask
+        if( data->fieldCount == 1 )
+            dumpTrace(false);
+        else if( strcomp(getFieldString(data, 1), "bin") )
+            dumpTrace(true);
+        else if( strcomp(getFieldString(data, 1), "clear") )
+            clearTrace();
+        else if( strcomp(getFieldString(data, 1), "mask") )
+            printTraceMask();
+        else if( (strcomp(getFieldString(data, 1), "on") && setTraceMask(data, true))
+                 || (strcomp(getFieldString(data, 1), "off") && setTraceMask(data, false)) )
+            printTraceMask();
+        else
+            putsUart0("ERROR: Invalid command for 'trace', events are cmd done lut lutdone swap cycles overrun uart.\n");
+    }
+
+    else if( isCommand(data, "load", 0) )
+    {
+        printLoad();
+    }
+
+    else if( isCommand(data, "save", 0) )
+    {
+        // save | save boot ON|OFF | save clear | save status
+        if( data->fieldCount == 1 )
+        {
+            GEN_STATE state;
+            
+            if(stagedEN)
+                putsUart0("ERROR: 'commit' or 'abort' before 'save'.\n");
+            else
+            {
+                getGenState(&state);
+                saveState(&state);
+                putsUart0("Saved, CRC ");
+                putxUart0(getStateCrc(), 8);
+                putcUart0('\n');
+            }
+        }
+        else if( strcomp(getFieldString(data, 1), "boot") && isCommand(data, "save", 2) && strcomp(getFieldString(data, 2), "ON") )
+            setStateBoot(true);
+        else if( strcomp(getFieldString(data, 1), "boot") && isCommand(data, "save", 2) && strcomp(getFieldString(data, 2), "OFF") )
+            setStateBoot(false);
+        else if( strcomp(getFieldString(data, 1), "clear") )
+            clearState();
+        else if( strcomp(getFieldString(data, 1), "status") )
+            printSaveStatus();
+        else
+            putsUart0("ERROR: Invalid command for 'save'.\n");
+    }
+    else if( isCommand(data, "restore", 0) )
+    {
+        STATE_RESULT result;
+        uint32_t start = CYCLE_COUNT;
+        
+        if(stagedEN)
+            putsUart0("ERROR: 'commit' or 'abort' before 'restore'.\n");
+        else if( !restoreGenState(&result) )
+        {
+            putsUart0("ERROR: No saved state (");
+            putsUart0(getStateResultName(result));
+            putsUart0(").\n");
+        }
+        else
+        {
+            putsUart0("Restored in ");
+            putFixedUart0((CYCLE_COUNT - start) / SYSTEM_CLOCK_MHZ, 3);
+            putsUart0(" ms.\n");
+        }
+    }
+
+    /*  ============================= *
+     *  ||||||||| H E L P ||||||||||| *
+     *  ============================= */
+    else if( isCommand(data, "help", 0) )
+    {
+        putsUart0("Possible Commands:\n");
+        putsUart0("Numbers accept sign, decimals, exponent and p n u m k M (e.g. 1.5k, -250m)\n");
+        putsUart0("dc OUT, VOLTAGE\n");
+        putsUart0("cycles OUT, N\n");
+        putsUart0("sine OUT, FREQ, AMP, [OFS]\n");
+		putsUart0("square OUT, FREQ, AMP, [OFS] [D.C.]\n");
+		putsUart0("sawtooth OUT, FREQ, AMP, [OFS]\n");
+		putsUart0("triangle OUT, FREQ, AMP, [OFS]\n");
+		putsUart0("begin / commit / abort (stage changes, apply together; no run, stop, differential or hilbert until commit)\n");
+		putsUart0("baud [RATE|auto]\n");
+		putsUart0("record NAME ... end, play NAME, macro list|delete NAME|boot NAME|off\n");
+		putsUart0("wait TIME\n");
+		putsUart0("sample [RATE|OFF]\n");
+		putsUart0("decimate [RATIO] (1, 4 ... 256)\n");
+		putsUart0("voltage OUT\n");
+		putsUart0("measure | measure start RATE, [WINDOW_MS] | measure stop\n");
+		putsUart0("gain F0, F1\n");
+		putsUart0("tone FREQ [FREQ...] (up to 4)\n");
+		putsUart0("trigger none | trigger IN, LEVEL, rise|fall|high|low\n");
+		putsUart0("capture RATE, [PAIRS] [PRE]\n");
+		putsUart0("spectrum RATE, [POINTS] [IN] [PEAKS] | spectrum bins | spectrum window hann|none (POINTS 256 ... 1024)\n");
+		putsUart0("bode F0, F1, POINTS_PER_DECADE, [SETTLE] [CYCLES] | bode csv|bin\n");
+		putsUart0("level ON|OFF|status | level bw HZ (trims waveforms played by 'run')\n");
+		putsUart0("load (CPU percent per ISR and shell, last second)\n");
+		putsUart0("trace | trace bin|clear|mask | trace on|off [EVENT|all]\n");
+		putsUart0("status (key=value readback of both outputs)\n");
+		putsUart0("script ON|OFF (no prompt, responses end with a '.' line)\n");
+		putsUart0("save | save boot ON|OFF | save clear|status, restore (settings in EEPROM, rebuilt at boot)\n");
+		putsUart0("selftest [CASE|all] (outputs stopped, checks rendered waveforms)\n");
+		putsUart0("headroom [RATE] (tick cost model against the DDS rate)\n");
+		putsUart0("bench [CASE|all] [RUNS] [json] (outputs stopped, leaves OUT A's table rewritten)\n");
+    }
+    else
+    {
+        putsUart0("ERROR: Command not found. Try 'help' for options.\n");
+    }
+}
+
+// Replays a stored macro line by line
+void playMacro(int8_t slot)
+{
+    USER_DATA line;
+
+    if( !loadMacro(slot) )
+    {
+        putsUart0("ERROR: Could not load macro.\n");
+        return;
+    }
+    while( nextMacroLine(&line) )
+    {
+        processCommand(&line);
+        putcUart0('\n');
+    }
+}
+
+
+int main(void)
+{
+    int8_t bootMacro;
+    STATE_RESULT restored = STATE_OK;
+
     initHw();
+    startLoad(&load, CYCLE_COUNT);
+    setCaptureCycleCounter(&load.total[LOAD_CAPTURE]);
+    initMacros();
+    initLockin();
+    initLevel(&levelA, OUT_OFFSET_A + OUT_SLOPE_A * DAC_OFFSET_A, OUT_SLOPE_A * DAC_SLOPE_A, IN_OFFSET_A, IN_SLOPE_A);
+    initLevel(&levelB, OUT_OFFSET_B + OUT_SLOPE_B * DAC_OFFSET_B, OUT_SLOPE_B * DAC_SLOPE_B, IN_OFFSET_B, IN_SLOPE_B);
+
+    // Saved state first, the outputs resume before the boot macro and the start up light
+    if( getStateBoot() && restoreGenState(&restored) )
+        bootCycles = CYCLE_COUNT;
+    else
+    {
+        selectOutputVoltage(DAC_A, 0);
+        selectOutputVoltage(DAC_B, 0);
+    }
 
-    // For filling list of commands and executing them all together
-    /*instruction inst_arr[MAX_INSTRUCTIONS];
-    int8_t inst_index = 0;
-    bool inst_max = false;*/
+    // Boot macro runs before anything slow so outputs are configured right after reset
+    bootMacro = getBootMacro();
+    if(bootMacro != MACRO_NONE)
+        playMacro(bootMacro);
 
     // Start Up Light
     setPinValue(GREEN_LED, 1);
@@ -614,20 +2766,8 @@ int main(void)
 
     // Command Line Processing Info
     USER_DATA data;
-    char buffer[MAX_CHARS + 1];
+    uint32_t busyStart, isrStart;
 	
-	
-	DAC dac = DAC_INVALID;
-    float voltage = 0, freq = 0, amp = 1, ofs = 0;
-	uint8_t dutyCycle = 50;
-	float freq_ref = (((float)40e6 / (float)TIMER4_TAILR_R)) * (1.0 / (float)LUT_SIZE);
-	int32_t testValue = 0;
-	float adcValue3, adcValue2;
-	uint16_t i;
-	
-	selectOutputVoltage(DAC_A, 0);
-	selectOutputVoltage(DAC_B, 0);
-
 	/* calculateWave(SINE, DAC_A, 1, 0);
 	freq = 20000;
 	phaseAccum_A = float2uint( freq/freq_ref );
@@ -635,6 +2775,18 @@ int main(void)
 	//while(1);
 	
 	putsUart0("|Signal Generator START|\n");
+	if(bootCycles)
+	{
+		putsUart0("Saved state restored, output ");
+		putFixedUart0(bootCycles / SYSTEM_CLOCK_MHZ, 3);
+		putsUart0(" ms after the PLL locked\n");
+	}
+	else if(restored != STATE_OK)
+	{
+		putsUart0("Saved state not restored (");
+		putsUart0(getStateResultName(restored));
+		putsUart0(")\n");
+	}
 #ifdef DEBUG
 	putsUart0("DEBUG DEFINED\n");
 #endif
@@ -642,17 +2794,17 @@ int main(void)
     // Start of Shell
     while( 1 )
     {
-		ofs = 0;
-		amp = 1;
-		freq = 0;
-		voltage = 0;
-		dutyCycle = 50;
-
-        putcUart0('>');
+        if(!scriptMode)
+            putcUart0('>');
         setPinValue(BLUE_LED, 1);
         // Fills up buffer in data and waits for max characters or RETURN
         getsUart0(&data);
         setPinValue(BLUE_LED, 0);
+        busyStart = CYCLE_COUNT;
+        isrStart = getLoadIsrTotal(&load);
+        if(checkUart0Overrun())
+            traceEvent(TRACE_UART_OVERFLOW, 0);
+        traceEvent(TRACE_COMMAND, data.buffer[0] << 8 | data.buffer[1]);
 
         // Separates fields into Numeric, Upper Alpha, Lower Alpha, and Floats
         parseFields(&data);
@@ -675,417 +2827,26 @@ int main(void)
          *   SHELL COMMANDS   *
          * ================== */
 
-        /*  ======================= *
-         *  ||||||||| D C ||||||||| *
-         *  ======================= */
-        if( isCommand(&data, "dc", 2) )
-        {
-            dac = (DAC)getFieldInteger(&data, 1);
-            voltage = getFieldFloat(&data, 2);
-			
-#ifdef DEBUG
-            sprintf(buffer, "DAC: %u\tVoltage: %f\n", dac, voltage);
-            putsUart0(buffer);
-#endif
-
-			if( (dac <= 2) && selectOutputVoltage(dac, voltage) )
-				putsUart0("Successfully wrote to DAC.");
-			else
-				putsUart0("ERROR: Could not write DC Voltage to DAC.");
-
-        }
-		
-		/*  ======================= *
-         *  ||| R U N / S T O P ||| *
-         *  ======================= */
-        else if( isCommand(&data, "run", 0) )
-        {
-			currentCycles_A = 0;
-			currentCycles_B = 0;
-			lut_i_A = 0;
-			lut_i_B = 0;
-			outA_EN = true;
-			outB_EN = true;
-            TIMER4_CTL_R |= TIMER_CTL_TAEN;
-        }
-		else if( isCommand(&data, "stop", 0) )
-		{
-			selectOutputVoltage(DAC_A, 0);
-			selectOutputVoltage(DAC_B, 0);
-			TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
-		}
-		
-		/*  ======================= *
-         *  |||||||| D A C |||||||| *
-         *  ======================= */
-        else if( isCommand(&data, "dac", 2) )
-        {
-            dac = (DAC)getFieldInteger(&data, 1);
-            voltage = getFieldFloat(&data, 2);
-			
-#ifdef DEBUG
-            sprintf(buffer, "Float: %f\n", voltage);
-            putsUart0(buffer);
-#endif
-
-			if( (dac <= 2 && voltage != -1) && selectDACVoltage(dac, voltage) )
-				putsUart0("Successfully wrote to DAC.");
-			else
-				putsUart0("ERROR: Could not write DC Voltage to DAC.");
-
-        }
-		
-		/*  ======================= *
-         *  ||||| C Y C L E S ||||| *
-         *  ======================= */
-        else if( isCommand(&data, "cycles", 1) )
+        // Rejects malformed numbers (e.g. "1x", "2.5q") before any command runs
+        if( !checkNumericFields(&data) )
         {
-			if(data.fieldType[1] == 'n')
-			{
-				if(getFieldInteger(&data, 1) == 1)
-					maxCycles_A = getFieldInteger(&data, 2);
-				else if(getFieldInteger(&data, 1) == 2)
-					maxCycles_B = getFieldInteger(&data, 2);
-			}
-			else if(data.fieldType[1] == 'a' && strcomp(getFieldString(&data, 1), "continuous") )
-			{
-				maxCycles_A = -1;
-				maxCycles_B = -1;
-			}
-			else
-			{
-				putsUart0("ERROR: Invalid command for 'cycles'.");
-			}
         }
-		
-		/*  ======================= *
-         *  ||||||| S I N E ||||||| * 
-         *  ======================= */
-		else if( isCommand(&data, "sine", 3) )
-		{
-			dac = (DAC)getFieldInteger(&data, 1);
-			freq = getFieldFloat(&data, 2);
-			amp = getFieldFloat(&data, 3);
-			
-			if( isCommand(&data, "sine", 4) )
-				ofs = getFieldFloat(&data, 4);
-			
-#ifdef DEBUG
-			sprintf(buffer, "DAC: %u\tFreq: %f\tAmp: %f\tOFS: %f", dac, freq, amp, ofs);
-			putsUart0(buffer);
-#endif
-			if( dac <= 2 )
-			{
-				calculateWave(SINE, dac, amp, ofs, dutyCycle);
-				putsUart0("Successfully calculated Sine wave.");
-				if(dac == DAC_A)
-					phaseAccum_A = float2uint(freq / freq_ref);
-				
-				if(dac == DAC_B && !differentialEN)
-					phaseAccum_B = float2uint(freq / freq_ref);
-				
-				if(differentialEN || hilbertEN)
-					phaseAccum_B = phaseAccum_A;
-				
-				TIMER4_CTL_R |= TIMER_CTL_TAEN;
-			}
-			else
-				putsUart0("ERROR: invalid argument for 'sine'.");
-		}
-		
-		
-		/*  ======================= *
-         *  ||||| S Q U A R E ||||| * 
-         *  ======================= */
-		else if( isCommand(&data, "square", 3) )
-		{
-			dac = (DAC)getFieldInteger(&data, 1);
-			freq = getFieldFloat(&data, 2);
-			amp = getFieldFloat(&data, 3);
-			
-			if( isCommand(&data, "square", 4) )
-				ofs = getFieldFloat(&data, 4);
-			
-			if( isCommand(&data, "square", 5) )
-				dutyCycle = getFieldInteger(&data, 5);
-			
-			sprintf(buffer, "DAC: %u\nFreq: %f\nAmp: %f\nOFS: %f\nD.C.: %d\%%\n\n", dac, freq, amp, ofs, dutyCycle);
-			putsUart0(buffer);
-
-			if( dac <= 2 )
-			{
-				calculateWave(SQUARE, dac, amp, ofs, dutyCycle);
-				putsUart0("Successfully calculated Square wave.");
-				if(dac == DAC_A)
-					phaseAccum_A = float2uint(freq / freq_ref);
-				else if(dac == DAC_B)
-					phaseAccum_B = float2uint(freq / freq_ref);
-				if(differentialEN)
-					phaseAccum_B = phaseAccum_A;
-				TIMER4_CTL_R |= TIMER_CTL_TAEN;
-			}
-			else if( strcomp(getFieldString(&data, 1), "stop") )
-			{
-				TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
-			}
-			else
-				putsUart0("ERROR: invalid argument for 'square'.");
-		}
-		
-		/*  ======================= *
-         *  |||||||| S A W |||||||| * 
-         *  ======================= */
-		else if( isCommand(&data, "sawtooth", 3) )
-		{
-			dac = (DAC)getFieldInteger(&data, 1);
-			freq = getFieldFloat(&data, 2);
-			amp = getFieldFloat(&data, 3);
-			
-			if( isCommand(&data, "sawtooth", 4) )
-				ofs = getFieldFloat(&data, 4);
-			
-#ifdef DEBUG
-			sprintf(buffer, "DAC: %u\tFreq: %f\tAmp: %f\tOFS: %f", dac, freq, amp, ofs);
-			putsUart0(buffer);
-#endif
-			if( dac <= 2 )
-			{
-				calculateWave(SAW, dac, amp, ofs, dutyCycle);
-				putsUart0("Successfully calculated Sawtooth wave.");
-				if(dac == DAC_A)
-					phaseAccum_A = float2uint(freq / freq_ref);
-				else if(dac == DAC_B)
-					phaseAccum_B = float2uint(freq / freq_ref);
-				if(differentialEN)
-					phaseAccum_B = phaseAccum_A;
-				TIMER4_CTL_R |= TIMER_CTL_TAEN;
-			}
-			else if( strcomp(getFieldString(&data, 1), "stop") )
-			{
-				TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
-			}
-			else
-				putsUart0("ERROR: invalid argument for 'sawtooth'.");
-		}
-		
-		/*  ======================= *
-         *  |||||||| T R I |||||||| * 
-         *  ======================= */
-		else if( isCommand(&data, "triangle", 3) )
-		{
-			dac = (DAC)getFieldInteger(&data, 1);
-			freq = getFieldFloat(&data, 2);
-			amp = getFieldFloat(&data, 3);
-			
-			if( isCommand(&data, "triangle", 4) )
-				ofs = getFieldFloat(&data, 4);
-			
-#ifdef DEBUG
-			sprintf(buffer, "DAC: %u\tFreq: %f\tAmp: %f\tOFS: %f", dac, freq, amp, ofs);
-			putsUart0(buffer);
-#endif
-			if( dac <= 2 )
-			{
-				calculateWave(TRI, dac, amp, ofs, dutyCycle);
-				putsUart0("Successfully calculated Triangle wave.");
-				if(dac == DAC_A)
-					phaseAccum_A = float2uint(freq / freq_ref);
-				else if(dac == DAC_B)
-					phaseAccum_B = float2uint(freq / freq_ref);
-				TIMER4_CTL_R |= TIMER_CTL_TAEN;
-				if(differentialEN)
-					phaseAccum_B = phaseAccum_A;
-			}
-			else if( strcomp(getFieldString(&data, 1), "stop") )
-			{
-				TIMER4_CTL_R &= ~TIMER_CTL_TAEN;
-			}
-			else
-				putsUart0("ERROR: invalid argument for 'triangle'.");
-		}
 
-        /*  ======================== *
-         *  ||||||| T E S T |||||||| *
-         *  ======================== */
-        else if( isCommand(&data, "test", 1) )
+        else if( isRecordingMacro() && !isCommand(&data, "end", 0) )
         {
-            if( strcomp(getFieldString(&data, 1), "DAC") )
-            {
-                putsUart0("Testing DAC Voltages...\n");
-				
-				testValue = 0xFFF;
-				sprintf(buffer, "test value: %x\n", testValue);
-				putsUart0(buffer);
-				setPinValue(RED_LED, 1);
-				setPinValue(BLUE_LED, 1);
-				writeSpi1Data(0x3000 | testValue);
-				writeSpi1Data(0xB000 | testValue);
-				latchDAC();
-				waitMicrosecond(4000000);
-				
-				for(testValue = 0xF00; testValue >= 0; testValue -= 0x100)
-				{
-					sprintf(buffer, "test value: %x\n", testValue);
-					putsUart0(buffer);
-					setPinValue(RED_LED, !getPinValue(RED_LED) );
-					setPinValue(BLUE_LED, !getPinValue(BLUE_LED) );
-					writeSpi1Data(0x3000 | testValue);
-					writeSpi1Data(0xB000 | testValue);
-					latchDAC();
-					waitMicrosecond(4000000);
-				}
-				
-				setPinValue(RED_LED, 0);
-				setPinValue(BLUE_LED, 0);
-				
-            }
-			else if( strcomp(getFieldString(&data, 1), "adc" ) )
-			{
-				if( strcomp(getFieldString(&data, 2), "ON" ) )
-					TIMER2_CTL_R |= TIMER_CTL_TAEN;
-				else if( strcomp(getFieldString(&data, 2), "OFF" ) )
-				{
-					TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
-					setPinValue(GREEN_LED, 0);
-				}
-			}
-			
+            if( isCommand(&data, "record", 0) || isCommand(&data, "play", 0) || isCommand(&data, "macro", 0) )
+                putsUart0("ERROR: Macros cannot record macro commands.\n");
+            else if( addMacroLine(&data) )
+                putsUart0("  stored");
             else
-            {
-                putsUart0("ERROR: Invalid argument for 'test'.");
-            }
-        }
-		
-		/*  =============================== *
-         *  ||||||||||| D I F F ||||||||||| *
-         *  =============================== */
-        else if( isCommand(&data, "differential", 1) )
-        {
-            if( strcomp(getFieldString(&data, 1), "ON") )
-			{
-				putsUart0("Differential enabled. Please enter waveform on DAC A.\n");
-				differentialEN = true;
-			}
-			else if( strcomp(getFieldString(&data, 1), "OFF") )
-			{
-				putsUart0("Differential disabled. Normal behavior resumed.\n");
-				differentialEN = false;
-			}
-			else
-				putsUart0("ERROR: Invalid command for 'differential'.\n");
-        }
-		
-		/*  =============================== *
-         *  |||||||| H I L B E R T |||||||| *
-         *  =============================== */
-        else if( isCommand(&data, "hilbert", 1) )
-        {
-            if( strcomp(getFieldString(&data, 1), "ON") )
-			{
-				hilbertEN = true;
-				putsUart0("Hilbert enabled. Please enter sine wave on DAC A.\n");
-				//lut_i_B = (LUT_SIZE/4) << INTEGER_BITS;
-			}
-			else if( strcomp(getFieldString(&data, 1), "OFF") )
-				hilbertEN = false;
-			else
-				putsUart0("ERROR: Invalid command for 'hilbert'.\n");
-        }
-		
-		/*  =============================== *
-         *  |||||||||| L E V E L |||||||||| *
-         *  =============================== */
-        else if( isCommand(&data, "level", 1) )
-        {
-			// output DC voltage
-			// see what input is
-			// find percent drop across the load
-			// add (1.00 + percentage) * voltage difference to get new output voltage
-            if( strcomp(getFieldString(&data, 1), "ON") )
-			{
-				
-			}
-			else if( strcomp(getFieldString(&data, 1), "OFF") )
-			{
-				
-			}
-			else
-				putsUart0("ERROR: Invalid command for 'level'.\n");
-        }
-		
-		/*  =============================== *
-         *  ||||||||||| G A I N ||||||||||| *
-         *  =============================== */
-        else if( isCommand(&data, "gain", 1) )
-        {
-			// create freq array of requested range (log)
-			// output sine wave at freq...
-			//...wait for a second, measure voltage value for each channel
-			// calculate gain from both channels
-			// create table, graph gain plot
-			
-			outA_EN = false;
-			outB_EN = false;
-			TIMER4_CTL_R |= TIMER_CTL_TAEN;
-			calculateWave(SINE, DAC_A, 2, 0, dutyCycle);
-			for(i = 0; i < LUT_SIZE; i++)
-				lutB[i] = lutA[i];
-			
-			freqSweep(getFieldFloat(&data, 1), getFieldFloat(&data, 2) );
-			
-			//putsUart0("ERROR: Invalid command for 'gain'.\n");
-        }
-
-        /*  =============================== *
-         *  ||||||||| R E S E T ||||||||||| *
-         *  =============================== */
-        else if( isCommand(&data, "reset", 0) )
-        {
-            NVIC_APINT_R = NVIC_APINT_VECTKEY | NVIC_APINT_SYSRESETREQ;
-        }
-		
-		/*  =============================== *
-         *  |||||||| V O L T A G E |||||||| *
-         *  =============================== */
-        else if( isCommand(&data, "voltage", 1) )
-        {
-            dac = (DAC)getFieldInteger(&data, 1);
-			
-			// multiply this value by .8 mV | .0008
-			if(dac == DAC_A)
-			{
-				adcValue2 = (float)readAdc0Ss2() * 3.3 / 4095.0;
-				sprintf(buffer, "SS2: %f V\n", adcValue2);
-				putsUart0(buffer);
-			}
-			
-			if(dac == DAC_B)
-			{
-				adcValue3 = (float)readAdc0Ss3() * 3.3 / 4095.0;
-				sprintf(buffer, "SS3: %f V\n", adcValue3);
-				putsUart0(buffer);
-			}
-        }
-
-        /*  ============================= *
-         *  ||||||||| H E L P ||||||||||| *
-         *  ============================= */
-        else if( isCommand(&data, "help", 0) )
-        {
-            putsUart0("Possible Commands:\n");
-            putsUart0("dc OUT, VOLTAGE\n");
-            putsUart0("cycles OUT, N\n");
-            putsUart0("sine OUT, FREQ, AMP, [OFS]\n");
-			putsUart0("square OUT, FREQ, AMP, [OFS] [D.C.]\n");
-			putsUart0("sawtooth OUT, FREQ, AMP, [OFS]\n");
-			putsUart0("triangle OUT, FREQ, AMP, [OFS]\n");
+                putsUart0("ERROR: Macro is full, 'end' to save what fits.\n");
         }
         else
-        {
-            putsUart0("ERROR: Command not found. Try 'help' for options.\n");
-        }
+            processCommand(&data);
+        traceEvent(TRACE_DISPATCHED, data.buffer[0] << 8 | data.buffer[1]);
 
         data_flush(&data);
-        putcUart0('\n');
+        putsUart0(scriptMode ? "\n.\n" : "\n");
+        addLoad(&load, LOAD_SHELL, (CYCLE_COUNT - busyStart) - (getLoadIsrTotal(&load) - isrStart));
     }
 }
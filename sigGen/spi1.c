@@ -92,6 +92,8 @@ void setSpi1Mode(uint8_t polarity, uint8_t phase)
 }
 
 // Blocking function that writes data and waits until the tx buffer is empty
+// Copied to SRAM at boot (.TI.ramfunc), it runs twice in every DDS tick
+#pragma CODE_SECTION(writeSpi1Data, ".TI.ramfunc")
 void writeSpi1Data(uint32_t data)
 {
     SSI1_DR_R = data;
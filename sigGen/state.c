@@ -0,0 +1,106 @@
+/*
+ * state.c
+ *
+ *  One GEN_STATE record after the macros in EEPROM, guarded by a magic,
+ *  a layout version and a CRC-32. The record holds the settings the tables
+ *  were rendered from, not the tables, so a restore renders them again.
+ *
+ *  Words are rewritten only when they changed and the magic goes last,
+ *  a save cut short by a reset reads back as a bad CRC.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "state.h"
+#include "eeprom.h"
+
+#define HEADER_MAGIC (STATE_BASE + 0)
+#define HEADER_VERSION (STATE_BASE + 1)
+#define HEADER_BOOT (STATE_BASE + 2)
+#define HEADER_CRC (STATE_BASE + 3)
+#define RECORD_BASE (STATE_BASE + STATE_HEADER_WORDS)
+
+#define CRC_POLY 0xEDB88320 // reflected CRC-32, as zlib
+
+static char* const names[] =
+{
+    "ok", "empty", "old version", "bad CRC"
+};
+
+static uint32_t crc32(uint32_t* words, uint16_t count)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    uint8_t* bytes = (uint8_t*)words;
+    uint16_t i;
+    uint8_t bit;
+
+    for(i = 0; i < count * 4; i++)
+    {
+        crc ^= bytes[i];
+        for(bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (CRC_POLY & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void updateEeprom(uint16_t add, uint32_t data)
+{
+    if(readEeprom(add) != data)
+        writeEeprom(add, data);
+}
+
+void saveState(GEN_STATE* state)
+{
+    uint32_t* words = (uint32_t*)state;
+    uint16_t i;
+
+    for(i = 0; i < STATE_RECORD_WORDS; i++)
+        updateEeprom(RECORD_BASE + i, words[i]);
+    updateEeprom(HEADER_CRC, crc32(words, STATE_RECORD_WORDS));
+    updateEeprom(HEADER_VERSION, STATE_VERSION);
+    updateEeprom(HEADER_MAGIC, STATE_MAGIC);
+}
+
+STATE_RESULT loadState(GEN_STATE* state)
+{
+    uint32_t* words = (uint32_t*)state;
+    uint16_t i;
+
+    if(readEeprom(HEADER_MAGIC) != STATE_MAGIC)
+        return STATE_EMPTY;
+    if(readEeprom(HEADER_VERSION) != STATE_VERSION)
+        return STATE_OLD_VERSION;
+    for(i = 0; i < STATE_RECORD_WORDS; i++)
+        words[i] = readEeprom(RECORD_BASE + i);
+    if(crc32(words, STATE_RECORD_WORDS) != readEeprom(HEADER_CRC))
+        return STATE_BAD_CRC;
+    return STATE_OK;
+}
+
+// Forgets the record and turns the boot restore off
+void clearState(void)
+{
+    writeEeprom(HEADER_MAGIC, 0);
+    writeEeprom(HEADER_BOOT, 0);
+}
+
+// Erased EEPROM reads 0xFFFFFFFF, only an explicit 1 turns the restore on
+void setStateBoot(bool on)
+{
+    updateEeprom(HEADER_BOOT, on ? 1 : 0);
+}
+
+bool getStateBoot(void)
+{
+    return readEeprom(HEADER_BOOT) == 1;
+}
+
+char* getStateResultName(STATE_RESULT result)
+{
+    return result <= STATE_BAD_CRC ? names[result] : "?";
+}
+
+uint32_t getStateCrc(void)
+{
+    return readEeprom(HEADER_CRC);
+}
@@ -0,0 +1,65 @@
+/*
+ * state.h
+ *
+ *  Generator settings kept in EEPROM so the last configuration can be
+ *  rebuilt at boot without a host
+ */
+
+#ifndef STATE_H_
+#define STATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dds.h"
+#include "macro.h"
+
+// EEPROM layout (word addresses), after the macros
+// STATE_BASE + 0:  magic
+// STATE_BASE + 1:  version
+// STATE_BASE + 2:  boot flag, outside the CRC so it changes without a save
+// STATE_BASE + 3:  CRC-32 of the record
+// STATE_BASE + 4:  record, STATE_RECORD_WORDS words
+#define STATE_BASE MACRO_EEPROM_END
+#define STATE_MAGIC 0x47454E53 // "GENS"
+#define STATE_VERSION 1 // bump when GEN_STATE changes
+#define STATE_HEADER_WORDS 4
+#define STATE_RECORD_WORDS (sizeof(GEN_STATE) / 4) // 16 of the 48 words left after the macros
+
+// GEN_STATE flags
+#define STATE_RUN 0x01          // Timer 4 running
+#define STATE_OUT_A 0x02
+#define STATE_OUT_B 0x04
+#define STATE_DIFFERENTIAL 0x08
+#define STATE_HILBERT 0x10
+#define STATE_LEVEL 0x20
+
+typedef struct _GEN_STATE
+{
+    WAVE_PARAMS wave[2];    // A, B as in getWaveParams()
+    uint32_t phaseAccum[2];
+    int32_t maxCycles[2];
+    float levelGain[2];     // level control trims, only restored with STATE_LEVEL
+    float levelOffset[2];
+    float levelBandwidth;
+    uint32_t flags;
+} GEN_STATE;
+
+typedef enum _STATE_RESULT
+{
+    STATE_OK = 0,
+    STATE_EMPTY = 1,        // never saved or cleared
+    STATE_OLD_VERSION = 2,  // saved by a firmware with another GEN_STATE
+    STATE_BAD_CRC = 3
+} STATE_RESULT;
+
+void saveState(GEN_STATE* state);
+STATE_RESULT loadState(GEN_STATE* state);
+void clearState(void);
+
+void setStateBoot(bool on);
+bool getStateBoot(void);
+
+char* getStateResultName(STATE_RESULT result);
+uint32_t getStateCrc(void);
+
+#endif /* STATE_H_ */
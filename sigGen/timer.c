@@ -7,10 +7,10 @@
 
 // Target Platform: EK-TM4C123GXL
 // Target uC:       TM4C123GH6PM
-// System Clock:    40 MHz
+// System Clock:    -
 
 // Hardware configuration:
-// Timer 4
+// Timer 1 (ADC trigger), Timer 2, Timer 3, Timer 4
 
 //-----------------------------------------------------------------------------
 // Device includes, defines, and assembler directives
@@ -31,23 +31,23 @@
 // Subroutines
 //-----------------------------------------------------------------------------
 
-void initTimer()
+// Timer 4 paces the DDS, one tick every TICK_PERIOD_NS at any system clock
+void initTimer(uint32_t fcyc)
 {
     // Enable clocks
     SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R4;
     _delay_cycles(3);
 	
-    // Configure Timer 4 for 1 sec tick
     TIMER4_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
     TIMER4_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
     TIMER4_TAMR_R = TIMER_TAMR_TAMR_PERIOD;          // configure for periodic mode (count down)
-    TIMER4_TAILR_R = 977;                           // set load value (41 kHz? rate)
+    TIMER4_TAILR_R = (uint64_t)fcyc * TICK_PERIOD_NS / 1000000000 - 1; // set load value (40.9 kHz rate)
     TIMER4_CTL_R &= ~TIMER_CTL_TAEN;                  // turn-off timer
     TIMER4_IMR_R |= TIMER_IMR_TATOIM;                // turn-on interrupt
     NVIC_EN2_R |= 1 << (INT_TIMER4A-80);             // turn-on interrupt 86 (TIMER4A)
 }
 
-void initTimer2()
+void initTimer2(uint32_t fcyc)
 {
 	SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R2;
     _delay_cycles(3);
@@ -55,12 +55,46 @@ void initTimer2()
 	TIMER2_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
     TIMER2_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
     TIMER2_TAMR_R = TIMER_TAMR_TAMR_PERIOD;          // configure for periodic mode (count down)
-    TIMER2_TAILR_R = 40000000;                           // set load value (1 Hz rate)
+    TIMER2_TAILR_R = fcyc - 1;                       // set load value (1 Hz rate)
     TIMER2_IMR_R |= TIMER_IMR_TATOIM;                // turn-on interrupt
     enableNvicInterrupt(INT_TIMER2A);
 	TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
 }
 
+// Timer 3 runs a periodic control task, started by setting TAEN
+void initTimer3(uint32_t rate, uint32_t fcyc)
+{
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R3;
+    _delay_cycles(3);
+
+    TIMER3_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
+    TIMER3_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
+    TIMER3_TAMR_R = TIMER_TAMR_TAMR_PERIOD;          // configure for periodic mode (count down)
+    TIMER3_TAILR_R = fcyc / rate - 1;                // set load value
+    TIMER3_IMR_R |= TIMER_IMR_TATOIM;                // turn-on interrupt
+    enableNvicInterrupt(INT_TIMER3A);
+}
+
+// Timer 1 triggers ADC0 captures, it raises no interrupt of its own
+void initTimer1()
+{
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;
+    _delay_cycles(3);
+
+    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
+    TIMER1_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
+    TIMER1_TAMR_R = TIMER_TAMR_TAMR_PERIOD;          // configure for periodic mode (count down)
+    TIMER1_CTL_R |= TIMER_CTL_TAOTE;                 // timeout triggers the ADC
+}
+
+// Sets the Timer 1 trigger rate, returns the rate actually produced
+uint32_t setTimer1Rate(uint32_t rate, uint32_t fcyc)
+{
+    uint32_t load = (fcyc + rate / 2) / rate;
+    TIMER1_TAILR_R = load - 1;
+    return fcyc / load;
+}
+
 // Placeholder random number function
 uint32_t random32()
 {
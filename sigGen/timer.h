@@ -7,10 +7,10 @@
 
 // Target Platform: EK-TM4C123GXL
 // Target uC:       TM4C123GH6PM
-// System Clock:    40 MHz
+// System Clock:    -
 
 // Hardware configuration:
-// Timer 4
+// Timer 1 (ADC trigger), Timer 2, Timer 3, Timer 4
 
 //-----------------------------------------------------------------------------
 // Device includes, defines, and assembler directives
@@ -21,12 +21,17 @@
 
 typedef void (*_callback)();
 
+#define TICK_PERIOD_NS 24450 // default DDS tick, 978 clocks at 40 MHz
+
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
-void initTimer();
-void initTimer2();
+void initTimer(uint32_t fcyc);
+void initTimer2(uint32_t fcyc);
+void initTimer3(uint32_t rate, uint32_t fcyc);
+void initTimer1();
+uint32_t setTimer1Rate(uint32_t rate, uint32_t fcyc);
 //void tickIsr();
 uint32_t random32();
 
@@ -0,0 +1,109 @@
+/*
+ * trace.c
+ *
+ *  Writers claim a slot by incrementing traceHead and then fill it, so
+ *  nothing waits and a full ring overwrites its oldest entries. The shell
+ *  reads the ring with the mask cleared: every writer has a higher
+ *  priority than the shell, so no entry is half written while it is read.
+ *
+ *  Binary dump, little endian:
+ *    'T' 'R'  version(1)  count(2)  first(4)   header, TRACE_HEADER bytes
+ *    count * { time(4) data(2) event(1) reserved(1) }, oldest first
+ *    checksum(2)                               sum of all the entry bytes
+ *  first is the sequence number of the oldest entry, gaps between dumps
+ *  mean entries were overwritten.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "trace.h"
+
+
+volatile uint32_t traceMask = 0;
+volatile uint32_t traceHead = 0;
+TRACE_ENTRY traceRing[TRACE_SIZE];
+
+static char* const names[TRACE_EVENTS] =
+{
+    "cmd", "done", "lut", "lutdone", "swap", "cycles", "overrun", "uart"
+};
+
+static bool sameName(char* a, char* b)
+{
+    while(*a && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+char* getTraceName(TRACE_EVENT event)
+{
+    return event < TRACE_EVENTS ? names[event] : "?";
+}
+
+bool findTraceEvent(char* name, TRACE_EVENT* event)
+{
+    uint8_t e;
+
+    for(e = 0; e < TRACE_EVENTS; e++)
+        if(sameName(name, names[e]))
+        {
+            *event = (TRACE_EVENT)e;
+            return true;
+        }
+    return false;
+}
+
+// Entries held, at most TRACE_SIZE
+uint16_t getTraceCount(void)
+{
+    return traceHead < TRACE_SIZE ? traceHead : TRACE_SIZE;
+}
+
+// index 0 is the oldest entry held
+TRACE_ENTRY* getTraceEntry(uint16_t index)
+{
+    return &traceRing[(traceHead - getTraceCount() + index) & (TRACE_SIZE - 1)];
+}
+
+// Header of the binary dump for the entries held now, returns its length
+uint8_t packTraceHeader(uint8_t* header)
+{
+    uint16_t count = getTraceCount();
+    uint32_t first = traceHead - count;
+    uint8_t b;
+
+    header[0] = 'T';
+    header[1] = 'R';
+    header[2] = TRACE_VERSION;
+    header[3] = count & 0xFF;
+    header[4] = count >> 8;
+    for(b = 0; b < 4; b++)
+        header[5 + b] = (first >> (8 * b)) & 0xFF;
+    return TRACE_HEADER;
+}
+
+// Packs entry index (0 oldest) as 8 bytes, returns their sum for the checksum
+uint16_t packTraceEntry(uint16_t index, uint8_t* bytes)
+{
+    TRACE_ENTRY* entry = getTraceEntry(index);
+    uint16_t sum = 0;
+    uint8_t b;
+
+    for(b = 0; b < 4; b++)
+        bytes[b] = (entry->time >> (8 * b)) & 0xFF;
+    bytes[4] = entry->data & 0xFF;
+    bytes[5] = entry->data >> 8;
+    bytes[6] = entry->event;
+    bytes[7] = 0;
+    for(b = 0; b < TRACE_ENTRY_BYTES; b++)
+        sum += bytes[b];
+    return sum;
+}
+
+void clearTrace(void)
+{
+    traceHead = 0;
+}
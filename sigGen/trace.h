@@ -0,0 +1,79 @@
+/*
+ * trace.h
+ *
+ *  Ring of timestamped events, written from the ISRs and the shell, read by 'trace'
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cycles.h"
+
+#define TRACE_SIZE 128      // entries, a power of two
+#define TRACE_VERSION 1     // binary dump layout, see trace.c
+#define TRACE_HEADER 9      // bytes
+#define TRACE_ENTRY_BYTES 8
+
+typedef enum _TRACE_EVENT
+{
+    TRACE_COMMAND = 0,      // line received, data: its first two characters
+    TRACE_DISPATCHED = 1,   // command finished, data: as TRACE_COMMAND
+    TRACE_LUT_START = 2,    // calculateWave() started, data: WAVE << 8 | DAC
+    TRACE_LUT_END = 3,      // calculateWave() finished, data: as TRACE_LUT_START
+    TRACE_SWAP = 4,         // staged tables and settings played by the tick
+    TRACE_CYCLES_DONE = 5,  // an output reached its cycle count, data: DDS_OUT_A or DDS_OUT_B
+    TRACE_OVERRUN = 6,      // tick body plus entry and exit longer than its period, data: body clocks
+    TRACE_UART_OVERFLOW = 7,// UART0 receive FIFO overran before the shell read it
+    TRACE_EVENTS = 8
+} TRACE_EVENT;
+
+typedef struct _TRACE_ENTRY
+{
+    uint32_t time;          // CYCLE_COUNT
+    uint16_t data;
+    uint8_t event;
+    uint8_t reserved;
+} TRACE_ENTRY;
+
+extern volatile uint32_t traceMask; // bit per TRACE_EVENT, 0 costs one test per call
+extern volatile uint32_t traceHead; // entries ever claimed, the ring index is the low bits
+extern TRACE_ENTRY traceRing[TRACE_SIZE];
+
+// Claims a ring slot, safe against any ISR preempting between the read and the write
+static inline uint32_t claimTraceSlot(void)
+{
+#if defined(__TI_COMPILER_VERSION__)
+    uint32_t slot;
+
+    do
+        slot = __ldrex((void*)&traceHead);
+    while(__strex(slot + 1, (void*)&traceHead));
+    return slot;
+#else
+    return __atomic_fetch_add(&traceHead, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void traceEvent(TRACE_EVENT event, uint16_t data)
+{
+    TRACE_ENTRY* entry;
+
+    if(!(traceMask & (1UL << event)))
+        return;
+    entry = &traceRing[claimTraceSlot() & (TRACE_SIZE - 1)];
+    entry->time = CYCLE_COUNT;
+    entry->data = data;
+    entry->event = event;
+}
+
+char* getTraceName(TRACE_EVENT event);
+bool findTraceEvent(char* name, TRACE_EVENT* event);
+uint16_t getTraceCount(void);
+TRACE_ENTRY* getTraceEntry(uint16_t index);
+uint8_t packTraceHeader(uint8_t* header);
+uint16_t packTraceEntry(uint16_t index, uint8_t* bytes);
+void clearTrace(void);
+
+#endif /* TRACE_H_ */
@@ -23,6 +23,7 @@
 #include "tm4c123gh6pm.h"
 #include "uart0.h"
 #include "gpio.h"
+#include "wait.h"
 
 // Pins
 #define UART_TX PORTA,1
@@ -56,16 +57,41 @@ void initUart0(void)
 }
 
 // Set baud rate as function of instruction cycle frequency
-void setUart0BaudRate(uint32_t baudRate, uint32_t fcyc)
+// Rates above fcyc/16 switch to the high-speed divisor (fcyc/8), up to fcyc/8
+// Returns false and leaves UART0 untouched if the rate cannot be reached
+bool setUart0BaudRate(uint32_t baudRate, uint32_t fcyc)
 {
-    uint32_t divisorTimes128 = (fcyc * 8) / baudRate;   // calculate divisor (r) in units of 1/128,
+    bool highSpeed = baudRate > fcyc / 16;
+    uint32_t divisorTimes128;
+
+    if (baudRate == 0 || baudRate > fcyc / 8)
+        return false;
+
+    if (highSpeed)
+        divisorTimes128 = (fcyc * 16) / baudRate;       // r = fcyc / 8 * baudRate with HSE
+    else
+        divisorTimes128 = (fcyc * 8) / baudRate;        // calculate divisor (r) in units of 1/128,
                                                         // where r = fcyc / 16 * baudRate
     UART0_CTL_R = 0;                                    // turn-off UART0 to allow safe programming
     UART0_IBRD_R = divisorTimes128 >> 7;                // set integer value to floor(r)
     UART0_FBRD_R = ((divisorTimes128 + 1) >> 1) & 63;   // set fractional value to round(fract(r)*64)
     UART0_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN;    // configure for 8N1 w/ 16-level FIFO
-    UART0_CTL_R = UART_CTL_TXE | UART_CTL_RXE | UART_CTL_UARTEN;
+    UART0_CTL_R = UART_CTL_TXE | UART_CTL_RXE | UART_CTL_UARTEN | (highSpeed ? UART_CTL_HSE : 0);
                                                         // turn-on UART0
+    return true;
+}
+
+// Blocks until the tx fifo and shift register are empty, so a baud change does not cut a character
+void flushUart0(void)
+{
+    while (UART0_FR_R & UART_FR_BUSY);
+}
+
+// Discards anything waiting in the rx fifo
+void clearUart0(void)
+{
+    while (!(UART0_FR_R & UART_FR_RXFE))
+        (void)UART0_DR_R;
 }
 
 // Blocking function that writes a serial character when the UART buffer is not full
@@ -83,6 +109,160 @@ void putsUart0(char* str)
         putcUart0(str[i++]);
 }
 
+// Blocking function that writes raw bytes, for binary frames
+void putBufferUart0(const void* data, uint16_t length)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint16_t i;
+    for (i = 0; i < length; i++)
+        putcUart0(bytes[i]);
+}
+
+// Writes at least minDigits decimal digits, zero padded on the left
+static void putDigitsUart0(uint32_t value, uint8_t minDigits)
+{
+    char digits[10];
+    uint8_t count = 0;
+
+    do
+    {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0 || count < minDigits);
+
+    while (count > 0)
+        putcUart0(digits[--count]);
+}
+
+// Writes an unsigned decimal integer
+void putuUart0(uint32_t value)
+{
+    putDigitsUart0(value, 1);
+}
+
+// Writes a signed decimal integer
+void putiUart0(int32_t value)
+{
+    if (value < 0)
+    {
+        putcUart0('-');
+        putDigitsUart0(-(uint32_t)value, 1);
+    }
+    else
+        putDigitsUart0(value, 1);
+}
+
+// Writes lowercase hex, zero padded to minDigits (0 for no padding, at most 8)
+void putxUart0(uint32_t value, uint8_t minDigits)
+{
+    char digits[8];
+    uint8_t count = 0;
+
+    if (minDigits > 8)
+        minDigits = 8;
+
+    do
+    {
+        digits[count++] = "0123456789abcdef"[value & 0xF];
+        value >>= 4;
+    } while (value != 0 || count < minDigits);
+
+    while (count > 0)
+        putcUart0(digits[--count]);
+}
+
+// Writes a fixed-point value held in units of 10^-decimals, e.g. (1500, 3) -> "1.500"
+void putFixedUart0(int32_t value, uint8_t decimals)
+{
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    uint32_t scale = 1;
+    uint8_t i;
+
+    if (decimals > 9)
+        decimals = 9;
+    for (i = 0; i < decimals; i++)
+        scale *= 10;
+
+    if (value < 0)
+        putcUart0('-');
+    putDigitsUart0(magnitude / scale, 1);
+    if (decimals > 0)
+    {
+        putcUart0('.');
+        putDigitsUart0(magnitude % scale, decimals);
+    }
+}
+
+// Writes a float rounded to the given number of decimals without printf
+void putFloatUart0(float value, uint8_t decimals)
+{
+    uint32_t scale = 1;
+    uint32_t whole, fraction;
+    uint8_t i;
+
+    if (decimals > 9)
+        decimals = 9;
+    for (i = 0; i < decimals; i++)
+        scale *= 10;
+
+    if (value != value)
+    {
+        putsUart0("nan");
+        return;
+    }
+    if (value < 0)
+    {
+        putcUart0('-');
+        value = -value;
+    }
+    if (value >= 4294967295.0f)
+    {
+        putsUart0("inf");
+        return;
+    }
+
+    whole = (uint32_t)value;
+    fraction = (uint32_t)((value - (float)whole) * (float)scale + 0.5f);
+    if (fraction >= scale)
+    {
+        whole++;
+        fraction -= scale;
+    }
+
+    putDigitsUart0(whole, 1);
+    if (decimals > 0)
+    {
+        putcUart0('.');
+        putDigitsUart0(fraction, decimals);
+    }
+}
+
+// Writes a float in engineering notation with an SI suffix, e.g. 1500 -> "1.50k"
+void putEngUart0(float value, uint8_t decimals)
+{
+    static const char suffix[] = { 'p', 'n', 'u', 'm', 0, 'k', 'M', 'G' };
+    float magnitude = value < 0 ? -value : value;
+    uint8_t index = 4;
+
+    if (magnitude != 0)
+    {
+        while (magnitude >= 1000.0f && index < sizeof(suffix) - 1)
+        {
+            magnitude /= 1000.0f;
+            index++;
+        }
+        while (magnitude < 1.0f && index > 0)
+        {
+            magnitude *= 1000.0f;
+            index--;
+        }
+    }
+
+    putFloatUart0(value < 0 ? -magnitude : magnitude, decimals);
+    if (suffix[index] != 0)
+        putcUart0(suffix[index]);
+}
+
 // Blocking function that returns with serial data once the buffer is not empty
 char getcUart0(void)
 {
@@ -90,8 +270,32 @@ char getcUart0(void)
     return UART0_DR_R & 0xFF;                        // get character from fifo
 }
 
+// Waits up to timeoutUs for a character, returning the raw data register (with error bits)
+// or -1 on timeout
+int16_t getcUart0Timeout(uint32_t timeoutUs)
+{
+    while (UART0_FR_R & UART_FR_RXFE)
+    {
+        if (timeoutUs == 0)
+            return -1;
+        waitMicrosecond(10);
+        timeoutUs = timeoutUs > 10 ? timeoutUs - 10 : 0;
+    }
+    return UART0_DR_R & 0xFFF;
+}
+
 // Returns the status of the receive buffer
 bool kbhitUart0(void)
 {
     return !(UART0_FR_R & UART_FR_RXFE);
 }
+
+// Returns true once for each time the receive FIFO overran since the last call
+bool checkUart0Overrun(void)
+{
+    bool overrun = UART0_RSR_R & UART_RSR_OE;
+
+    if (overrun)
+        UART0_ECR_R = 0;                                // any write clears the error flags
+    return overrun;
+}
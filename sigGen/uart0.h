@@ -26,10 +26,21 @@
 //-----------------------------------------------------------------------------
 
 void initUart0(void);
-void setUart0BaudRate(uint32_t baudRate, uint32_t fcyc);
+bool setUart0BaudRate(uint32_t baudRate, uint32_t fcyc);
+void flushUart0(void);
+void clearUart0(void);
 void putcUart0(char c);
 void putsUart0(char* str);
+void putBufferUart0(const void* data, uint16_t length);
+void putuUart0(uint32_t value);
+void putiUart0(int32_t value);
+void putxUart0(uint32_t value, uint8_t minDigits);
+void putFixedUart0(int32_t value, uint8_t decimals);
+void putFloatUart0(float value, uint8_t decimals);
+void putEngUart0(float value, uint8_t decimals);
 char getcUart0(void);
+int16_t getcUart0Timeout(uint32_t timeoutUs);
 bool kbhitUart0(void);
+bool checkUart0Overrun(void);
 
 #endif
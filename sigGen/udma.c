@@ -0,0 +1,51 @@
+/*
+ * udma.c
+ *
+ *  uDMA channel control table and channel setup, 32 channels
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "udma.h"
+
+// Control table, 32 primary structures followed by 32 alternates, must be 1 KiB aligned
+#pragma DATA_ALIGN(udmaTable, 1024)
+UDMA_ENTRY udmaTable[64];
+
+void initUdma(void)
+{
+    SYSCTL_RCGCDMA_R |= SYSCTL_RCGCDMA_R0;
+    _delay_cycles(3);
+    UDMA_CFG_R = UDMA_CFG_MASTEN;
+    UDMA_CTLBASE_R = (uint32_t)(uintptr_t)udmaTable;
+}
+
+// Loads a control structure, srcEnd and dstEnd point at the last item of each buffer
+void setUdmaEntry(uint8_t channel, bool alternate, volatile void* srcEnd, volatile void* dstEnd, uint32_t control)
+{
+    UDMA_ENTRY* entry = &udmaTable[channel + (alternate ? 32 : 0)];
+    entry->srcEnd = srcEnd;
+    entry->dstEnd = dstEnd;
+    entry->control = control;
+}
+
+// Returns the transfer mode field, UDMA_CHCTL_XFERMODE_STOP once a structure is used up
+uint32_t getUdmaMode(uint8_t channel, bool alternate)
+{
+    return udmaTable[channel + (alternate ? 32 : 0)].control & UDMA_CHCTL_XFERMODE_M;
+}
+
+// Starts a channel on its primary structure using burst requests only
+void enableUdmaChannel(uint8_t channel)
+{
+    UDMA_ALTCLR_R = 1 << channel;
+    UDMA_USEBURSTSET_R = 1 << channel;
+    UDMA_REQMASKCLR_R = 1 << channel;
+    UDMA_ENASET_R = 1 << channel;
+}
+
+void disableUdmaChannel(uint8_t channel)
+{
+    UDMA_ENACLR_R = 1 << channel;
+}
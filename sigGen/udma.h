@@ -0,0 +1,30 @@
+/*
+ * udma.h
+ *
+ *  uDMA channel control table and channel setup, 32 channels
+ */
+
+#ifndef UDMA_H_
+#define UDMA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UDMA_CH_ADC0SS1 15
+
+// One channel control structure
+typedef struct _UDMA_ENTRY
+{
+    volatile void* srcEnd;
+    volatile void* dstEnd;
+    volatile uint32_t control;
+    uint32_t unused;
+} UDMA_ENTRY;
+
+void initUdma(void);
+void setUdmaEntry(uint8_t channel, bool alternate, volatile void* srcEnd, volatile void* dstEnd, uint32_t control);
+uint32_t getUdmaMode(uint8_t channel, bool alternate);
+void enableUdmaChannel(uint8_t channel);
+void disableUdmaChannel(uint8_t channel);
+
+#endif
@@ -6,7 +6,7 @@
 //-----------------------------------------------------------------------------
 
 // Target uC:       TM4C123GH6PM
-// System Clock:    40 MHz
+// System Clock:    SYSTEM_CLOCK_MHZ (clock.h)
 
 //-----------------------------------------------------------------------------
 // Device includes, defines, and assembler directives
@@ -15,23 +15,42 @@
 #include <stdint.h>
 #include "tm4c123gh6pm.h"
 #include "wait.h"
+#include "clock.h"
+
+// Inner loop passes per microsecond, the loop costs 6 * passes + 4 clocks
+// (rounded up so waits never run short), a literal for the MOV immediate
+#if SYSTEM_CLOCK_MHZ == 80
+#define WAIT_PASSES 13  // 82 clocks
+#elif SYSTEM_CLOCK_MHZ == 50
+#define WAIT_PASSES 8   // 52 clocks
+#elif SYSTEM_CLOCK_MHZ == 40
+#define WAIT_PASSES 6   // 40 clocks
+#elif SYSTEM_CLOCK_MHZ == 25
+#define WAIT_PASSES 4   // 28 clocks
+#elif SYSTEM_CLOCK_MHZ == 20
+#define WAIT_PASSES 3   // 22 clocks
+#else
+#error "no wait loop for this SYSTEM_CLOCK_MHZ"
+#endif
+#define WAIT_STRING(x) #x
+#define WAIT_IMMEDIATE(x) WAIT_STRING(x)
 
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
-// Approximate busy waiting (in units of microseconds), given a 40 MHz system clock
+// Approximate busy waiting (in units of microseconds), at SYSTEM_CLOCK_MHZ
 void waitMicrosecond(uint32_t us)
 {
 	                                            // Approx clocks per us
-	__asm("WMS_LOOP0:   MOV  R1, #6");          // 1
-    __asm("WMS_LOOP1:   SUB  R1, #1");          // 6
-    __asm("             CBZ  R1, WMS_DONE1");   // 5+1*3
-    __asm("             NOP");                  // 5
-    __asm("             B    WMS_LOOP1");       // 5*3
+	__asm("WMS_LOOP0:   MOV  R1, #" WAIT_IMMEDIATE(WAIT_PASSES)); // 1
+    __asm("WMS_LOOP1:   SUB  R1, #1");          // N
+    __asm("             CBZ  R1, WMS_DONE1");   // N-1+1*3
+    __asm("             NOP");                  // N-1
+    __asm("             B    WMS_LOOP1");       // (N-1)*3
     __asm("WMS_DONE1:   SUB  R0, #1");          // 1
     __asm("             CBZ  R0, WMS_DONE0");   // 1
     __asm("             B    WMS_LOOP0");       // 1*3
     __asm("WMS_DONE0:");                        // ---
-                                                // 40 clocks/us + error
+                                                // 6N+4 clocks/us + error
 }
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""Decode a sigGen 'capture' frame into CSV.
+
+Reads raw bytes from a file (or a serial port with --port, needs pyserial),
+finds the 'SC' frame described in sigGen/scope.c and prints
+time (s, 0 at the trigger), IN1 (V), IN2 (V).
+"""
+
+import argparse
+import struct
+import sys
+
+VREF = 3.3
+FULL_SCALE = 4095
+
+
+def decode(raw):
+    start = raw.find(b"SC")
+    if start < 0 or len(raw) < start + 12:
+        raise ValueError("no frame header found")
+    version, flags, rate, pairs, pre = struct.unpack_from("<BBIHH", raw, start + 2)
+    if version != 1:
+        raise ValueError("unsupported frame version %d" % version)
+
+    payload = raw[start + 12:start + 12 + pairs * 3]
+    if len(payload) != pairs * 3 or len(raw) < start + 14 + pairs * 3:
+        raise ValueError("frame truncated")
+    (checksum,) = struct.unpack_from("<H", raw, start + 12 + pairs * 3)
+    if sum(payload) & 0xFFFF != checksum:
+        raise ValueError("checksum mismatch")
+
+    samples = []
+    for i in range(pairs):
+        b0, b1, b2 = payload[3 * i:3 * i + 3]
+        in1 = b0 | ((b1 & 0x0F) << 8)
+        in2 = (b1 >> 4) | (b2 << 4)
+        samples.append(((i - pre) / rate, in1 * VREF / FULL_SCALE, in2 * VREF / FULL_SCALE))
+    return bool(flags & 1), rate, samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("file", nargs="?", help="raw capture bytes, stdin if omitted")
+    parser.add_argument("--port", help="read from a serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--command", default="capture 100000 1024 256")
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=3) as port:
+            port.write((args.command + "\r").encode())
+            raw = port.read(65536)  # stops at the 3 s timeout
+    elif args.file:
+        with open(args.file, "rb") as f:
+            raw = f.read()
+    else:
+        raw = sys.stdin.buffer.read()
+
+    triggered, rate, samples = decode(raw)
+    print("# rate=%d triggered=%s" % (rate, triggered))
+    print("time,in1,in2")
+    for t, in1, in2 in samples:
+        print("%.7f,%.4f,%.4f" % (t, in1, in2))
+
+
+if __name__ == "__main__":
+    main()
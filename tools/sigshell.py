@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Drive the sigGen shell from scripts.
+
+Puts the board in 'script ON' mode, where there is no prompt and every
+response ends with a line holding only '.', then runs commands from the
+command line, a file (one per line, '#' comments) or stdin. Any response
+line starting with 'ERROR' marks the command as failed.
+
+--repeat runs the command list again and again and reports round trips per
+second and latency (median, p99, max), e.g. to load-test the shell:
+    sigshell.py --port COM3 --repeat 200 status
+--status prints the 'status' readback as key=value per output.
+Needs pyserial.
+"""
+
+import argparse
+import sys
+import time
+
+
+class Instrument:
+    def __init__(self, port, baud=115200, timeout=10.0):
+        import serial
+        self.port = serial.Serial(port, baud, timeout=timeout)
+        self.port.reset_input_buffer()
+        self.port.write(b"script ON\r")
+        # the reply to 'script ON' is the first one framed, skip whatever came before it
+        self._read_response()
+
+    def close(self):
+        self.port.write(b"script OFF\r")
+        self.port.close()
+
+    def _read_response(self):
+        lines = []
+        while True:
+            raw = self.port.readline()
+            if not raw.endswith(b"\n"):
+                raise TimeoutError("no end of response, got %r" % b"\n".join(lines + [raw]))
+            line = raw.rstrip(b"\r\n")
+            if line == b".":
+                return [l.decode(errors="replace") for l in lines if l]
+            lines.append(line.lstrip(b">"))
+
+    def command(self, line):
+        """Runs one command, returns (ok, response lines)."""
+        self.port.write((line.strip() + "\r").encode())
+        lines = self._read_response()
+        return not any(l.startswith("ERROR") for l in lines), lines
+
+    def status(self):
+        """Parses 'status' into {'': {...}, 'A': {...}, 'B': {...}}."""
+        ok, lines = self.command("status")
+        if not ok:
+            raise RuntimeError("\n".join(lines))
+        result = {}
+        for line in lines:
+            name, _, fields = line.rpartition(": ") if ": " in line else ("", "", line)
+            result[name] = dict(f.split("=", 1) for f in fields.split())
+        return result
+
+
+def percentile(sorted_values, p):
+    # nearest rank, as on the board's 'bench'
+    rank = max(1, -(-len(sorted_values) * p // 100))
+    return sorted_values[rank - 1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("commands", nargs="*", help="commands to run, stdin if none and no --file")
+    parser.add_argument("--port", required=True)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--file", help="commands, one per line")
+    parser.add_argument("--repeat", type=int, default=1, help="runs of the command list, timing reported if more than 1")
+    parser.add_argument("--status", action="store_true", help="print the output readback at the end")
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file) as f:
+            commands = f.read().splitlines()
+    elif args.commands:
+        commands = args.commands
+    elif not args.status:
+        commands = sys.stdin.read().splitlines()
+    else:
+        commands = []
+    commands = [c.strip() for c in commands if c.strip() and not c.strip().startswith("#")]
+
+    board = Instrument(args.port, args.baud)
+    failed = 0
+    latencies = []
+    try:
+        for run in range(args.repeat):
+            for line in commands:
+                start = time.perf_counter()
+                ok, lines = board.command(line)
+                latencies.append(time.perf_counter() - start)
+                failed += not ok
+                if args.repeat == 1 or not ok:
+                    for l in lines:
+                        print(l)
+        if args.status:
+            for name, fields in board.status().items():
+                print("%s %s" % (name or "-", " ".join("%s=%s" % kv for kv in fields.items())))
+    finally:
+        board.close()
+
+    if args.repeat > 1 and latencies:
+        latencies.sort()
+        total = sum(latencies)
+        print("# %d commands in %.3f s, %.1f/s, latency median %.2f ms, p99 %.2f ms, max %.2f ms, %d failed"
+              % (len(latencies), total, len(latencies) / total, 1000 * percentile(latencies, 50),
+                 1000 * percentile(latencies, 99), 1000 * latencies[-1], failed))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""Decode a sigGen 'trace bin' dump into text.
+
+Reads raw bytes from a file (or a serial port with --port, needs pyserial),
+finds the 'TR' frame described in sigGen/trace.c and prints
+sequence, time (us after the oldest event), event, data.
+"""
+
+import argparse
+import struct
+import sys
+
+CLOCK = 40e6
+EVENTS = ["cmd", "done", "lut", "lutdone", "swap", "cycles", "overrun", "uart"]
+
+
+def decode(raw):
+    start = raw.find(b"TR")
+    if start < 0 or len(raw) < start + 9:
+        raise ValueError("no frame header found")
+    version, count, first = struct.unpack_from("<BHI", raw, start + 2)
+    if version != 1:
+        raise ValueError("unsupported frame version %d" % version)
+
+    payload = raw[start + 9:start + 9 + count * 8]
+    if len(payload) != count * 8 or len(raw) < start + 11 + count * 8:
+        raise ValueError("frame truncated")
+    (checksum,) = struct.unpack_from("<H", raw, start + 9 + count * 8)
+    if sum(payload) & 0xFFFF != checksum:
+        raise ValueError("checksum mismatch")
+
+    events = []
+    for i in range(count):
+        time, data, event = struct.unpack_from("<IHB", payload, 8 * i)
+        events.append((first + i, time, event, data))
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("file", nargs="?", help="raw dump bytes, stdin if omitted")
+    parser.add_argument("--port", help="read from a serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=3) as port:
+            port.write(b"trace bin\r")
+            raw = port.read(65536)  # stops at the 3 s timeout
+    elif args.file:
+        with open(args.file, "rb") as f:
+            raw = f.read()
+    else:
+        raw = sys.stdin.buffer.read()
+
+    events = decode(raw)
+    oldest = events[0][1] if events else 0
+    print("seq,time_us,event,data")
+    for seq, time, event, data in events:
+        name = EVENTS[event] if event < len(EVENTS) else str(event)
+        if name in ("cmd", "done"):
+            text = "".join(chr(c) for c in (data >> 8, data & 0xFF) if c)
+        else:
+            text = "0x%04X" % data
+        print("%d,%.1f,%s,%s" % (seq, ((time - oldest) & 0xFFFFFFFF) / (CLOCK / 1e6), name, text))
+
+
+if __name__ == "__main__":
+    main()